@@ -0,0 +1,213 @@
+/*
+Copyright (c) 2016, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2016. Los Alamos National Security, LLC. This software was produced 
+under U.S. Government contract DE-AC52-06NA25396 for Los Alamos National 
+Laboratory (LANL), which is operated by Los Alamos National Security, LLC for 
+the U.S. Department of Energy. The U.S. Government has rights to use, 
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR LOS 
+ALAMOS NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR 
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified 
+to produce derivative works, such modified software should be clearly marked, 
+so as not to confuse it with the version available from LANL.
+
+Additionally, redistribution and use in source and binary forms, with or 
+without modification, are permitted provided that the following conditions 
+are met:
+1.      Redistributions of source code must retain the above copyright notice, 
+        this list of conditions and the following disclaimer.
+2.      Redistributions in binary form must reproduce the above copyright 
+        notice, this list of conditions and the following disclaimer in the 
+        documentation and/or other materials provided with the distribution.
+3.      Neither the name of Los Alamos National Security, LLC, Los Alamos 
+        National Laboratory, LANL, the U.S. Government, nor the names of its 
+        contributors may be used to endorse or promote products derived from 
+        this software without specific prior written permission.
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND 
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT 
+NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS ALAMOS NATIONAL 
+SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; 
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "Anderson.hh"
+#include "Comm.hh"
+#include "Assert.hh"
+#include <algorithm>
+#include <math.h>
+
+using namespace std;
+
+
+namespace
+{
+
+// Tikhonov regularization relative to the mean diagonal of the Gram matrix
+const double c_regularization = 1e-10;
+
+
+/*
+    solveNormal
+    
+    Solves the n x n system a x = b with Gaussian elimination and partial
+    pivoting.  a is row major and is overwritten.  b is overwritten by x.
+*/
+void solveNormal(UINT n, vector<double> &a, vector<double> &b)
+{
+    for (UINT col = 0; col < n; col++) {
+        UINT pivot = col;
+        for (UINT row = col + 1; row < n; row++) {
+            if (fabs(a[row * n + col]) > fabs(a[pivot * n + col]))
+                pivot = row;
+        }
+        Insist(a[pivot * n + col] != 0.0, "Anderson: singular Gram matrix.");
+        if (pivot != col) {
+            for (UINT j = 0; j < n; j++) {
+                swap(a[pivot * n + j], a[col * n + j]);
+            }
+            swap(b[pivot], b[col]);
+        }
+        
+        for (UINT row = col + 1; row < n; row++) {
+            double factor = a[row * n + col] / a[col * n + col];
+            for (UINT j = col; j < n; j++) {
+                a[row * n + j] -= factor * a[col * n + j];
+            }
+            b[row] -= factor * b[col];
+        }
+    }
+    
+    for (UINT row = n; row-- > 0;) {
+        double sum = b[row];
+        for (UINT j = row + 1; j < n; j++) {
+            sum -= a[row * n + j] * b[j];
+        }
+        b[row] = sum / a[row * n + row];
+    }
+}
+
+} // End anonymous namespace
+
+
+/*
+    Anderson
+    
+    vecSize is the local size of the iterate and depth is m.
+*/
+Anderson::Anderson(UINT vecSize, UINT depth)
+{
+    Insist(depth > 0, "Anderson depth must be > 0.");
+    
+    c_vecSize = vecSize;
+    c_depth = depth;
+    c_numCols = 0;
+    c_newest = 0;
+    c_numUpdates = 0;
+    c_fPrev.resize(vecSize);
+    c_gPrev.resize(vecSize);
+    c_f.resize(vecSize);
+    c_deltaF.resize(depth);
+    c_deltaG.resize(depth);
+    c_gram.resize(depth * depth);
+}
+
+
+/*
+    update
+    
+    On input, g = G(x).  On output, g is the next iterate,
+        g - DeltaG gamma,
+    where gamma minimizes |f - DeltaF gamma| for f = g - x.
+*/
+void Anderson::update(const double *x, double *g)
+{
+    // Residual
+    for (UINT i = 0; i < c_vecSize; i++) {
+        c_f[i] = g[i] - x[i];
+    }
+    
+    
+    // Add the differences from the last update to the history,
+    // replacing the oldest column if the history is full
+    if (c_numUpdates > 0) {
+        c_newest = (c_numCols < c_depth) ? c_numCols : 
+                   (c_newest + 1) % c_depth;
+        c_numCols = min(c_numCols + 1, c_depth);
+        
+        vector<double> &deltaF = c_deltaF[c_newest];
+        vector<double> &deltaG = c_deltaG[c_newest];
+        deltaF.resize(c_vecSize);
+        deltaG.resize(c_vecSize);
+        for (UINT i = 0; i < c_vecSize; i++) {
+            deltaF[i] = c_f[i] - c_fPrev[i];
+            deltaG[i] = g[i] - c_gPrev[i];
+        }
+    }
+    c_numUpdates++;
+    for (UINT i = 0; i < c_vecSize; i++) {
+        c_fPrev[i] = c_f[i];
+        c_gPrev[i] = g[i];
+    }
+    
+    if (c_numCols == 0)
+        return;
+    
+    
+    // New column of the Gram matrix and DeltaF^T f in one reduction
+    UINT n = c_numCols;
+    vector<double> dots(2 * n, 0.0);
+    const vector<double> &deltaFNew = c_deltaF[c_newest];
+    for (UINT j = 0; j < n; j++) {
+        const vector<double> &deltaF = c_deltaF[j];
+        double gramSum = 0.0;
+        double rhsSum = 0.0;
+        for (UINT i = 0; i < c_vecSize; i++) {
+            gramSum += deltaF[i] * deltaFNew[i];
+            rhsSum += deltaF[i] * c_f[i];
+        }
+        dots[j] = gramSum;
+        dots[n + j] = rhsSum;
+    }
+    Comm::gsum(dots);
+    
+    for (UINT j = 0; j < n; j++) {
+        c_gram[j * c_depth + c_newest] = dots[j];
+        c_gram[c_newest * c_depth + j] = dots[j];
+    }
+    
+    
+    // Solve the regularized normal equations for gamma
+    double trace = 0.0;
+    for (UINT j = 0; j < n; j++) {
+        trace += c_gram[j * c_depth + j];
+    }
+    if (trace == 0.0)
+        return;
+    
+    vector<double> a(n * n);
+    vector<double> gamma(dots.begin() + n, dots.end());
+    for (UINT j = 0; j < n; j++) {
+    for (UINT k = 0; k < n; k++) {
+        a[j * n + k] = c_gram[j * c_depth + k];
+    }}
+    for (UINT j = 0; j < n; j++) {
+        a[j * n + j] += c_regularization * trace / n;
+    }
+    solveNormal(n, a, gamma);
+    
+    
+    // g = g - DeltaG gamma
+    for (UINT j = 0; j < n; j++) {
+        const vector<double> &deltaG = c_deltaG[j];
+        for (UINT i = 0; i < c_vecSize; i++) {
+            g[i] -= gamma[j] * deltaG[i];
+        }
+    }
+}
@@ -0,0 +1,82 @@
+/*
+Copyright (c) 2016, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2016. Los Alamos National Security, LLC. This software was produced 
+under U.S. Government contract DE-AC52-06NA25396 for Los Alamos National 
+Laboratory (LANL), which is operated by Los Alamos National Security, LLC for 
+the U.S. Department of Energy. The U.S. Government has rights to use, 
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR LOS 
+ALAMOS NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR 
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified 
+to produce derivative works, such modified software should be clearly marked, 
+so as not to confuse it with the version available from LANL.
+
+Additionally, redistribution and use in source and binary forms, with or 
+without modification, are permitted provided that the following conditions 
+are met:
+1.      Redistributions of source code must retain the above copyright notice, 
+        this list of conditions and the following disclaimer.
+2.      Redistributions in binary form must reproduce the above copyright 
+        notice, this list of conditions and the following disclaimer in the 
+        documentation and/or other materials provided with the distribution.
+3.      Neither the name of Los Alamos National Security, LLC, Los Alamos 
+        National Laboratory, LANL, the U.S. Government, nor the names of its 
+        contributors may be used to endorse or promote products derived from 
+        this software without specific prior written permission.
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND 
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT 
+NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS ALAMOS NATIONAL 
+SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; 
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __ANDERSON_HH__
+#define __ANDERSON_HH__
+
+#include "Global.hh"
+#include <vector>
+
+
+/*
+    Anderson class
+    
+    Anderson(m) acceleration of a fixed-point iteration x = G(x).
+    Given the last iterate x and g = G(x), update replaces g with the 
+    combination of the last m + 1 values of G that minimizes the 
+    corresponding combination of residuals f = G(x) - x in the 2-norm.
+    With no history (the first update), g is left as is.
+    
+    The differences of the last m residuals and G values are kept in a
+    circular history, allocated as it fills, along with their Gram matrix.
+    Each update adds one column to the Gram matrix, so the dot products it
+    needs are summed over ranks in a single reduction.  The small least 
+    squares system is solved through its normal equations on every rank.
+*/
+class Anderson
+{
+public:
+    Anderson(UINT vecSize, UINT depth);
+    void update(const double *x, double *g);
+    
+private:
+    UINT c_vecSize;
+    UINT c_depth;
+    UINT c_numCols;
+    UINT c_newest;
+    UINT c_numUpdates;
+    std::vector<double> c_fPrev;
+    std::vector<double> c_gPrev;
+    std::vector<double> c_f;
+    std::vector<std::vector<double>> c_deltaF;
+    std::vector<std::vector<double>> c_deltaG;
+    std::vector<double> c_gram;
+};
+
+#endif
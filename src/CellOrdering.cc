@@ -0,0 +1,240 @@
+/*
+Copyright (c) 2016, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2016. Los Alamos National Security, LLC. This software was produced 
+under U.S. Government contract DE-AC52-06NA25396 for Los Alamos National 
+Laboratory (LANL), which is operated by Los Alamos National Security, LLC for 
+the U.S. Department of Energy. The U.S. Government has rights to use, 
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR LOS 
+ALAMOS NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR 
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified 
+to produce derivative works, such modified software should be clearly marked, 
+so as not to confuse it with the version available from LANL.
+
+Additionally, redistribution and use in source and binary forms, with or 
+without modification, are permitted provided that the following conditions 
+are met:
+1.      Redistributions of source code must retain the above copyright notice, 
+        this list of conditions and the following disclaimer.
+2.      Redistributions in binary form must reproduce the above copyright 
+        notice, this list of conditions and the following disclaimer in the 
+        documentation and/or other materials provided with the distribution.
+3.      Neither the name of Los Alamos National Security, LLC, Los Alamos 
+        National Laboratory, LANL, the U.S. Government, nor the names of its 
+        contributors may be used to endorse or promote products derived from 
+        this software without specific prior written permission.
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND 
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT 
+NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS ALAMOS NATIONAL 
+SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; 
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "CellOrdering.hh"
+#include "TychoMesh.hh"
+#include "Global.hh"
+#include "Assert.hh"
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <limits>
+
+using namespace std;
+
+
+/*
+    spreadBits
+    
+    Spreads the low 21 bits of x so there are two zero bits between each.
+*/
+static
+uint64_t spreadBits(uint64_t x)
+{
+    x &= 0x1fffff;
+    x = (x | x << 32) & 0x1f00000000ffff;
+    x = (x | x << 16) & 0x1f0000ff0000ff;
+    x = (x | x << 8)  & 0x100f00f00f00f00f;
+    x = (x | x << 4)  & 0x10c30c30c30c30c3;
+    x = (x | x << 2)  & 0x1249249249249249;
+    return x;
+}
+
+
+namespace CellOrdering
+{
+
+/*
+    mortonOrder
+    
+    order[i] is the i-th local cell sorted by the Morton (Z-order) code of 
+    its centroid.  Cells close in the order are close in space.
+*/
+void mortonOrder(vector<UINT> &order)
+{
+    vector<double> centroids(g_nCells * g_ndim);
+    
+    for (UINT cell = 0; cell < g_nCells; cell++) {
+    for (UINT dim = 0; dim < g_ndim; dim++) {
+        double centroid = 0.0;
+        for (UINT vrtx = 0; vrtx < g_nVrtxPerCell; vrtx++) {
+            UINT node = g_tychoMesh->getCellNode(cell, vrtx);
+            centroid += g_tychoMesh->getNodeCoord(node, dim);
+        }
+        centroids[cell * g_ndim + dim] = centroid / g_nVrtxPerCell;
+    }}
+    
+    mortonOrder(centroids, order);
+}
+
+
+/*
+    mortonOrder
+    
+    Same as above for cells with centroids[cell * g_ndim + dim].
+*/
+void mortonOrder(const vector<double> &centroids, vector<UINT> &order)
+{
+    const uint64_t maxCoord = (1 << 21) - 1;
+    const UINT numCells = centroids.size() / g_ndim;
+    double low[g_ndim];
+    double high[g_ndim];
+    
+    
+    // Bounding box of the centroids
+    for (UINT dim = 0; dim < g_ndim; dim++) {
+        low[dim] = numeric_limits<double>::max();
+        high[dim] = numeric_limits<double>::lowest();
+    }
+    
+    for (UINT cell = 0; cell < numCells; cell++) {
+    for (UINT dim = 0; dim < g_ndim; dim++) {
+        low[dim] = min(low[dim], centroids[cell * g_ndim + dim]);
+        high[dim] = max(high[dim], centroids[cell * g_ndim + dim]);
+    }}
+    
+    
+    // Sort by Morton code of the centroids scaled to 21 bits per dimension
+    vector<pair<uint64_t,UINT>> codes(numCells);
+    for (UINT cell = 0; cell < numCells; cell++) {
+        uint64_t code = 0;
+        for (UINT dim = 0; dim < g_ndim; dim++) {
+            double width = high[dim] - low[dim];
+            double scaled = width > 0.0 ? 
+                (centroids[cell * g_ndim + dim] - low[dim]) / width : 0.0;
+            uint64_t coord = (uint64_t)(scaled * maxCoord);
+            code |= spreadBits(coord) << dim;
+        }
+        codes[cell] = make_pair(code, cell);
+    }
+    sort(codes.begin(), codes.end());
+    
+    order.resize(numCells);
+    for (UINT i = 0; i < numCells; i++) {
+        order[i] = codes[i].second;
+    }
+}
+
+
+/*
+    rcmOrder
+    
+    Reverse Cuthill-McKee ordering of cells with neighbors
+    adjCells[cell * g_nFacePerCell + face].  Entries not less than the 
+    number of cells mean there is no local neighbor across that face.
+    Each connected piece of the mesh starts at a cell found by a 
+    breadth-first search from a cell of lowest degree.
+*/
+void rcmOrder(const vector<UINT> &adjCells, vector<UINT> &order)
+{
+    const UINT numCells = adjCells.size() / g_nFacePerCell;
+    vector<UINT> degree(numCells, 0);
+    vector<bool> visited(numCells, false);
+    
+    
+    // Degree of each cell
+    for (UINT cell = 0; cell < numCells; cell++) {
+    for (UINT face = 0; face < g_nFacePerCell; face++) {
+        if (adjCells[cell * g_nFacePerCell + face] < numCells)
+            degree[cell]++;
+    }}
+    
+    
+    // Breadth-first search from start appending cells to cells.
+    // Neighbors are visited in order of increasing degree.
+    auto bfs = [&](UINT start, vector<UINT> &cells, vector<bool> &seen)
+    {
+        UINT first = cells.size();
+        cells.push_back(start);
+        seen[start] = true;
+        for (UINT i = first; i < cells.size(); i++) {
+            UINT cell = cells[i];
+            vector<pair<UINT,UINT>> neighbors;
+            for (UINT face = 0; face < g_nFacePerCell; face++) {
+                UINT adjCell = adjCells[cell * g_nFacePerCell + face];
+                if (adjCell < numCells && !seen[adjCell])
+                    neighbors.push_back(make_pair(degree[adjCell], adjCell));
+            }
+            sort(neighbors.begin(), neighbors.end());
+            for (const pair<UINT,UINT> &neighbor : neighbors) {
+                seen[neighbor.second] = true;
+                cells.push_back(neighbor.second);
+            }
+        }
+    };
+    
+    
+    // Cuthill-McKee order of each connected piece
+    order.clear();
+    order.reserve(numCells);
+    vector<pair<UINT,UINT>> byDegree(numCells);
+    for (UINT cell = 0; cell < numCells; cell++) {
+        byDegree[cell] = make_pair(degree[cell], cell);
+    }
+    sort(byDegree.begin(), byDegree.end());
+    
+    for (const pair<UINT,UINT> &cellDegree : byDegree) {
+        UINT cell = cellDegree.second;
+        if (visited[cell])
+            continue;
+        
+        // The last cell found from a low degree cell is far from it
+        vector<UINT> piece;
+        vector<bool> seen(visited);
+        bfs(cell, piece, seen);
+        bfs(piece.back(), order, visited);
+    }
+    
+    
+    // Reverse
+    reverse(order.begin(), order.end());
+    Assert(order.size() == numCells);
+}
+
+
+/*
+    calcTiles
+    
+    Splits the Morton order of the local cells into tiles of cellsPerTile
+    cells.  tiles[cell] is the tile of each cell.
+*/
+void calcTiles(const UINT cellsPerTile, vector<UINT> &tiles)
+{
+    Insist(cellsPerTile > 0, "Tiles need at least one cell.");
+    
+    vector<UINT> order;
+    mortonOrder(order);
+    
+    tiles.resize(g_nCells);
+    for (UINT i = 0; i < g_nCells; i++) {
+        tiles[order[i]] = i / cellsPerTile;
+    }
+}
+
+} // End namespace CellOrdering
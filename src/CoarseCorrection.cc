@@ -0,0 +1,375 @@
+/*
+Copyright (c) 2016, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2016. Los Alamos National Security, LLC. This software was produced 
+under U.S. Government contract DE-AC52-06NA25396 for Los Alamos National 
+Laboratory (LANL), which is operated by Los Alamos National Security, LLC for 
+the U.S. Department of Energy. The U.S. Government has rights to use, 
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR LOS 
+ALAMOS NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR 
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified 
+to produce derivative works, such modified software should be clearly marked, 
+so as not to confuse it with the version available from LANL.
+
+Additionally, redistribution and use in source and binary forms, with or 
+without modification, are permitted provided that the following conditions 
+are met:
+1.      Redistributions of source code must retain the above copyright notice, 
+        this list of conditions and the following disclaimer.
+2.      Redistributions in binary form must reproduce the above copyright 
+        notice, this list of conditions and the following disclaimer in the 
+        documentation and/or other materials provided with the distribution.
+3.      Neither the name of Los Alamos National Security, LLC, Los Alamos 
+        National Laboratory, LANL, the U.S. Government, nor the names of its 
+        contributors may be used to endorse or promote products derived from 
+        this software without specific prior written permission.
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND 
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT 
+NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS ALAMOS NATIONAL 
+SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; 
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "CoarseCorrection.hh"
+#include "Global.hh"
+#include "TychoMesh.hh"
+#include "Quadrature.hh"
+#include "Comm.hh"
+#include "Util.hh"
+#include "Assert.hh"
+#include <map>
+#include <math.h>
+
+using namespace std;
+
+
+namespace
+{
+
+// Tolerance and maximum iterations of the coarse solve
+// c_tag is the MPI tag for coarse values
+const double c_rtol = 1e-10;
+const UINT c_iterMax = 1000;
+const int c_tag = 4;
+
+
+/*
+    getOctant
+    
+    Octant bits are set for positive mu, eta, and xi.
+*/
+UINT getOctant(UINT angle)
+{
+    UINT octant = 0;
+    if (g_quadrature->getMu(angle) > 0.0)
+        octant += 1;
+    if (g_quadrature->getEta(angle) > 0.0)
+        octant += 2;
+    if (g_quadrature->getXi(angle) > 0.0)
+        octant += 4;
+    return octant;
+}
+
+
+/*
+    sweepLocal
+    
+    Local solve without scattering.
+*/
+void sweepLocal(PsiData &psi, PsiBoundData &psiBound)
+{
+    PsiData zeroSource;
+    Util::sweepLocal(psi, zeroSource, psiBound);
+}
+
+
+/*
+    sweepLocalScattering
+    
+    Local solve with scattering, (L_I - MSD) psi = L_B psiBound.
+    Source iteration with local sweeps, without output or DSA, converged to
+    errMax or stopped after iterMax sweeps.  The error is global so all 
+    ranks do the same number of sweeps, which the traversal timers need.
+*/
+void sweepLocalScattering(PsiData &psi, PsiBoundData &psiBound)
+{
+    PsiData zeroSource;
+    PsiData totalSource;
+    PhiData phiNew;
+    PhiData phiOld;
+    
+    psi.setToValue(0.0);
+    phiNew.setToValue(0.0);
+    for (UINT iter = 0; iter < g_iterMax; iter++) {
+        
+        for (UINT i = 0; i < phiOld.size(); i++) {
+            phiOld[i] = phiNew[i];
+        }
+        Util::calcTotalSource(zeroSource, phiOld, totalSource);
+        Util::sweepLocal(psi, totalSource, psiBound);
+        Util::psiToPhi(phiNew, psi);
+        
+        double error = 0.0;
+        double norm = 0.0;
+        for (UINT i = 0; i < phiNew.size(); i++) {
+            error += fabs(phiNew[i] - phiOld[i]);
+            norm += fabs(phiNew[i]);
+        }
+        Comm::gsum(error);
+        Comm::gsum(norm);
+        if (error <= g_errMax * norm)
+            break;
+    }
+}
+
+
+/*
+    coarseOperator
+    
+    Operator for the Krylov solver.
+*/
+void coarseOperator(const double *x, double *y, void *voidData)
+{
+    CoarseCorrection *coarseCorrection = (CoarseCorrection*) voidData;
+    coarseCorrection->applyOperator(x, y);
+}
+
+} // End anonymous namespace
+
+
+/*
+    CoarseCorrection
+    
+    Finds the incoming boundary data and builds the coarse operator.
+*/
+CoarseCorrection::CoarseCorrection(CommSides &commSides, bool scattering)
+{
+    const UINT numCoarse = c_numOctants * g_nGroups;
+    const UINT numValues = g_nGroups * g_nVrtxPerFace;
+    c_numIterations = 0;
+    
+    // Incoming boundary data from other ranks and the partial current 
+    // weights
+    map<UINT,UINT> adjRankToIndex;
+    vector<double> weightSum(c_numOctants, 0.0);
+    for (UINT cell = 0; cell < g_nCells; cell++) {
+    for (UINT face = 0; face < g_nFacePerCell; face++) {
+        UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
+        UINT adjRank = g_tychoMesh->getAdjRank(cell, face);
+        if (adjCell != TychoMesh::BOUNDARY_FACE || 
+            adjRank == TychoMesh::BAD_RANK)
+        {
+            continue;
+        }
+        
+        if (adjRankToIndex.count(adjRank) == 0) {
+            adjRankToIndex[adjRank] = c_adjRanks.size();
+            c_adjRanks.push_back(adjRank);
+        }
+        
+        double area = g_tychoMesh->getFaceArea(cell, face);
+        for (UINT angle = 0; angle < g_nAngles; angle++) {
+            if (g_tychoMesh->isIncoming(angle, cell, face)) {
+                Entry entry;
+                entry.side = g_tychoMesh->getSide(cell, face);
+                entry.angle = angle;
+                entry.octant = getOctant(angle);
+                entry.adjRankIndex = adjRankToIndex[adjRank];
+                entry.weight = g_quadrature->getWt(angle) * area * 
+                    fabs(g_tychoMesh->getOmegaDotN(angle, cell, face));
+                weightSum[entry.octant] += entry.weight;
+                c_entries.push_back(entry);
+            }
+        }
+    }}
+    
+    for (UINT i = 0; i < c_entries.size(); i++) {
+        double sum = weightSum[c_entries[i].octant];
+        if (sum > 0.0)
+            c_entries[i].weight /= g_nVrtxPerFace * sum;
+    }
+    
+    
+    // Apply K to incoming data of one on each octant
+    PsiData psi;
+    PsiBoundData psiBound;
+    c_responses.resize(c_entries.size() * c_numOctants * numValues);
+    for (UINT octant = 0; octant < c_numOctants; octant++) {
+        psiBound.setToValue(0.0);
+        for (UINT i = 0; i < c_entries.size(); i++) {
+            const Entry &entry = c_entries[i];
+            if (entry.octant != octant)
+                continue;
+            for (UINT group = 0; group < g_nGroups; group++) {
+            for (UINT fvrtx = 0; fvrtx < g_nVrtxPerFace; fvrtx++) {
+                psiBound(group, fvrtx, entry.angle, entry.side) = 1.0;
+            }}
+        }
+        
+        if (scattering)
+            sweepLocalScattering(psi, psiBound);
+        else
+            sweepLocal(psi, psiBound);
+        commSides.commSides(psi, psiBound);
+        
+        for (UINT i = 0; i < c_entries.size(); i++) {
+            const Entry &entry = c_entries[i];
+            double *response = 
+                &c_responses[(i * c_numOctants + octant) * numValues];
+            for (UINT group = 0; group < g_nGroups; group++) {
+            for (UINT fvrtx = 0; fvrtx < g_nVrtxPerFace; fvrtx++) {
+                response[group * g_nVrtxPerFace + fvrtx] = 
+                    psiBound(group, fvrtx, entry.angle, entry.side);
+            }}
+        }
+    }
+    
+    
+    // Coarse operator rows
+    c_couplings.assign(c_adjRanks.size() * c_numOctants * numCoarse, 0.0);
+    for (UINT i = 0; i < c_entries.size(); i++) {
+        const Entry &entry = c_entries[i];
+        for (UINT adjOctant = 0; adjOctant < c_numOctants; adjOctant++) {
+            const double *response = 
+                &c_responses[(i * c_numOctants + adjOctant) * numValues];
+            double *couplings = &c_couplings[
+                ((entry.adjRankIndex * c_numOctants + entry.octant) * 
+                c_numOctants + adjOctant) * g_nGroups];
+            for (UINT group = 0; group < g_nGroups; group++) {
+            for (UINT fvrtx = 0; fvrtx < g_nVrtxPerFace; fvrtx++) {
+                couplings[group] += entry.weight * 
+                    response[group * g_nVrtxPerFace + fvrtx];
+            }}
+        }
+    }
+    
+    c_adjValues.resize(c_adjRanks.size(), vector<double>(numCoarse));
+    c_krylovSolver = 
+        new KrylovSolver(numCoarse, c_rtol, c_iterMax, coarseOperator);
+    c_krylovSolver->setData(this);
+}
+
+
+/*
+    ~CoarseCorrection
+*/
+CoarseCorrection::~CoarseCorrection()
+{
+    delete c_krylovSolver;
+}
+
+
+/*
+    exchange
+    
+    Sends this rank's coarse values to the adjacent ranks and receives 
+    theirs in c_adjValues.
+*/
+void CoarseCorrection::exchange(const double *c)
+{
+    const vector<double> sendData(c, c + c_numOctants * g_nGroups);
+    vector<MPI_Request> requests(c_adjRanks.size());
+    for (UINT i = 0; i < c_adjRanks.size(); i++) {
+        Comm::iSendDoubleVector(sendData, c_adjRanks[i], c_tag, requests[i]);
+    }
+    for (UINT i = 0; i < c_adjRanks.size(); i++) {
+        Comm::recvDoubleVector(c_adjValues[i], c_adjRanks[i], c_tag);
+    }
+    
+    int mpiError = MPI_Waitall(requests.size(), requests.data(), 
+                               MPI_STATUSES_IGNORE);
+    Insist(mpiError == MPI_SUCCESS, "");
+}
+
+
+/*
+    applyOperator
+    
+    y = (I - K_c) c
+*/
+void CoarseCorrection::applyOperator(const double *c, double *y)
+{
+    const UINT numCoarse = c_numOctants * g_nGroups;
+    exchange(c);
+    
+    for (UINT j = 0; j < numCoarse; j++) {
+        y[j] = c[j];
+    }
+    
+    for (UINT i = 0; i < c_adjRanks.size(); i++) {
+    for (UINT octant = 0; octant < c_numOctants; octant++) {
+    for (UINT adjOctant = 0; adjOctant < c_numOctants; adjOctant++) {
+        const double *couplings = &c_couplings[
+            ((i * c_numOctants + octant) * c_numOctants + adjOctant) * 
+            g_nGroups];
+        const double *adjValues = &c_adjValues[i][adjOctant * g_nGroups];
+        for (UINT group = 0; group < g_nGroups; group++) {
+            y[octant * g_nGroups + group] -= 
+                couplings[group] * adjValues[group];
+        }
+    }}}
+}
+
+
+/*
+    addCorrection
+    
+    Adds K P c to the incoming boundary data, where c is the coarse 
+    correction for the change made by an iteration.  K P c is the sum of 
+    the responses to each octant scaled by the correction of the rank the 
+    data came from.  change and psiBound may be the same.
+*/
+void CoarseCorrection::addCorrection(const PsiBoundData &change, 
+                                     PsiBoundData &psiBound)
+{
+    const UINT numValues = g_nGroups * g_nVrtxPerFace;
+    
+    
+    // Restrict the change
+    double *b = c_krylovSolver->getB();
+    for (UINT j = 0; j < c_numOctants * g_nGroups; j++) {
+        b[j] = 0.0;
+    }
+    for (UINT i = 0; i < c_entries.size(); i++) {
+        const Entry &entry = c_entries[i];
+        for (UINT group = 0; group < g_nGroups; group++) {
+        for (UINT fvrtx = 0; fvrtx < g_nVrtxPerFace; fvrtx++) {
+            b[entry.octant * g_nGroups + group] += entry.weight * 
+                change(group, fvrtx, entry.angle, entry.side);
+        }}
+    }
+    c_krylovSolver->releaseB();
+    
+    
+    // Solve and get the corrections of the adjacent ranks
+    c_krylovSolver->solve();
+    c_numIterations += c_krylovSolver->getNumIterations();
+    
+    double *x = c_krylovSolver->getX();
+    exchange(x);
+    c_krylovSolver->releaseX();
+    
+    
+    // Add K P c
+    for (UINT i = 0; i < c_entries.size(); i++) {
+        const Entry &entry = c_entries[i];
+        const vector<double> &correction = c_adjValues[entry.adjRankIndex];
+        for (UINT adjOctant = 0; adjOctant < c_numOctants; adjOctant++) {
+            const double *response = 
+                &c_responses[(i * c_numOctants + adjOctant) * numValues];
+            for (UINT group = 0; group < g_nGroups; group++) {
+            for (UINT fvrtx = 0; fvrtx < g_nVrtxPerFace; fvrtx++) {
+                psiBound(group, fvrtx, entry.angle, entry.side) += 
+                    response[group * g_nVrtxPerFace + fvrtx] * 
+                    correction[adjOctant * g_nGroups + group];
+            }}
+        }
+    }
+}
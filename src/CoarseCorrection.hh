@@ -0,0 +1,124 @@
+/*
+Copyright (c) 2016, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2016. Los Alamos National Security, LLC. This software was produced 
+under U.S. Government contract DE-AC52-06NA25396 for Los Alamos National 
+Laboratory (LANL), which is operated by Los Alamos National Security, LLC for 
+the U.S. Department of Energy. The U.S. Government has rights to use, 
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR LOS 
+ALAMOS NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR 
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified 
+to produce derivative works, such modified software should be clearly marked, 
+so as not to confuse it with the version available from LANL.
+
+Additionally, redistribution and use in source and binary forms, with or 
+without modification, are permitted provided that the following conditions 
+are met:
+1.      Redistributions of source code must retain the above copyright notice, 
+        this list of conditions and the following disclaimer.
+2.      Redistributions in binary form must reproduce the above copyright 
+        notice, this list of conditions and the following disclaimer in the 
+        documentation and/or other materials provided with the distribution.
+3.      Neither the name of Los Alamos National Security, LLC, Los Alamos 
+        National Laboratory, LANL, the U.S. Government, nor the names of its 
+        contributors may be used to endorse or promote products derived from 
+        this software without specific prior written permission.
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND 
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT 
+NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS ALAMOS NATIONAL 
+SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; 
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __COARSE_CORRECTION_HH__
+#define __COARSE_CORRECTION_HH__
+
+#include "Global.hh"
+#include "PsiData.hh"
+#include "CommSides.hh"
+#include "KrylovSolver.hh"
+#include <vector>
+
+
+/*
+    CoarseCorrection class
+    
+    Two-level acceleration of the domain decomposition iterations on the
+    boundary data psiBound,
+        psiBound^{n+1} = K psiBound^n + b,
+    where K is a solve of each partition from its incoming boundary data
+    with zero source followed by communication of the outgoing data.  Since
+    K only moves data one partition per iteration, the error in psiBound is 
+    corrected by the solution of a coarse problem on the partition graph.
+    
+    The coarse space has one unknown per partition, octant, and group:
+    a constant added to all of the partition's incoming boundary data for
+    angles of the octant and the group (prolongation P).  Coarse values of
+    boundary data are averages weighted by the incoming partial current 
+    (restriction R).  Groups are independent, so eight applications of K, 
+    each from incoming data of one for a single octant, give K P and the 
+    coarse operator K_c = R K P.  The local solve is a sweep, or with 
+    scattering a quiet source iteration on each rank.
+    
+    For the change d = psiBound^{n+1} - psiBound^n made by an iteration,
+    which is the residual of psiBound^n, the coarse correction c of 
+    psiBound^n solves
+        (I - K_c) c = R d.
+    Instead of iterating again from psiBound^n + P c, K P c is added to
+    psiBound^{n+1}.  This is exact if the error of psiBound^n is constant 
+    on each coarse block.  K_c only couples a partition to its neighbors, 
+    so the coarse problem is solved in parallel with a Krylov method, 
+    exchanging coarse values with adjacent ranks.
+*/
+class CoarseCorrection
+{
+public:
+    CoarseCorrection(CommSides &commSides, bool scattering = false);
+    ~CoarseCorrection();
+    void addCorrection(const PsiBoundData &change, PsiBoundData &psiBound);
+    void applyOperator(const double *c, double *y);
+    UINT getNumIterations() const { return c_numIterations; }
+
+private:
+    // Incoming internal boundary data for one (side, angle) pair
+    // The weight includes the normalization of the coarse average
+    struct Entry
+    {
+        UINT side;
+        UINT angle;
+        UINT octant;
+        UINT adjRankIndex;
+        double weight;
+    };
+    
+    static const UINT c_numOctants = 8;
+    
+    void exchange(const double *c);
+    
+    // Local data
+    // c_responses are K P for coarse vectors of one on each octant with 
+    // values ((entry * c_numOctants + octant) * g_nGroups + group) * 
+    // g_nVrtxPerFace + fvrtx
+    std::vector<Entry> c_entries;
+    std::vector<UINT> c_adjRanks;
+    std::vector<double> c_responses;
+    
+    // Coarse operator rows of this rank
+    // Couplings are ((adjRankIndex * c_numOctants + octant) * 
+    // c_numOctants + adjOctant) * g_nGroups + group
+    // c_adjValues[i] are the coarse values of adjacent rank i
+    std::vector<double> c_couplings;
+    std::vector<std::vector<double>> c_adjValues;
+    
+    KrylovSolver *c_krylovSolver;
+    UINT c_numIterations;
+};
+
+#endif
@@ -124,6 +124,21 @@ void gsum(UINT &x)
 }
 
 
+/*
+    gsum
+    
+    Elementwise sums x from all ranks in one reduction.
+    x must be the same size on all ranks.
+*/
+void gsum(std::vector<double> &x)
+{
+    std::vector<double> send = x;
+    int result = MPI_Allreduce(send.data(), x.data(), x.size(), MPI_DOUBLE, 
+                               MPI_SUM, MPI_COMM_WORLD);
+    Insist(result == MPI_SUCCESS, "Comm::gsum(vector<double>) MPI error.\n");
+}
+
+
 /*
     gmax
     
@@ -171,6 +186,21 @@ void gmax(UINT &x)
 }
 
 
+/*
+    gmax
+    
+    Calculates elementwise max of x from all ranks.
+    x must be the same size on all ranks.
+*/
+void gmax(std::vector<UINT> &x)
+{
+    std::vector<UINT> send = x;
+    int result = MPI_Allreduce(send.data(), x.data(), x.size(), MPI_UINT64_T, 
+                               MPI_MAX, MPI_COMM_WORLD);
+    Insist(result == MPI_SUCCESS, "Comm::gmax(vector<int>) MPI error.\n");
+}
+
+
 /*
     sendUint
 
@@ -267,6 +297,28 @@ void recvUIntVector(std::vector<UINT> &buffer, int destination, int tag)
 }
 
 
+/*
+    probeRecvUIntVector
+    
+    Blocking receive of an int vector whose size isn't known ahead of time.
+    buffer is resized to fit the message.
+*/
+void probeRecvUIntVector(std::vector<UINT> &buffer, int source, int tag)
+{
+    MPI_Status status;
+    int count;
+    int result = MPI_Probe(source, tag, MPI_COMM_WORLD, &status);
+    Insist(result == MPI_SUCCESS, "Comm::probeRecvUIntVector MPI error.\n");
+    result = MPI_Get_count(&status, MPI_UINT64_T, &count);
+    Insist(result == MPI_SUCCESS, "Comm::probeRecvUIntVector MPI error.\n");
+    
+    buffer.resize(count);
+    result = MPI_Recv(buffer.data(), count, MPI_UINT64_T, source, tag, 
+                      MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    Insist(result == MPI_SUCCESS, "Comm::probeRecvUIntVector MPI error.\n");
+}
+
+
 /*
     recvDoubleVector
     
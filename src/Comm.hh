@@ -54,9 +54,11 @@ int numRanks();
 
 void gsum(double &x);
 void gsum(UINT &x);
+void gsum(std::vector<double> &x);
 void gmax(double &x);
 void gmax(double &x, MPI_Comm comm);
 void gmax(UINT &x);
+void gmax(std::vector<UINT> &x);
 
 void sendUInt(UINT i, int destination);
 void sendUIntVector(const std::vector<UINT> &buffer, int destination);
@@ -68,6 +70,7 @@ void iSendDoubleVector(const std::vector<double> &buffer, int destination,
 void recvUInt(UINT &i, int destination);
 void recvUIntVector(std::vector<UINT> &buffer, int destination);
 void recvUIntVector(std::vector<UINT> &buffer, int destination, int tag);
+void probeRecvUIntVector(std::vector<UINT> &buffer, int source, int tag);
 void recvDoubleVector(std::vector<double> &buffer, int destination, int tag);
 
 void barrier();
@@ -44,6 +44,11 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <string.h>
 
 
+// MPI tags of the async messages and of the counts sent by finishAsync
+static const int c_asyncTag = 5;
+static const int c_countTag = 6;
+
+
 /*
     Constructor
 */
@@ -113,6 +118,87 @@ static UINT getDataSize()
 }
 
 
+/*
+    getPacketSize
+
+    Returns size of a packet: global side, angle, and the data.
+*/
+static UINT getPacketSize()
+{
+    return 2 * sizeof(UINT) + getDataSize();
+}
+
+
+/*
+    packSides
+    
+    Packs the outgoing data of psi for an adjacent rank.
+*/
+void CommSides::packSides(const PsiData &psi, UINT rankIndex, 
+                          std::vector<char> &data) const
+{
+    UINT packetSize = getPacketSize();
+    Mat2<double> localFaceData(g_nVrtxPerFace, g_nGroups);
+    data.resize(packetSize * c_numSendPackets[rankIndex]);
+    
+    for (UINT metaDataIndex = 0; 
+         metaDataIndex < c_sendMetaData[rankIndex].size(); 
+         metaDataIndex++)
+    {
+        UINT gSide = c_sendMetaData[rankIndex][metaDataIndex].gSide;
+        UINT angle = c_sendMetaData[rankIndex][metaDataIndex].angle;
+        UINT cell  = c_sendMetaData[rankIndex][metaDataIndex].cell;
+        UINT face  = c_sendMetaData[rankIndex][metaDataIndex].face;
+        
+        for (UINT group = 0; group < g_nGroups; group++) {
+        for (UINT fvrtx = 0; fvrtx < g_nVrtxPerFace; fvrtx++) {
+            UINT vrtx = g_tychoMesh->getFaceToCellVrtx(cell, face, fvrtx);
+            localFaceData(fvrtx, group) = psi(group, vrtx, angle, cell);
+        }}
+
+        const char *faceData = (char*) (&localFaceData[0]);
+        
+        char *ptr = &data[metaDataIndex * packetSize];
+        memcpy(ptr, &gSide, sizeof(UINT));
+        ptr += sizeof(UINT);
+        memcpy(ptr, &angle, sizeof(UINT));
+        ptr += sizeof(UINT);
+        memcpy(ptr, faceData, getDataSize());
+    }
+}
+
+
+/*
+    unpackSides
+    
+    Puts data received from an adjacent rank in psiBound.
+*/
+void CommSides::unpackSides(const std::vector<char> &data, 
+                            PsiBoundData &psiBound) const
+{
+    UINT packetSize = getPacketSize();
+    Mat2<double> localFaceData(g_nVrtxPerFace, g_nGroups);
+    
+    UINT numPackets = data.size() / packetSize;
+    for (UINT packetIndex = 0; packetIndex < numPackets; packetIndex++) {
+        const char *ptr = &data[packetIndex * packetSize];
+        UINT gSide = 0;
+        UINT angle = 0;
+        memcpy(&gSide, ptr, sizeof(UINT));
+        ptr += sizeof(UINT);
+        memcpy(&angle, ptr, sizeof(UINT));
+        ptr += sizeof(UINT);
+        UINT side = g_tychoMesh->getGLSide(gSide);
+
+        memcpy(&localFaceData[0], ptr, getDataSize());
+        for (UINT fvrtx = 0; fvrtx < g_nVrtxPerFace; fvrtx++) {
+        for (UINT group = 0; group < g_nGroups; group++) {
+            psiBound(group, fvrtx, angle, side) = localFaceData(fvrtx, group);
+        }}
+    }
+}
+
+
 /*
     commSides
 */
@@ -121,17 +207,15 @@ void CommSides::commSides(PsiData &psi, PsiBoundData &psiBound)
     int mpiError;
     UINT numToRecv;
     UINT numAdjRanks = c_adjRanks.size();
-    UINT packetSize = 2 * sizeof(UINT) + getDataSize();
+    UINT packetSize = getPacketSize();
     std::vector<MPI_Request> mpiRecvRequests(numAdjRanks);
     std::vector<MPI_Request> mpiSendRequests(numAdjRanks);
     std::vector<std::vector<char>> dataToSend(numAdjRanks);
     std::vector<std::vector<char>> dataToRecv(numAdjRanks);
-    Mat2<double> localFaceData(g_nVrtxPerFace, g_nGroups);
     
     
-    // Data structures to send/recv packets
+    // Data structures to recv packets
     for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
-        dataToSend[rankIndex].resize(packetSize * c_numSendPackets[rankIndex]);
         dataToRecv[rankIndex].resize(packetSize * c_numRecvPackets[rankIndex]);
     }
     
@@ -162,31 +246,8 @@ void CommSides::commSides(PsiData &psi, PsiBoundData &psiBound)
     // Update data to send and Isend it
     for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
         
-        if (dataToSend[rankIndex].size() > 0) {
-            for (UINT metaDataIndex = 0; 
-                 metaDataIndex < c_sendMetaData[rankIndex].size(); 
-                 metaDataIndex++)
-            {
-                UINT gSide = c_sendMetaData[rankIndex][metaDataIndex].gSide;
-                UINT angle = c_sendMetaData[rankIndex][metaDataIndex].angle;
-                UINT cell  = c_sendMetaData[rankIndex][metaDataIndex].cell;
-                UINT face  = c_sendMetaData[rankIndex][metaDataIndex].face;
-                
-                for (UINT group = 0; group < g_nGroups; group++) {
-                for (UINT fvrtx = 0; fvrtx < g_nVrtxPerFace; fvrtx++) {
-                    UINT vrtx = g_tychoMesh->getFaceToCellVrtx(cell, face, fvrtx);
-                    localFaceData(fvrtx, group) = psi(group, vrtx, angle, cell);
-                }}
-
-                const char *data = (char*) (&localFaceData[0]);
-                
-                char *ptr = &dataToSend[rankIndex][metaDataIndex * packetSize];
-                memcpy(ptr, &gSide, sizeof(UINT));
-                ptr += sizeof(UINT);
-                memcpy(ptr, &angle, sizeof(UINT));
-                ptr += sizeof(UINT);
-                memcpy(ptr, data, getDataSize());
-            }
+        if (c_numSendPackets[rankIndex] > 0) {
+            packSides(psi, rankIndex, dataToSend[rankIndex]);
             
             int tag = 0;
             int adjRank = c_adjRanks[rankIndex];
@@ -216,23 +277,7 @@ void CommSides::commSides(PsiData &psi, PsiBoundData &psiBound)
         
         
         // Process Data
-        UINT numPackets = dataToRecv[rankIndex].size() / packetSize;
-        for (UINT packetIndex = 0; packetIndex < numPackets; packetIndex++) {
-            char *ptr = &dataToRecv[rankIndex][packetIndex * packetSize];
-            UINT gSide = 0;
-            UINT angle = 0;
-            memcpy(&gSide, ptr, sizeof(UINT));
-            ptr += sizeof(UINT);
-            memcpy(&angle, ptr, sizeof(UINT));
-            ptr += sizeof(UINT);
-            UINT side = g_tychoMesh->getGLSide(gSide);
-
-            localFaceData.setData((double*)ptr);
-            for (UINT fvrtx = 0; fvrtx < g_nVrtxPerFace; fvrtx++) {
-            for (UINT group = 0; group < g_nGroups; group++) {
-                psiBound(group, fvrtx, angle, side) = localFaceData(fvrtx, group);
-            }}
-        }
+        unpackSides(dataToRecv[rankIndex], psiBound);
     }
     
     
@@ -244,3 +289,242 @@ void CommSides::commSides(PsiData &psi, PsiBoundData &psiBound)
     }
 }
 
+
+/*
+    startAsync
+    
+    Posts a receive for each adjacent rank that sends data and resets the 
+    message counts.  Messages use their own tag so they can't be mixed up 
+    with the ones of commSides.
+*/
+void CommSides::startAsync()
+{
+    UINT numAdjRanks = c_adjRanks.size();
+    c_asyncRecvRequests.assign(numAdjRanks, MPI_REQUEST_NULL);
+    c_asyncRecvData.resize(numAdjRanks);
+    c_asyncSends.assign(numAdjRanks, std::list<AsyncSend>());
+    c_numAsyncSent.assign(numAdjRanks, 0);
+    c_numAsyncRecv.assign(numAdjRanks, 0);
+    
+    for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+        c_asyncRecvData[rankIndex].resize(
+            getPacketSize() * c_numRecvPackets[rankIndex]);
+        if (c_numRecvPackets[rankIndex] > 0)
+            postAsyncRecv(rankIndex);
+    }
+}
+
+
+/*
+    postAsyncRecv
+*/
+void CommSides::postAsyncRecv(UINT rankIndex)
+{
+    int mpiError = MPI_Irecv(c_asyncRecvData[rankIndex].data(), 
+                             c_asyncRecvData[rankIndex].size(), 
+                             MPI_BYTE, c_adjRanks[rankIndex], c_asyncTag, 
+                             MPI_COMM_WORLD, &c_asyncRecvRequests[rankIndex]);
+    Insist(mpiError == MPI_SUCCESS, "");
+}
+
+
+/*
+    sendAsync
+    
+    Sends the outgoing data of psi to the adjacent ranks without waiting.
+    Earlier sends that completed are freed.
+*/
+void CommSides::sendAsync(const PsiData &psi)
+{
+    for (UINT rankIndex = 0; rankIndex < c_adjRanks.size(); rankIndex++) {
+        
+        if (c_numSendPackets[rankIndex] == 0)
+            continue;
+        
+        std::list<AsyncSend> &sends = c_asyncSends[rankIndex];
+        std::list<AsyncSend>::iterator it = sends.begin();
+        while (it != sends.end()) {
+            int done;
+            int mpiError = MPI_Test(&it->request, &done, MPI_STATUS_IGNORE);
+            Insist(mpiError == MPI_SUCCESS, "");
+            if (done)
+                it = sends.erase(it);
+            else
+                ++it;
+        }
+        
+        sends.push_back(AsyncSend());
+        AsyncSend &send = sends.back();
+        packSides(psi, rankIndex, send.data);
+        int mpiError = MPI_Isend(send.data.data(), send.data.size(), 
+                                 MPI_BYTE, c_adjRanks[rankIndex], c_asyncTag, 
+                                 MPI_COMM_WORLD, &send.request);
+        Insist(mpiError == MPI_SUCCESS, "");
+        c_numAsyncSent[rankIndex]++;
+    }
+}
+
+
+/*
+    recvAsync
+    
+    Puts all messages that arrived in psiBound without waiting.
+    Messages from a rank arrive in order, so its latest data is kept.
+    Returns true if any message arrived.
+*/
+bool CommSides::recvAsync(PsiBoundData &psiBound)
+{
+    bool received = false;
+    for (UINT rankIndex = 0; rankIndex < c_adjRanks.size(); rankIndex++) {
+        
+        if (c_numRecvPackets[rankIndex] == 0)
+            continue;
+        
+        while (true) {
+            int done;
+            int mpiError = MPI_Test(&c_asyncRecvRequests[rankIndex], &done, 
+                                    MPI_STATUS_IGNORE);
+            Insist(mpiError == MPI_SUCCESS, "");
+            if (!done)
+                break;
+            
+            unpackSides(c_asyncRecvData[rankIndex], psiBound);
+            c_numAsyncRecv[rankIndex]++;
+            received = true;
+            postAsyncRecv(rankIndex);
+        }
+    }
+    
+    return received;
+}
+
+
+/*
+    waitAsync
+    
+    Waits until a message arrives or request completes.  Messages that 
+    arrived are put in psiBound.  Returns true if any message arrived.
+*/
+bool CommSides::waitAsync(PsiBoundData &psiBound, MPI_Request &request)
+{
+    UINT numAdjRanks = c_adjRanks.size();
+    std::vector<MPI_Request> requests(c_asyncRecvRequests);
+    requests.push_back(request);
+    
+    int index;
+    int mpiError = MPI_Waitany(requests.size(), requests.data(), &index, 
+                               MPI_STATUS_IGNORE);
+    Insist(mpiError == MPI_SUCCESS, "");
+    Insist(index != MPI_UNDEFINED, "CommSides::waitAsync has no requests.");
+    
+    if ((UINT)index == numAdjRanks) {
+        request = requests[index];
+        return false;
+    }
+    
+    c_asyncRecvRequests[index] = requests[index];
+    unpackSides(c_asyncRecvData[index], psiBound);
+    c_numAsyncRecv[index]++;
+    postAsyncRecv(index);
+    recvAsync(psiBound);
+    return true;
+}
+
+
+/*
+    finishAsync
+    
+    Counted drain: the adjacent ranks tell each other how many messages 
+    they sent, and each rank waits for the ones it hasn't received yet.
+    Then the extra posted receives are cancelled and the sends completed.
+    Every rank must call this.
+*/
+void CommSides::finishAsync(PsiBoundData &psiBound)
+{
+    int mpiError;
+    UINT numAdjRanks = c_adjRanks.size();
+    std::vector<std::vector<UINT>> numSent(numAdjRanks);
+    std::vector<MPI_Request> requests(numAdjRanks);
+    
+    
+    // Exchange counts
+    for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+        numSent[rankIndex].assign(1, c_numAsyncSent[rankIndex]);
+        Comm::iSendUIntVector(numSent[rankIndex], c_adjRanks[rankIndex], 
+                              c_countTag, requests[rankIndex]);
+    }
+    
+    for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+        std::vector<UINT> numToRecv(1);
+        Comm::recvUIntVector(numToRecv, c_adjRanks[rankIndex], c_countTag);
+        
+        
+        // Receive the rest of the messages
+        while (c_numAsyncRecv[rankIndex] < numToRecv[0]) {
+            mpiError = MPI_Wait(&c_asyncRecvRequests[rankIndex], 
+                                MPI_STATUS_IGNORE);
+            Insist(mpiError == MPI_SUCCESS, "");
+            unpackSides(c_asyncRecvData[rankIndex], psiBound);
+            c_numAsyncRecv[rankIndex]++;
+            postAsyncRecv(rankIndex);
+        }
+        
+        
+        // Cancel the posted receive
+        if (c_asyncRecvRequests[rankIndex] != MPI_REQUEST_NULL) {
+            mpiError = MPI_Cancel(&c_asyncRecvRequests[rankIndex]);
+            Insist(mpiError == MPI_SUCCESS, "");
+            mpiError = MPI_Wait(&c_asyncRecvRequests[rankIndex], 
+                                MPI_STATUS_IGNORE);
+            Insist(mpiError == MPI_SUCCESS, "");
+        }
+    }
+    
+    
+    // Complete the sends
+    if (numAdjRanks > 0) {
+        mpiError = MPI_Waitall(requests.size(), requests.data(), 
+                               MPI_STATUSES_IGNORE);
+        Insist(mpiError == MPI_SUCCESS, "");
+    }
+    
+    for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
+        std::list<AsyncSend> &sends = c_asyncSends[rankIndex];
+        std::list<AsyncSend>::iterator it;
+        for (it = sends.begin(); it != sends.end(); ++it) {
+            mpiError = MPI_Wait(&it->request, MPI_STATUS_IGNORE);
+            Insist(mpiError == MPI_SUCCESS, "");
+        }
+        sends.clear();
+    }
+}
+
+
+/*
+    getNumAsyncSent
+    
+    Number of messages sent since startAsync.
+*/
+UINT CommSides::getNumAsyncSent() const
+{
+    UINT numSent = 0;
+    for (UINT rankIndex = 0; rankIndex < c_numAsyncSent.size(); rankIndex++) {
+        numSent += c_numAsyncSent[rankIndex];
+    }
+    return numSent;
+}
+
+
+/*
+    getNumAsyncRecv
+    
+    Number of messages received since startAsync.
+*/
+UINT CommSides::getNumAsyncRecv() const
+{
+    UINT numRecv = 0;
+    for (UINT rankIndex = 0; rankIndex < c_numAsyncRecv.size(); rankIndex++) {
+        numRecv += c_numAsyncRecv[rankIndex];
+    }
+    return numRecv;
+}
@@ -37,17 +37,37 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "PsiData.hh"
 #include <vector>
+#include <list>
+#include <mpi.h>
 
 
 #ifndef __COMMSIDES_HH__
 #define __COMMSIDES_HH__
 
 
+/*
+    CommSides class
+    
+    Sends outgoing boundary data of psi to the adjacent ranks and receives 
+    their data in psiBound.  commSides does a full exchange.  The async 
+    functions are for iterations that don't wait on the adjacent ranks: 
+    data is sent whenever a rank has it, and the latest data received 
+    is used.  Messages sent and received are counted, which finishAsync 
+    uses to receive all messages still coming.
+*/
 class CommSides
 {
 public:
     CommSides();
     void commSides(PsiData &psi, PsiBoundData &psiBound);
+    
+    void startAsync();
+    void sendAsync(const PsiData &psi);
+    bool recvAsync(PsiBoundData &psiBound);
+    bool waitAsync(PsiBoundData &psiBound, MPI_Request &request);
+    void finishAsync(PsiBoundData &psiBound);
+    UINT getNumAsyncSent() const;
+    UINT getNumAsyncRecv() const;
 
 private:
     struct MetaData
@@ -57,11 +77,31 @@ private:
         UINT cell;
         UINT face;
     };
+    
+    struct AsyncSend
+    {
+        MPI_Request request;
+        std::vector<char> data;
+    };
+    
+    void packSides(const PsiData &psi, UINT rankIndex, 
+                   std::vector<char> &data) const;
+    void unpackSides(const std::vector<char> &data, 
+                     PsiBoundData &psiBound) const;
+    void postAsyncRecv(UINT rankIndex);
 
     std::vector<UINT> c_adjRanks;
     std::vector<std::vector<CommSides::MetaData>> c_sendMetaData;
     std::vector<UINT> c_numSendPackets;
     std::vector<UINT> c_numRecvPackets;
+    
+    // Async state (see startAsync)
+    // Sends are kept until they complete
+    std::vector<MPI_Request> c_asyncRecvRequests;
+    std::vector<std::vector<char>> c_asyncRecvData;
+    std::vector<std::list<AsyncSend>> c_asyncSends;
+    std::vector<UINT> c_numAsyncSent;
+    std::vector<UINT> c_numAsyncRecv;
 };
 
 #endif
@@ -0,0 +1,587 @@
+/*
+Copyright (c) 2016, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2016. Los Alamos National Security, LLC. This software was produced 
+under U.S. Government contract DE-AC52-06NA25396 for Los Alamos National 
+Laboratory (LANL), which is operated by Los Alamos National Security, LLC for 
+the U.S. Department of Energy. The U.S. Government has rights to use, 
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR LOS 
+ALAMOS NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR 
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified 
+to produce derivative works, such modified software should be clearly marked, 
+so as not to confuse it with the version available from LANL.
+
+Additionally, redistribution and use in source and binary forms, with or 
+without modification, are permitted provided that the following conditions 
+are met:
+1.      Redistributions of source code must retain the above copyright notice, 
+        this list of conditions and the following disclaimer.
+2.      Redistributions in binary form must reproduce the above copyright 
+        notice, this list of conditions and the following disclaimer in the 
+        documentation and/or other materials provided with the distribution.
+3.      Neither the name of Los Alamos National Security, LLC, Los Alamos 
+        National Laboratory, LANL, the U.S. Government, nor the names of its 
+        contributors may be used to endorse or promote products derived from 
+        this software without specific prior written permission.
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND 
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT 
+NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS ALAMOS NATIONAL 
+SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; 
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "DSA.hh"
+#include "Global.hh"
+#include "TychoMesh.hh"
+#include "Comm.hh"
+#include "Assert.hh"
+#include <algorithm>
+#include <math.h>
+
+using namespace std;
+
+
+namespace
+{
+
+// MIP penalty constant c(p) = 2 p (p + 1) for linear elements
+const double c_penaltyConstant = 4.0;
+
+// Values exchanged per face and group: psi at the face vertices and the
+// normal flux
+const UINT c_numFaceValues = g_nVrtxPerFace + 1;
+
+// Tag for the face data exchange
+const int c_tag = 3;
+
+
+/*
+    exchangeFaceData
+    
+    Sends sendData[i] to adjRanks[i] and receives recvData[i] from it.
+    recvData[i] must already have the size of the data coming.
+*/
+void exchangeFaceData(const vector<UINT> &adjRanks, 
+                      const vector<vector<double>> &sendData,
+                      vector<vector<double>> &recvData)
+{
+    vector<MPI_Request> requests(adjRanks.size());
+    for (UINT i = 0; i < adjRanks.size(); i++) {
+        Comm::iSendDoubleVector(sendData[i], adjRanks[i], c_tag, requests[i]);
+    }
+    for (UINT i = 0; i < adjRanks.size(); i++) {
+        Comm::recvDoubleVector(recvData[i], adjRanks[i], c_tag);
+    }
+    
+    int mpiError = MPI_Waitall(requests.size(), requests.data(), 
+                               MPI_STATUSES_IGNORE);
+    Insist(mpiError == MPI_SUCCESS, "");
+}
+
+
+/*
+    invert4
+    
+    Inverts a 4x4 matrix with Gauss-Jordan elimination and partial pivoting.
+    a is (row, column) and is overwritten.
+*/
+void invert4(double a[4][4], double inverse[4][4])
+{
+    for (UINT i = 0; i < 4; i++) {
+    for (UINT j = 0; j < 4; j++) {
+        inverse[i][j] = (i == j) ? 1.0 : 0.0;
+    }}
+    
+    for (UINT col = 0; col < 4; col++) {
+        UINT pivot = col;
+        for (UINT row = col + 1; row < 4; row++) {
+            if (fabs(a[row][col]) > fabs(a[pivot][col]))
+                pivot = row;
+        }
+        Insist(a[pivot][col] != 0.0, "DSA: singular cell matrix.");
+        swap(a[pivot], a[col]);
+        swap(inverse[pivot], inverse[col]);
+        
+        double scale = 1.0 / a[col][col];
+        for (UINT j = 0; j < 4; j++) {
+            a[col][j] *= scale;
+            inverse[col][j] *= scale;
+        }
+        for (UINT row = 0; row < 4; row++) {
+            if (row == col)
+                continue;
+            double factor = a[row][col];
+            for (UINT j = 0; j < 4; j++) {
+                a[row][j] -= factor * a[col][j];
+                inverse[row][j] -= factor * inverse[col][j];
+            }
+        }
+    }
+}
+
+
+/*
+    dot
+    
+    Local part of the dot product of two phi vectors.
+*/
+double dot(const PhiData &x, const PhiData &y)
+{
+    double sum = 0.0;
+    for (UINT i = 0; i < x.size(); i++) {
+        sum += x[i] * y[i];
+    }
+    return sum;
+}
+
+} // End anonymous namespace
+
+
+/*
+    DSA::DSA
+    
+    Sets up the cell matrices and the faces shared with other ranks.
+*/
+DSA::DSA()
+{
+    Mat2<double> diffusionOverH(g_nFacePerCell, g_nCells);
+    vector<double> sigmaA(g_nCells);
+    
+    c_numIterations = 0;
+    c_numSolves = 0;
+    c_diffusion.resize(g_nCells);
+    c_selfMatrix.resize(g_nVrtxPerCell, g_nVrtxPerCell, g_nCells);
+    c_selfInverse.resize(g_nVrtxPerCell, g_nVrtxPerCell, g_nCells);
+    c_fluxWeights.resize(g_nVrtxPerCell, g_nFacePerCell, g_nCells);
+    c_penalty.resize(g_nFacePerCell, g_nCells);
+    c_adjFace.resize(g_nFacePerCell, g_nCells);
+    c_faceFlux.resize(g_nGroups, g_nFacePerCell, g_nCells);
+    c_remoteRankIndex.resize(g_nFacePerCell, g_nCells);
+    c_remoteEntry.resize(g_nFacePerCell, g_nCells);
+    
+    
+    // Basis gradients, flux weights and D / h for each cell
+    // Face f is opposite vertex f, so the gradient of basis function f is
+    // normal to face f and points into the cell
+    Mat3<double> gradients(g_ndim, g_nVrtxPerCell, g_nCells);
+    for (UINT cell = 0; cell < g_nCells; cell++) {
+        
+        Insist(g_sigmaT[cell] > 0.0, "DSA needs sigmaT > 0.");
+        c_diffusion[cell] = 1.0 / (3.0 * g_sigmaT[cell]);
+        sigmaA[cell] = g_sigmaT[cell] - g_sigmaS[cell];
+        
+        double coords[4][3];
+        for (UINT vrtx = 0; vrtx < g_nVrtxPerCell; vrtx++) {
+        for (UINT dim = 0; dim < g_ndim; dim++) {
+            UINT node = g_tychoMesh->getCellNode(cell, vrtx);
+            coords[vrtx][dim] = g_tychoMesh->getNodeCoord(node, dim);
+        }}
+        
+        for (UINT vrtx = 0; vrtx < g_nVrtxPerCell; vrtx++) {
+            UINT v0 = (vrtx + 1) % 4;
+            UINT v1 = (vrtx + 2) % 4;
+            UINT v2 = (vrtx + 3) % 4;
+            double e1[3], e2[3], normal[3];
+            for (UINT dim = 0; dim < g_ndim; dim++) {
+                e1[dim] = coords[v1][dim] - coords[v0][dim];
+                e2[dim] = coords[v2][dim] - coords[v0][dim];
+            }
+            normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+            normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+            normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+            double height = 0.0;
+            for (UINT dim = 0; dim < g_ndim; dim++) {
+                height += normal[dim] * (coords[vrtx][dim] - coords[v0][dim]);
+            }
+            for (UINT dim = 0; dim < g_ndim; dim++) {
+                gradients(dim, vrtx, cell) = normal[dim] / height;
+            }
+        }
+        
+        double volume = g_tychoMesh->getCellVolume(cell);
+        for (UINT face = 0; face < g_nFacePerCell; face++) {
+            double gradNorm = 0.0;
+            for (UINT dim = 0; dim < g_ndim; dim++) {
+                gradNorm += gradients(dim, face, cell) * 
+                            gradients(dim, face, cell);
+            }
+            gradNorm = sqrt(gradNorm);
+            
+            for (UINT vrtx = 0; vrtx < g_nVrtxPerCell; vrtx++) {
+                double gradDotN = 0.0;
+                for (UINT dim = 0; dim < g_ndim; dim++) {
+                    gradDotN -= gradients(dim, vrtx, cell) * 
+                                gradients(dim, face, cell) / gradNorm;
+                }
+                c_fluxWeights(vrtx, face, cell) = 
+                    c_diffusion[cell] * gradDotN;
+            }
+            
+            double area = g_tychoMesh->getFaceArea(cell, face);
+            diffusionOverH(face, cell) = 
+                c_diffusion[cell] * area / (3.0 * volume);
+        }
+    }
+    
+    
+    // Faces of local neighbors and faces shared with other ranks
+    for (UINT cell = 0; cell < g_nCells; cell++) {
+    for (UINT face = 0; face < g_nFacePerCell; face++) {
+        
+        UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
+        UINT adjRank = g_tychoMesh->getAdjRank(cell, face);
+        c_adjFace(face, cell) = TychoMesh::BOUNDARY_FACE;
+        c_remoteRankIndex(face, cell) = TychoMesh::BAD_RANK;
+        
+        // The adjacent cell's face is opposite its vertex not on this face
+        if (adjCell != TychoMesh::BOUNDARY_FACE) {
+            UINT adjFace = 0 + 1 + 2 + 3;
+            for (UINT fvrtx = 0; fvrtx < g_nVrtxPerFace; fvrtx++) {
+                adjFace -= g_tychoMesh->getNeighborVrtx(cell, face, fvrtx);
+            }
+            c_adjFace(face, cell) = adjFace;
+        }
+        
+        else if (adjRank != TychoMesh::BAD_RANK) {
+            UINT rankIndex = find(c_adjRanks.begin(), c_adjRanks.end(), 
+                                  adjRank) - c_adjRanks.begin();
+            if (rankIndex == c_adjRanks.size()) {
+                c_adjRanks.push_back(adjRank);
+                c_remoteFaces.resize(c_adjRanks.size());
+            }
+            UINT gSide = 
+                g_tychoMesh->getLGSide(g_tychoMesh->getSide(cell, face));
+            c_remoteFaces[rankIndex].push_back(
+                make_pair(gSide, cell * g_nFacePerCell + face));
+        }
+    }}
+    
+    c_recvData.resize(c_adjRanks.size());
+    vector<vector<double>> sendData(c_adjRanks.size());
+    vector<vector<double>> recvData(c_adjRanks.size());
+    for (UINT rankIndex = 0; rankIndex < c_adjRanks.size(); rankIndex++) {
+        vector<pair<UINT,UINT>> &faces = c_remoteFaces[rankIndex];
+        sort(faces.begin(), faces.end());
+        for (UINT entry = 0; entry < faces.size(); entry++) {
+            UINT cell = faces[entry].second / g_nFacePerCell;
+            UINT face = faces[entry].second % g_nFacePerCell;
+            c_remoteRankIndex(face, cell) = rankIndex;
+            c_remoteEntry(face, cell) = entry;
+            sendData[rankIndex].push_back(diffusionOverH(face, cell));
+        }
+        recvData[rankIndex].resize(faces.size());
+        c_recvData[rankIndex].resize(faces.size() * g_nGroups * 
+                                     c_numFaceValues);
+    }
+    exchangeFaceData(c_adjRanks, sendData, recvData);
+    
+    
+    // Penalty coefficients
+    for (UINT cell = 0; cell < g_nCells; cell++) {
+    for (UINT face = 0; face < g_nFacePerCell; face++) {
+        
+        UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
+        UINT rankIndex = c_remoteRankIndex(face, cell);
+        double penalty;
+        
+        if (adjCell != TychoMesh::BOUNDARY_FACE) {
+            penalty = c_penaltyConstant / 2.0 * 
+                (diffusionOverH(face, cell) + 
+                 diffusionOverH(c_adjFace(face, cell), adjCell));
+        }
+        else if (rankIndex != TychoMesh::BAD_RANK) {
+            penalty = c_penaltyConstant / 2.0 * 
+                (diffusionOverH(face, cell) + 
+                 recvData[rankIndex][c_remoteEntry(face, cell)]);
+        }
+        else {
+            penalty = c_penaltyConstant * diffusionOverH(face, cell);
+        }
+        c_penalty(face, cell) = max(penalty, 0.25);
+    }}
+    
+    
+    // Each cell's own block of the operator and its inverse
+    for (UINT cell = 0; cell < g_nCells; cell++) {
+        
+        double volume = g_tychoMesh->getCellVolume(cell);
+        double block[4][4];
+        double inverse[4][4];
+        
+        for (UINT i = 0; i < g_nVrtxPerCell; i++) {
+        for (UINT j = 0; j < g_nVrtxPerCell; j++) {
+            
+            double gradDotGrad = 0.0;
+            for (UINT dim = 0; dim < g_ndim; dim++) {
+                gradDotGrad += gradients(dim, i, cell) * 
+                               gradients(dim, j, cell);
+            }
+            double value = c_diffusion[cell] * volume * gradDotGrad + 
+                sigmaA[cell] * volume / 20.0 * (i == j ? 2.0 : 1.0);
+            
+            for (UINT face = 0; face < g_nFacePerCell; face++) {
+                double area = g_tychoMesh->getFaceArea(cell, face);
+                if (i != face && j != face) {
+                    value += c_penalty(face, cell) * area / 12.0 * 
+                             (i == j ? 2.0 : 1.0);
+                }
+                if (i != face)
+                    value -= 0.5 * c_fluxWeights(j, face, cell) * area / 3.0;
+                if (j != face)
+                    value -= 0.5 * c_fluxWeights(i, face, cell) * area / 3.0;
+            }
+            
+            block[i][j] = value;
+            c_selfMatrix(i, j, cell) = value;
+        }}
+        
+        invert4(block, inverse);
+        for (UINT i = 0; i < g_nVrtxPerCell; i++) {
+        for (UINT j = 0; j < g_nVrtxPerCell; j++) {
+            c_selfInverse(i, j, cell) = inverse[i][j];
+        }}
+    }
+}
+
+
+/*
+    DSA::calcFaceFlux
+    
+    D grad u . n out of each face of each cell.
+*/
+void DSA::calcFaceFlux(const PhiData &u)
+{
+    #pragma omp parallel for
+    for (UINT cell = 0; cell < g_nCells; cell++) {
+    for (UINT face = 0; face < g_nFacePerCell; face++) {
+    for (UINT group = 0; group < g_nGroups; group++) {
+        double flux = 0.0;
+        for (UINT vrtx = 0; vrtx < g_nVrtxPerCell; vrtx++) {
+            flux += c_fluxWeights(vrtx, face, cell) * u(group, vrtx, cell);
+        }
+        c_faceFlux(group, face, cell) = flux;
+    }}}
+}
+
+
+/*
+    DSA::exchange
+    
+    Sends u at the face vertices and the normal flux out of each face 
+    shared with another rank.  Both cells on a face order its vertices the 
+    same way.
+*/
+void DSA::exchange(const PhiData &u)
+{
+    vector<vector<double>> sendData(c_adjRanks.size());
+    
+    for (UINT rankIndex = 0; rankIndex < c_adjRanks.size(); rankIndex++) {
+        const vector<pair<UINT,UINT>> &faces = c_remoteFaces[rankIndex];
+        sendData[rankIndex].reserve(c_recvData[rankIndex].size());
+        for (UINT entry = 0; entry < faces.size(); entry++) {
+            UINT cell = faces[entry].second / g_nFacePerCell;
+            UINT face = faces[entry].second % g_nFacePerCell;
+            for (UINT group = 0; group < g_nGroups; group++) {
+                for (UINT fvrtx = 0; fvrtx < g_nVrtxPerFace; fvrtx++) {
+                    UINT vrtx = 
+                        g_tychoMesh->getFaceToCellVrtx(cell, face, fvrtx);
+                    sendData[rankIndex].push_back(u(group, vrtx, cell));
+                }
+                sendData[rankIndex].push_back(c_faceFlux(group, face, cell));
+            }
+        }
+    }
+    
+    exchangeFaceData(c_adjRanks, sendData, c_recvData);
+}
+
+
+/*
+    DSA::applyOperator
+    
+    y = A u for the MIP diffusion operator A.
+    Face terms, with [[u]] = u - uAdj and n out of the cell, are
+        kappa [[u]] v - {{D grad u . n}} v - [[u]] D grad v . n / 2
+    on interior faces and the same with uAdj = 0 and only this cell's flux
+    on boundary faces.  The terms with u on this cell are in the cell's 
+    own block, so only the adjacent cell's part is added here.
+*/
+void DSA::applyOperator(const PhiData &u, PhiData &y)
+{
+    calcFaceFlux(u);
+    exchange(u);
+    
+    #pragma omp parallel for
+    for (UINT cell = 0; cell < g_nCells; cell++) {
+    for (UINT group = 0; group < g_nGroups; group++) {
+        
+        double result[4];
+        for (UINT i = 0; i < g_nVrtxPerCell; i++) {
+            result[i] = 0.0;
+            for (UINT j = 0; j < g_nVrtxPerCell; j++) {
+                result[i] += c_selfMatrix(i, j, cell) * u(group, j, cell);
+            }
+        }
+        
+        for (UINT face = 0; face < g_nFacePerCell; face++) {
+            
+            UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
+            UINT rankIndex = c_remoteRankIndex(face, cell);
+            double uAdj[3];
+            double fluxAdj;
+            
+            // Flux of the adjacent cell is out of its face, so negate it
+            if (adjCell != TychoMesh::BOUNDARY_FACE) {
+                for (UINT fvrtx = 0; fvrtx < g_nVrtxPerFace; fvrtx++) {
+                    UINT adjVrtx = 
+                        g_tychoMesh->getNeighborVrtx(cell, face, fvrtx);
+                    uAdj[fvrtx] = u(group, adjVrtx, adjCell);
+                }
+                fluxAdj = -c_faceFlux(group, c_adjFace(face, cell), adjCell);
+            }
+            else if (rankIndex != TychoMesh::BAD_RANK) {
+                const double *data = &c_recvData[rankIndex][
+                    (c_remoteEntry(face, cell) * g_nGroups + group) * 
+                    c_numFaceValues];
+                for (UINT fvrtx = 0; fvrtx < g_nVrtxPerFace; fvrtx++) {
+                    uAdj[fvrtx] = data[fvrtx];
+                }
+                fluxAdj = -data[g_nVrtxPerFace];
+            }
+            else {
+                continue;
+            }
+            
+            double area = g_tychoMesh->getFaceArea(cell, face);
+            double uAdjSum = uAdj[0] + uAdj[1] + uAdj[2];
+            for (UINT i = 0; i < g_nVrtxPerCell; i++) {
+                if (i != face) {
+                    UINT fvrtx = g_tychoMesh->getCellToFaceVrtx(cell, face, i);
+                    result[i] -= c_penalty(face, cell) * area / 12.0 * 
+                                 (uAdjSum + uAdj[fvrtx]);
+                    result[i] -= 0.5 * fluxAdj * area / 3.0;
+                }
+                result[i] += 0.5 * c_fluxWeights(i, face, cell) * area / 3.0 *
+                             uAdjSum;
+            }
+        }
+        
+        for (UINT i = 0; i < g_nVrtxPerCell; i++) {
+            y(group, i, cell) = result[i];
+        }
+    }}
+}
+
+
+/*
+    DSA::applyPreconditioner
+    
+    z = inverse of each cell's block times r.
+*/
+void DSA::applyPreconditioner(const PhiData &r, PhiData &z) const
+{
+    #pragma omp parallel for
+    for (UINT cell = 0; cell < g_nCells; cell++) {
+    for (UINT group = 0; group < g_nGroups; group++) {
+    for (UINT i = 0; i < g_nVrtxPerCell; i++) {
+        double sum = 0.0;
+        for (UINT j = 0; j < g_nVrtxPerCell; j++) {
+            sum += c_selfInverse(i, j, cell) * r(group, j, cell);
+        }
+        z(group, i, cell) = sum;
+    }}}
+}
+
+
+/*
+    DSA::addCorrection
+    
+    Solves the diffusion equation with source sigma_s phiChange and adds 
+    the solution to phi.  phiChange and phi may be the same.
+    Stops when the residual is g_dsaErrMax times the right hand side or 
+    after g_dsaIterMax iterations.
+*/
+void DSA::addCorrection(const PhiData &phiChange, PhiData &phi)
+{
+    PhiData b, x, r, z, p, ap;
+    vector<double> dots(3);
+    
+    
+    // b = mass matrix times sigma_s phiChange
+    for (UINT cell = 0; cell < g_nCells; cell++) {
+        double scale = g_sigmaS[cell] * g_tychoMesh->getCellVolume(cell) / 
+                       20.0;
+        for (UINT group = 0; group < g_nGroups; group++) {
+            double sum = 0.0;
+            for (UINT vrtx = 0; vrtx < g_nVrtxPerCell; vrtx++) {
+                sum += phiChange(group, vrtx, cell);
+            }
+            for (UINT vrtx = 0; vrtx < g_nVrtxPerCell; vrtx++) {
+                b(group, vrtx, cell) = 
+                    scale * (sum + phiChange(group, vrtx, cell));
+            }
+        }
+    }
+    
+    
+    // Preconditioned conjugate gradient from x = 0
+    // r.z and r.r share a reduction
+    for (UINT i = 0; i < b.size(); i++) {
+        r[i] = b[i];
+    }
+    applyPreconditioner(r, z);
+    for (UINT i = 0; i < z.size(); i++) {
+        p[i] = z[i];
+    }
+    dots[0] = dot(r, z);
+    dots[1] = dot(r, r);
+    dots[2] = dot(b, b);
+    Comm::gsum(dots);
+    double rz = dots[0];
+    double rr = dots[1];
+    double tol2 = g_dsaErrMax * g_dsaErrMax * dots[2];
+    
+    UINT iter = 0;
+    while (rr > tol2 && iter < g_dsaIterMax) {
+        
+        applyOperator(p, ap);
+        double pap = dot(p, ap);
+        Comm::gsum(pap);
+        Insist(pap > 0.0, "DSA: operator not positive definite.");
+        
+        double alpha = rz / pap;
+        for (UINT i = 0; i < x.size(); i++) {
+            x[i] += alpha * p[i];
+            r[i] -= alpha * ap[i];
+        }
+        
+        applyPreconditioner(r, z);
+        dots.resize(2);
+        dots[0] = dot(r, z);
+        dots[1] = dot(r, r);
+        Comm::gsum(dots);
+        
+        double beta = dots[0] / rz;
+        rz = dots[0];
+        rr = dots[1];
+        for (UINT i = 0; i < p.size(); i++) {
+            p[i] = z[i] + beta * p[i];
+        }
+        iter++;
+    }
+    
+    
+    // phi += x
+    for (UINT i = 0; i < phi.size(); i++) {
+        phi[i] += x[i];
+    }
+    c_numIterations += iter;
+    c_numSolves++;
+}
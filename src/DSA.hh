@@ -0,0 +1,105 @@
+/*
+Copyright (c) 2016, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2016. Los Alamos National Security, LLC. This software was produced 
+under U.S. Government contract DE-AC52-06NA25396 for Los Alamos National 
+Laboratory (LANL), which is operated by Los Alamos National Security, LLC for 
+the U.S. Department of Energy. The U.S. Government has rights to use, 
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR LOS 
+ALAMOS NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR 
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified 
+to produce derivative works, such modified software should be clearly marked, 
+so as not to confuse it with the version available from LANL.
+
+Additionally, redistribution and use in source and binary forms, with or 
+without modification, are permitted provided that the following conditions 
+are met:
+1.      Redistributions of source code must retain the above copyright notice, 
+        this list of conditions and the following disclaimer.
+2.      Redistributions in binary form must reproduce the above copyright 
+        notice, this list of conditions and the following disclaimer in the 
+        documentation and/or other materials provided with the distribution.
+3.      Neither the name of Los Alamos National Security, LLC, Los Alamos 
+        National Laboratory, LANL, the U.S. Government, nor the names of its 
+        contributors may be used to endorse or promote products derived from 
+        this software without specific prior written permission.
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND 
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT 
+NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS ALAMOS NATIONAL 
+SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; 
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __DSA_HH__
+#define __DSA_HH__
+
+#include "Global.hh"
+#include "Mat.hh"
+#include "PsiData.hh"
+#include <vector>
+
+
+/*
+    DSA class
+    
+    Diffusion synthetic acceleration.  Solves the diffusion equation
+        -div (D grad delta) + sigma_a delta = sigma_s phiChange
+    with D = 1 / (3 sigma_t) and sigma_a = sigma_t - sigma_s for a 
+    correction delta to the scalar flux.  For source iteration, phiChange 
+    is the change in phi made by the last sweep, and adding delta gives 
+    the flux the sweep would converge to if diffusion were exact.
+    
+    The equation is discretized with the modified interior penalty (MIP) 
+    form of linear discontinuous Galerkin on the tets, which has the same 
+    unknowns as the transport phi and is stable for any mesh and cross 
+    sections.  Boundary faces get a vacuum (Robin) condition.  The system 
+    is symmetric positive definite and is solved with conjugate gradient 
+    preconditioned by the inverse of each cell's own 4x4 block.  Applying 
+    the operator needs the face values and normal flux of the other cell 
+    on each face, which are exchanged with adjacent ranks.
+*/
+class DSA
+{
+public:
+    DSA();
+    void addCorrection(const PhiData &phiChange, PhiData &phi);
+    UINT getNumIterations() const { return c_numIterations; }
+    UINT getNumSolves() const { return c_numSolves; }
+
+private:
+    void calcFaceFlux(const PhiData &u);
+    void exchange(const PhiData &u);
+    void applyOperator(const PhiData &u, PhiData &y);
+    void applyPreconditioner(const PhiData &r, PhiData &z) const;
+    
+    // Cell data
+    // Matrices are (vrtx, vrtx, cell) and face data is (face, cell)
+    std::vector<double> c_diffusion;
+    Mat3<double> c_selfMatrix;
+    Mat3<double> c_selfInverse;
+    Mat3<double> c_fluxWeights;
+    Mat2<double> c_penalty;
+    Mat2<UINT> c_adjFace;
+    Mat3<double> c_faceFlux;
+    
+    // Faces shared with other ranks, sorted by global side so both ranks
+    // send them in the same order
+    // c_remoteEntry is (face, cell) -> index of the face in its rank's list
+    std::vector<UINT> c_adjRanks;
+    std::vector<std::vector<std::pair<UINT,UINT>>> c_remoteFaces;
+    Mat2<UINT> c_remoteRankIndex;
+    Mat2<UINT> c_remoteEntry;
+    std::vector<std::vector<double>> c_recvData;
+    
+    UINT c_numIterations;
+    UINT c_numSolves;
+};
+
+#endif
@@ -0,0 +1,168 @@
+/*
+Copyright (c) 2016, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2016. Los Alamos National Security, LLC. This software was produced 
+under U.S. Government contract DE-AC52-06NA25396 for Los Alamos National 
+Laboratory (LANL), which is operated by Los Alamos National Security, LLC for 
+the U.S. Department of Energy. The U.S. Government has rights to use, 
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR LOS 
+ALAMOS NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR 
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified 
+to produce derivative works, such modified software should be clearly marked, 
+so as not to confuse it with the version available from LANL.
+
+Additionally, redistribution and use in source and binary forms, with or 
+without modification, are permitted provided that the following conditions 
+are met:
+1.      Redistributions of source code must retain the above copyright notice, 
+        this list of conditions and the following disclaimer.
+2.      Redistributions in binary form must reproduce the above copyright 
+        notice, this list of conditions and the following disclaimer in the 
+        documentation and/or other materials provided with the distribution.
+3.      Neither the name of Los Alamos National Security, LLC, Los Alamos 
+        National Laboratory, LANL, the U.S. Government, nor the names of its 
+        contributors may be used to endorse or promote products derived from 
+        this software without specific prior written permission.
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND 
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT 
+NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS ALAMOS NATIONAL 
+SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; 
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "DependencyGraph.hh"
+#include "TychoMesh.hh"
+
+using namespace std;
+
+
+/*
+    calcBoundaryType
+*/
+static
+BoundaryType calcBoundaryType(const UINT cell, const UINT angle, 
+                              const UINT face)
+{
+    UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
+    UINT adjRank = g_tychoMesh->getAdjRank(cell, face);
+    bool outgoing = g_tychoMesh->isOutgoing(angle, cell, face);
+    
+    if (adjCell == TychoMesh::BOUNDARY_FACE && adjRank != TychoMesh::BAD_RANK)
+        return outgoing ? BoundaryType_OutIntBdry : BoundaryType_InIntBdry;
+    
+    else if (adjCell == TychoMesh::BOUNDARY_FACE)
+        return outgoing ? BoundaryType_OutExtBdry : BoundaryType_InExtBdry;
+    
+    return outgoing ? BoundaryType_OutInt : BoundaryType_InInt;
+}
+
+
+/*
+    DependencyGraph constructor
+*/
+DependencyGraph::DependencyGraph()
+{
+    UINT numPairs = g_nCells * g_nAngles;
+    
+    
+    // Adjacent cells and sides
+    c_adjCellsSides.resize(g_nFacePerCell, g_nCells);
+    for (UINT cell = 0; cell < g_nCells; cell++) {
+    for (UINT face = 0; face < g_nFacePerCell; face++) {
+        UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
+        UINT adjRank = g_tychoMesh->getAdjRank(cell, face);
+        
+        c_adjCellsSides(face, cell) = adjCell;
+        if (adjCell == TychoMesh::BOUNDARY_FACE && 
+            adjRank != TychoMesh::BAD_RANK)
+        {
+            c_adjCellsSides(face, cell) = g_tychoMesh->getSide(cell, face);
+        }
+    }}
+    
+    
+    // Boundary types
+    c_bdryTypes.resize(numPairs * g_nFacePerCell);
+    for (UINT cell = 0; cell < g_nCells; cell++) {
+    for (UINT angle = 0; angle < g_nAngles; angle++) {
+    for (UINT face = 0; face < g_nFacePerCell; face++) {
+        UINT pair = cell * g_nAngles + angle;
+        c_bdryTypes[pair * g_nFacePerCell + face] = 
+            calcBoundaryType(cell, angle, face);
+    }}}
+    
+    
+    // Children and number of parents for each direction
+    for (UINT direction = 0; direction < 2; direction++) {
+        
+        // Outgoing and incoming faces wrt the direction
+        BoundaryType childInt = BoundaryType_OutInt;
+        BoundaryType parentInt = BoundaryType_InInt;
+        BoundaryType parentIntBdry = BoundaryType_InIntBdry;
+        if (direction == Direction_Backward) {
+            childInt = BoundaryType_InInt;
+            parentInt = BoundaryType_OutInt;
+            parentIntBdry = BoundaryType_OutIntBdry;
+        }
+        
+        c_childOffsets[direction].resize(numPairs + 1);
+        c_numLocalParents[direction].resize(numPairs);
+        c_numRemoteParents[direction].resize(numPairs);
+        c_children[direction].clear();
+        
+        for (UINT cell = 0; cell < g_nCells; cell++) {
+        for (UINT angle = 0; angle < g_nAngles; angle++) {
+            
+            UINT pair = cell * g_nAngles + angle;
+            c_childOffsets[direction][pair] = c_children[direction].size();
+            c_numLocalParents[direction][pair] = 0;
+            c_numRemoteParents[direction][pair] = 0;
+            
+            for (UINT face = 0; face < g_nFacePerCell; face++) {
+                BoundaryType bdryType = getBoundaryType(cell, angle, face);
+                
+                if (bdryType == childInt) {
+                    c_children[direction].push_back(
+                        c_adjCellsSides(face, cell));
+                }
+                else if (bdryType == parentInt) {
+                    c_numLocalParents[direction][pair]++;
+                }
+                else if (bdryType == parentIntBdry) {
+                    c_numRemoteParents[direction][pair]++;
+                }
+            }
+        }}
+        
+        c_childOffsets[direction][numPairs] = c_children[direction].size();
+        c_children[direction].shrink_to_fit();
+    }
+}
+
+
+/*
+    getMemoryInBytes
+    
+    Memory used by the graph on this rank.
+*/
+UINT DependencyGraph::getMemoryInBytes() const
+{
+    UINT bytes = c_bdryTypes.size() * sizeof(uint8_t) + 
+                 c_adjCellsSides.size() * sizeof(UINT);
+    
+    for (UINT direction = 0; direction < 2; direction++) {
+        bytes += c_childOffsets[direction].size() * sizeof(UINT) + 
+                 c_children[direction].size() * sizeof(UINT) + 
+                 c_numLocalParents[direction].size() * sizeof(uint8_t) + 
+                 c_numRemoteParents[direction].size() * sizeof(uint8_t);
+    }
+    
+    return bytes;
+}
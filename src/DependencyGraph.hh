@@ -0,0 +1,161 @@
+/*
+Copyright (c) 2016, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2016. Los Alamos National Security, LLC. This software was produced 
+under U.S. Government contract DE-AC52-06NA25396 for Los Alamos National 
+Laboratory (LANL), which is operated by Los Alamos National Security, LLC for 
+the U.S. Department of Energy. The U.S. Government has rights to use, 
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR LOS 
+ALAMOS NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR 
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified 
+to produce derivative works, such modified software should be clearly marked, 
+so as not to confuse it with the version available from LANL.
+
+Additionally, redistribution and use in source and binary forms, with or 
+without modification, are permitted provided that the following conditions 
+are met:
+1.      Redistributions of source code must retain the above copyright notice, 
+        this list of conditions and the following disclaimer.
+2.      Redistributions in binary form must reproduce the above copyright 
+        notice, this list of conditions and the following disclaimer in the 
+        documentation and/or other materials provided with the distribution.
+3.      Neither the name of Los Alamos National Security, LLC, Los Alamos 
+        National Laboratory, LANL, the U.S. Government, nor the names of its 
+        contributors may be used to endorse or promote products derived from 
+        this software without specific prior written permission.
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND 
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT 
+NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS ALAMOS NATIONAL 
+SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; 
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __DEPENDENCY_GRAPH_HH__
+#define __DEPENDENCY_GRAPH_HH__
+
+#include "Global.hh"
+#include "Mat.hh"
+#include "Assert.hh"
+#include <vector>
+
+
+/*
+    Boundary Type for faces of a cell.
+    They are split into incoming and outgoing wrt sweep direction.
+    Interior means adjacent cell is on same proc.
+    Interior boundary means adj cell is on different proc.
+    Exterior boundary means it is a boundary for the whole mesh.
+*/
+enum BoundaryType
+{
+    // Outgoing
+    BoundaryType_OutIntBdry,    // Interior boundary
+    BoundaryType_OutExtBdry,    // Exterior boundary
+    BoundaryType_OutInt,        // Interior
+    
+    // Incoming
+    BoundaryType_InIntBdry,     // Interior boundary
+    BoundaryType_InExtBdry,     // Exterior boundary
+    BoundaryType_InInt          // Interior
+};
+
+
+enum Direction
+{
+    Direction_Forward,
+    Direction_Backward
+};
+
+
+/*
+    DependencyGraph class
+    
+    The graph of (cell, angle) pairs on this rank for the quadrature, built 
+    once and shared by all graph traversers and sweep schedules.
+    Pairs are indexed by cell * g_nAngles + angle.
+    
+    For each pair it holds the boundary type of each face (outgoing and
+    incoming are wrt the sweep, i.e. Direction_Forward).
+    For each direction it holds the children on this rank in CSR format and
+    the number of parents on this rank and on other ranks.
+    Children and parents are wrt the direction, so the children for 
+    Direction_Backward are the parents for Direction_Forward.
+*/
+class DependencyGraph
+{
+public:
+    DependencyGraph();
+    
+    UINT getNumParents(const Direction direction, const bool doComm, 
+                       const UINT cell, const UINT angle) const
+    {
+        UINT pair = cell * g_nAngles + angle;
+        UINT numParents = c_numLocalParents[direction][pair];
+        if (doComm)
+            numParents += c_numRemoteParents[direction][pair];
+        return numParents;
+    }
+    
+    UINT getNumRemoteParents(const Direction direction, 
+                             const UINT cell, const UINT angle) const
+        { return c_numRemoteParents[direction][cell * g_nAngles + angle]; }
+    
+    const UINT* childrenBegin(const Direction direction, 
+                              const UINT cell, const UINT angle) const
+    { 
+        UINT pair = cell * g_nAngles + angle;
+        return &c_children[direction][c_childOffsets[direction][pair]];
+    }
+    
+    const UINT* childrenEnd(const Direction direction, 
+                            const UINT cell, const UINT angle) const
+    { 
+        UINT pair = cell * g_nAngles + angle;
+        return &c_children[direction][c_childOffsets[direction][pair + 1]];
+    }
+    
+    BoundaryType getBoundaryType(const UINT cell, const UINT angle, 
+                                 const UINT face) const
+    { 
+        UINT pair = cell * g_nAngles + angle;
+        return (BoundaryType) c_bdryTypes[pair * g_nFacePerCell + face];
+    }
+    
+    void getBoundaryTypes(const UINT cell, const UINT angle, 
+                          BoundaryType bdryType[g_nFacePerCell]) const
+    {
+        UINT pair = cell * g_nAngles + angle;
+        for (UINT face = 0; face < g_nFacePerCell; face++) {
+            bdryType[face] = 
+                (BoundaryType) c_bdryTypes[pair * g_nFacePerCell + face];
+        }
+    }
+    
+    // Adjacent cell, or the side for interior boundary faces
+    void getAdjCellsSides(const UINT cell, 
+                          UINT adjCellsSides[g_nFacePerCell]) const
+    {
+        for (UINT face = 0; face < g_nFacePerCell; face++) {
+            adjCellsSides[face] = c_adjCellsSides(face, cell);
+        }
+    }
+    
+    UINT getMemoryInBytes() const;
+    
+private:
+    std::vector<uint8_t> c_bdryTypes;
+    Mat2<UINT> c_adjCellsSides;
+    std::vector<UINT> c_childOffsets[2];
+    std::vector<UINT> c_children[2];
+    std::vector<uint8_t> c_numLocalParents[2];
+    std::vector<uint8_t> c_numRemoteParents[2];
+};
+
+#endif
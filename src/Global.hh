@@ -58,12 +58,18 @@ class Quadrature;
 class TychoMesh;
 class SweepSchedule;
 class GraphTraverser;
+class DependencyGraph;
+class PatchGraph;
 
 
 // Macro to get around some warnings
 #define UNUSED_VARIABLE(x) (void)(x)
 
 
+// Software prefetch of the cache line holding an address
+#define PREFETCH(address) __builtin_prefetch(address)
+
+
 // Shorter version of uint64_t
 // Also allows changing the UINT type
 typedef uint64_t UINT;
@@ -74,6 +80,7 @@ static const UINT g_ndim = 3;
 static const UINT g_nVrtxPerCell = 4;
 static const UINT g_nVrtxPerFace = 3;
 static const UINT g_nFacePerCell = 4;
+static const UINT g_nBytesPerCacheLine = 64;
 
 
 // Enum types
@@ -98,10 +105,32 @@ enum GaussElim
     GaussElim_CramerIntel
 };
 
+enum CellNumbering
+{
+    CellNumbering_Original,
+    CellNumbering_RCM,
+    CellNumbering_Morton
+};
+
+enum KrylovType
+{
+    KrylovType_GMRES,
+    KrylovType_BiCGStab
+};
+
 
 // Global variables
 EXTERN UINT g_nAngleGroups;
 EXTERN UINT g_nThreads;
+EXTERN UINT g_nThreadsPerAngleGroup;
+EXTERN UINT g_nGroupBlocks;
+EXTERN UINT g_cellsPerPatch;
+EXTERN UINT g_angleBatchSize;
+EXTERN UINT g_prefetchLookahead;
+EXTERN UINT g_cellsPerTile;
+EXTERN CellNumbering g_cellNumbering;
+EXTERN std::string g_scheduleCache;
+EXTERN KrylovType g_krylovType;
 EXTERN UINT g_nGroups;
 EXTERN UINT g_snOrder;
 EXTERN UINT g_iterMax;
@@ -116,6 +145,8 @@ EXTERN TychoMesh *g_tychoMesh;
 EXTERN SweepSchedule **g_sweepSchedule;
 EXTERN Quadrature *g_quadrature;
 EXTERN GraphTraverser *g_graphTraverserForward;
+EXTERN DependencyGraph *g_dependencyGraph;
+EXTERN PatchGraph *g_patchGraph;
 EXTERN GaussElim g_gaussElim;
 EXTERN bool g_outputFile;
 EXTERN std::string g_outputFilename;
@@ -125,6 +156,21 @@ EXTERN double g_ddErrMax;
 EXTERN UINT g_ddIterMax;
 EXTERN bool g_useSourceIteration;
 EXTERN bool g_useOneSidedMPI;
+EXTERN bool g_adaptiveCellsPerStep;
+EXTERN double g_targetOverlap;
+EXTERN bool g_eagerFlush;
+EXTERN double g_eagerFlushBLevelFraction;
+EXTERN UINT g_eagerFlushPackets;
+EXTERN bool g_replayTraversal;
+EXTERN bool g_localSweepFIFO;
+EXTERN bool g_useDSA;
+EXTERN double g_dsaErrMax;
+EXTERN UINT g_dsaIterMax;
+EXTERN UINT g_andersonDepth;
+EXTERN UINT g_ddAndersonDepth;
+EXTERN bool g_ddCoarseCorrection;
+EXTERN double g_ddIncrementalTol;
+EXTERN bool g_ddAsync;
 
 #endif
 
@@ -38,6 +38,9 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "GraphTraverser.hh"
+#include "PatchGraph.hh"
+#include "SweepData.hh"
+#include "PriorityData.hh"
 #include "Mat.hh"
 #include "Global.hh"
 #include "TychoMesh.hh"
@@ -45,8 +48,11 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Timer.hh"
 #include <vector>
 #include <set>
-#include <queue>
+#include <deque>
+#include <algorithm>
 #include <utility>
+#include <thread>
+#include <cinttypes>
 #include <omp.h>
 #include <limits.h>
 #include <string.h>
@@ -61,19 +67,19 @@ namespace {
 class Tuple
 {
 private:
-    UINT c_cell;
-    UINT c_angle;
+    UINT c_task;
+    UINT c_angleIndex;
     UINT c_priority;
     
 public:
-    Tuple(UINT cell, UINT angle, UINT priority)
-        : c_cell(cell), c_angle(angle), c_priority(priority) {}
+    Tuple(UINT task, UINT angleIndex, UINT priority)
+        : c_task(task), c_angleIndex(angleIndex), c_priority(priority) {}
     
-    UINT getCell() const { return c_cell; }
-    UINT getAngle() const { return c_angle; }
+    UINT getTask() const { return c_task; }
+    UINT getAngleIndex() const { return c_angleIndex; }
     
     // Comparison operator to determine relative priorities
-    // Needed for priority_queue
+    // Needed for the TaskQueue heap
     bool operator<(const Tuple &rhs) const
     {
         return c_priority < rhs.c_priority;
@@ -81,17 +87,64 @@ public:
 };}
 
 
+/*
+    TaskQueue class
+    
+    Queue of ready pairs, either a priority queue or, if FIFO is set, a 
+    FIFO queue that skips the cost of keeping a heap.
+    peek looks into the heap or FIFO.  The first few heap entries are the 
+    pairs that will be popped soon (the i-th popped pair is within the 
+    first 2^i - 1 entries), which is good enough for prefetching.
+    The heap is kept like std::priority_queue keeps it, so pairs come out
+    in the same order.
+*/
+namespace {
+class TaskQueue
+{
+public:
+    TaskQueue() : c_fifo(false) {}
+    
+    void setFifo(const bool fifo) { c_fifo = fifo; }
+    size_t size() const { return c_tasks.size(); }
+    const Tuple &top() const { return c_tasks.front(); }
+    const Tuple &peek(UINT i) const { return c_tasks[i]; }
+    
+    void push(const Tuple &tuple)
+    {
+        c_tasks.push_back(tuple);
+        if (!c_fifo)
+            push_heap(c_tasks.begin(), c_tasks.end());
+    }
+    
+    void pop()
+    {
+        if (c_fifo) {
+            c_tasks.pop_front();
+        }
+        else {
+            pop_heap(c_tasks.begin(), c_tasks.end());
+            c_tasks.pop_back();
+        }
+    }
+    
+private:
+    bool c_fifo;
+    deque<Tuple> c_tasks;
+};}
+
+
 /*
     splitPacket
     
-    Packet is (global side, angle, data)
+    Packet is (global side, angle index, data)
 */
 static
-void splitPacket(char *packet, UINT &globalSide, UINT &angle, char **data)
+void splitPacket(char *packet, UINT &globalSide, UINT &angleIndex, 
+                 char **data)
 {
     memcpy(&globalSide, packet, sizeof(UINT));
     packet += sizeof(UINT);
-    memcpy(&angle, packet, sizeof(UINT));
+    memcpy(&angleIndex, packet, sizeof(UINT));
     packet += sizeof(UINT);
     *data = packet;
 }
@@ -100,10 +153,10 @@ void splitPacket(char *packet, UINT &globalSide, UINT &angle, char **data)
 /*
     createPacket
     
-    Packet is (global side, angle, data)
+    Packet is (global side, angle index, data)
 */
 static
-void createPacket(vector<char> &packet, UINT globalSide, UINT angle, 
+void createPacket(vector<char> &packet, UINT globalSide, UINT angleIndex, 
                   UINT dataSize, const char *data)
 {
     packet.resize(2 * sizeof(UINT) + dataSize);
@@ -111,7 +164,7 @@ void createPacket(vector<char> &packet, UINT globalSide, UINT angle,
     
     memcpy(p, &globalSide, sizeof(UINT));
     p += sizeof(UINT);
-    memcpy(p, &angle, sizeof(UINT));
+    memcpy(p, &angleIndex, sizeof(UINT));
     p += sizeof(UINT);
     memcpy(p, data, dataSize);
 }
@@ -140,23 +193,24 @@ bool isIncoming(UINT angle, UINT cell, UINT face, Direction direction)
 /*
     angleGroupIndex
     
-    Gets angle groups for angle index.
-    e.g. 20 angles numbered 0...19 with 3 threads.
+    Gets angle group for an angle.
+    e.g. 20 angles numbered 0...19 with 3 angle groups.
     Split into 3 angle chunks of size 7,7,6:  0...6  7...13  14...19
     If angle in 0...6,   return 0
     If angle in 7...13,  return 1
     If angle in 14...19, return 2
 */
-UINT angleGroupIndex(UINT angle)
+static
+UINT angleGroupIndex(UINT angle, UINT numAngleGroups)
 {
     UINT numAngles = g_nAngles;
-    UINT chunkSize = numAngles / g_nThreads;
-    UINT numChunksBigger = numAngles % g_nThreads;
+    UINT chunkSize = numAngles / numAngleGroups;
+    UINT numChunksBigger = numAngles % numAngleGroups;
     UINT lowIndex = 0;
     
     
     // Find angleGroup
-    for (UINT angleGroup = 0; angleGroup < g_nThreads; angleGroup++) {
+    for (UINT angleGroup = 0; angleGroup < numAngleGroups; angleGroup++) {
         
         UINT nextLowIndex = lowIndex + chunkSize;
         if (angleGroup < numChunksBigger)
@@ -176,422 +230,243 @@ UINT angleGroupIndex(UINT angle)
 
 
 /*
-    sendData
+    TwoSidedComm class
 
-    Implements one-sided MPI for sending data.
-*/
-static 
-void sendData(const vector<vector<char>> &sendBuffers,
-              const vector<UINT> &adjRankIndexToRank,
-              const vector<UINT> &offRankOffsets,
-              const UINT packetSizeInBytes,
-              const UINT maxPackets,
-              const MPI_Win &mpiWin,
-              const bool firstTime)
-{
-    // Internal state with number of packets written for each data chunk
-    // and the current data chunk to write to for each adjacent rank.
-    static vector<uint32_t> numPacketsWrittenVector[2];
-    static vector<uint32_t> currentDataChunkVector;
-    UINT numAdjRanks = adjRankIndexToRank.size();
-    if (firstTime) {
-        numPacketsWrittenVector[0].clear();
-        numPacketsWrittenVector[1].clear();
-        currentDataChunkVector.clear();
-
-        numPacketsWrittenVector[0].resize(numAdjRanks);
-        numPacketsWrittenVector[1].resize(numAdjRanks);
-        currentDataChunkVector.resize(numAdjRanks);
-    }
-    
+    Two-sided communication for one traversal.
 
-    // Send data to each adjacent rank
-    for (UINT index = 0; index < numAdjRanks; index++) {
-        
-        // Make sure there is data to send
-        if (sendBuffers[index].size() == 0)
-            continue;
-        
+    The number of packets each adjacent rank sends during a traversal is
+    known from the mesh, so no extra messages are needed to end
+    communication.  A receive is kept posted for each adjacent rank that
+    still owes packets, sized for all of the packets it still owes.
+    The traversal is locally done when all its cell/angle pairs are
+    computed, which implies all expected packets have arrived.  A rank with
+    nothing to compute blocks in MPI_Waitsome until data arrives.
 
-        // Useful values
-        int mpiError;
-        int adjRank = adjRankIndexToRank[index];
-        UINT offRankOffset = offRankOffsets[index];
-        const vector<char> &sendBuffer = sendBuffers[index];
-        uint32_t currentDataChunk = currentDataChunkVector[index];
-        uint32_t numPacketsWritten = 
-            numPacketsWrittenVector[currentDataChunk][index];
-        
-        
-        // Check to see if there is NOT room to write data in current data chunk
-        UINT numPacketsToSend = sendBuffer.size() / packetSizeInBytes;
-        if (numPacketsWritten + numPacketsToSend > maxPackets) {
-            
-            // Flag indicating we can't write to this data chunk anymore
-            // Must be removed by recvData
-            uint32_t one = 1;
-            UINT offset = offRankOffset + 4 * currentDataChunk;
-            mpiError = MPI_Accumulate(&one, 1, MPI_UINT32_T, adjRank, offset, 
-                                      1, MPI_UINT32_T, MPI_REPLACE, mpiWin);
-            Insist(mpiError == MPI_SUCCESS, "");
-            
-            
-            // change data chunk we're working on
-            numPacketsWrittenVector[currentDataChunk][index] = 0;
-            numPacketsWritten = 0;
-            currentDataChunk = (currentDataChunk + 1) % 2;
-            currentDataChunkVector[index] = currentDataChunk;
-            
+    Messages from the next traversal can't be mistaken for messages from
+    this one since MPI doesn't let messages between two ranks overtake each
+    other and no receive is posted once a rank has all its packets.
+    
+    Each message ends with the sender's wait fraction (a double) used for
+    adaptive step sizes.
+*/
+namespace {
+class TwoSidedComm
+{
+public:
+    TwoSidedComm(const vector<UINT> &adjRankIndexToRank,
+                 const vector<UINT> &numRecvPackets,
+                 const UINT packetSizeInBytes,
+                 vector<double> &neighborWait);
+    void send(vector<vector<char>> &sendBuffers, const double waitFraction);
+    template <typename TraverseDataType>
+    void recv(TraverseDataType &traverseData, set<pair<UINT,UINT>> &sideRecv,
+              const bool block);
+    void finish();
 
-            // Spin wait for availability to write to new data chunk
-            while (true) {
-                uint32_t dummy = 0;
-                uint32_t writable = 1;
-                UINT offset = offRankOffset + 4 * currentDataChunk;
-                mpiError = MPI_Fetch_and_op(&dummy, &writable, MPI_UINT32_T,
-                                            adjRank, offset, MPI_NO_OP, mpiWin);
-                Insist(mpiError == MPI_SUCCESS, "");
-                
-                mpiError = MPI_Win_flush_local(adjRank, mpiWin);
-                Insist(mpiError == MPI_SUCCESS, "");
+private:
+    void postRecv(const UINT index);
+
+    static const int c_tag = 1;
+    const vector<UINT> &c_adjRankIndexToRank;
+    const UINT c_packetSizeInBytes;
+    vector<double> &c_neighborWait;
+    vector<UINT> c_numPacketsLeft;
+    vector<vector<char>> c_recvBuffers;
+    vector<MPI_Request> c_recvRequests;
+    vector<vector<char>> c_sendBuffers;
+    vector<MPI_Request> c_sendRequests;
+};}
 
-                if (writable == 0)
-                    break;
-            }
-        }
 
+/*
+    TwoSidedComm::TwoSidedComm
+*/
+TwoSidedComm::TwoSidedComm(const vector<UINT> &adjRankIndexToRank,
+                           const vector<UINT> &numRecvPackets,
+                           const UINT packetSizeInBytes,
+                           vector<double> &neighborWait)
+    : c_adjRankIndexToRank(adjRankIndexToRank),
+      c_packetSizeInBytes(packetSizeInBytes),
+      c_neighborWait(neighborWait),
+      c_numPacketsLeft(numRecvPackets)
+{
+    UINT numAdjRanks = c_adjRankIndexToRank.size();
+    c_recvBuffers.resize(numAdjRanks);
+    c_recvRequests.resize(numAdjRanks, MPI_REQUEST_NULL);
 
-        // Write the data
-        UINT offset = offRankOffset + 16 + 
-                      maxPackets * packetSizeInBytes * currentDataChunk + 
-                      numPacketsWritten * packetSizeInBytes;
-        mpiError = MPI_Put(sendBuffer.data(), sendBuffer.size(), 
-                           MPI_BYTE, adjRank, offset, 
-                           sendBuffer.size(), MPI_BYTE, mpiWin);
-        Insist(mpiError == MPI_SUCCESS, "");
-        mpiError = MPI_Win_flush(adjRank, mpiWin);
-        Insist(mpiError == MPI_SUCCESS, "");
-        
+    for (UINT index = 0; index < numAdjRanks; index++) {
+        if (c_numPacketsLeft[index] > 0)
+            postRecv(index);
+    }
+}
 
-        // Update number of packets written
-        numPacketsWritten += numPacketsToSend;
-        offset = offRankOffset + 8 + 4 * currentDataChunk;
-        mpiError = MPI_Accumulate(&numPacketsWritten, 1, MPI_UINT32_T, adjRank, 
-                                  offset, 1, MPI_UINT32_T, MPI_REPLACE, mpiWin);
-        Insist(mpiError == MPI_SUCCESS, "");
-        numPacketsWrittenVector[currentDataChunk][index] = numPacketsWritten;
 
+/*
+    TwoSidedComm::postRecv
 
-        // Flush window for local variables
-        mpiError = MPI_Win_flush_local(adjRank, mpiWin);
-        Insist(mpiError == MPI_SUCCESS, "");
-    }
+    Irecv for all the packets an adjacent rank still owes.
+*/
+void TwoSidedComm::postRecv(const UINT index)
+{
+    int mpiError;
+    int adjRank = c_adjRankIndexToRank[index];
+    UINT bufferSize = c_numPacketsLeft[index] * c_packetSizeInBytes + 
+                      sizeof(double);
+    Assert(bufferSize < INT_MAX);
+
+    c_recvBuffers[index].resize(bufferSize);
+    mpiError = MPI_Irecv(c_recvBuffers[index].data(), bufferSize, MPI_BYTE,
+                         adjRank, c_tag, MPI_COMM_WORLD,
+                         &c_recvRequests[index]);
+    Insist(mpiError == MPI_SUCCESS, "");
 }
 
 
 /*
-    recvData
+    TwoSidedComm::send
 
-    Implements one-sided MPI for receiving data.
+    Isend each non-empty send buffer.  The buffers are kept until the
+    sends complete, and sendBuffers is left empty.
 */
-static
-void recvData(const UINT numAdjRanks,
-              const vector<UINT> &onRankOffsets,
-              const UINT packetSizeInBytes,
-              TraverseData &traverseData, 
-              set<pair<UINT,UINT>> &sideRecv,
-              const UINT maxPackets,
-              const MPI_Win &mpiWin,
-              const bool firstTime)
+void TwoSidedComm::send(vector<vector<char>> &sendBuffers, 
+                        const double waitFraction)
 {
-    // Initial setup of number of internal state
-    static vector<uint32_t> numPacketsReadVector[2];
-    static vector<uint32_t> headerDataVector;
-    static vector<uint32_t> currentDataChunkVector;
-    if (firstTime) {
-        numPacketsReadVector[0].clear();
-        numPacketsReadVector[1].clear();
-        headerDataVector.clear();
-        currentDataChunkVector.clear();
-
-        numPacketsReadVector[0].resize(numAdjRanks);
-        numPacketsReadVector[1].resize(numAdjRanks);
-        headerDataVector.resize(4 * numAdjRanks);
-        currentDataChunkVector.resize(numAdjRanks);
-    }
-    
-    
-    // Useful values
-    int myRank = Comm::rank();
     int mpiError;
 
 
-    // Get header data for each adjacent rank
-    for (UINT index = 0; index < numAdjRanks; index++) {
+    // Release buffers of completed sends
+    if (c_sendRequests.size() > 0) {
+        int flag;
+        mpiError = MPI_Testall(c_sendRequests.size(), c_sendRequests.data(),
+                               &flag, MPI_STATUSES_IGNORE);
+        Insist(mpiError == MPI_SUCCESS, "");
+        if (flag) {
+            c_sendRequests.clear();
+            c_sendBuffers.clear();
+        }
+    }
+
+
+    // Send data
+    for (UINT index = 0; index < sendBuffers.size(); index++) {
+
+        if (sendBuffers[index].size() == 0)
+            continue;
 
-        UINT onRankOffset = onRankOffsets[index];
-        uint32_t dummy[4];
-        mpiError = MPI_Get_accumulate(dummy, 4, MPI_UINT32_T, 
-                                      &headerDataVector[4*index], 4, 
-                                      MPI_UINT32_T, myRank, onRankOffset, 4, 
-                                      MPI_UINT32_T, MPI_NO_OP, mpiWin);
+        MPI_Request request;
+        int adjRank = c_adjRankIndexToRank[index];
+        Assert(sendBuffers[index].size() < INT_MAX);
+
+        c_sendBuffers.push_back(vector<char>());
+        c_sendBuffers.back().swap(sendBuffers[index]);
+        const char *waitFractionBytes = (const char*)&waitFraction;
+        c_sendBuffers.back().insert(c_sendBuffers.back().end(), 
+                                    waitFractionBytes, 
+                                    waitFractionBytes + sizeof(double));
+        mpiError = MPI_Isend(c_sendBuffers.back().data(),
+                             c_sendBuffers.back().size(), MPI_BYTE,
+                             adjRank, c_tag, MPI_COMM_WORLD, &request);
         Insist(mpiError == MPI_SUCCESS, "");
+        c_sendRequests.push_back(request);
     }
+}
 
 
-    // Make sure we have the header data
-    mpiError = MPI_Win_flush_local(myRank, mpiWin);
+/*
+    TwoSidedComm::recv
+
+    Unpacks all data that has arrived.  If block is true, waits for at least
+    one message.
+*/
+template <typename TraverseDataType>
+void TwoSidedComm::recv(TraverseDataType &traverseData,
+                        set<pair<UINT,UINT>> &sideRecv,
+                        const bool block)
+{
+    int mpiError;
+    int numCompleted;
+    UINT numAdjRanks = c_adjRankIndexToRank.size();
+    vector<int> indices(numAdjRanks);
+    vector<MPI_Status> statuses(numAdjRanks);
+
+    if (numAdjRanks == 0)
+        return;
+
+    if (block) {
+        mpiError = MPI_Waitsome(numAdjRanks, c_recvRequests.data(),
+                                &numCompleted, indices.data(),
+                                statuses.data());
+        Insist(numCompleted != MPI_UNDEFINED,
+               "Waiting for data no adjacent rank owes.");
+    }
+    else {
+        mpiError = MPI_Testsome(numAdjRanks, c_recvRequests.data(),
+                                &numCompleted, indices.data(),
+                                statuses.data());
+    }
     Insist(mpiError == MPI_SUCCESS, "");
 
+    if (numCompleted == MPI_UNDEFINED)
+        return;
 
-    // Recv data from each adjacent rank
-    for (UINT index = 0; index < numAdjRanks; index++) {
-    
-        // Useful values
-        UINT onRankOffset = onRankOffsets[index];
-        uint32_t currentDataChunk = currentDataChunkVector[index];
-        uint32_t numPacketsRead = 
-            numPacketsReadVector[currentDataChunk][index];
-        uint32_t numPacketsWritten = 
-            headerDataVector[4 * index + 2 + currentDataChunk];
 
-        
-        // Read packets
-        UINT numPacketsToRecv = numPacketsWritten - numPacketsRead;
-        if (numPacketsToRecv > 0) {
-            
-            // Get data packets
-            UINT dataSizeInBytes = numPacketsToRecv * packetSizeInBytes;
-            UINT offset = onRankOffset + 16 +
-                          maxPackets * packetSizeInBytes * currentDataChunk + 
-                          numPacketsRead * packetSizeInBytes;
-            vector<char> dataPackets(dataSizeInBytes);
-
-            mpiError = MPI_Get(dataPackets.data(), dataSizeInBytes, 
-                               MPI_BYTE, myRank, offset, dataSizeInBytes, 
-                               MPI_BYTE, mpiWin);
-            Insist(mpiError == MPI_SUCCESS, "");
-            mpiError = MPI_Win_flush_local(myRank, mpiWin);
-            Insist(mpiError == MPI_SUCCESS, "");
-            
-            
-            // Unpack packets
-            for (UINT i = 0; i < numPacketsToRecv; i++) {
-                char *packet = &dataPackets[i * packetSizeInBytes];
-                UINT globalSide;
-                UINT angle;
-                char *packetData;
-                splitPacket(packet, globalSide, angle, &packetData);
-                
-                UINT localSide = g_tychoMesh->getGLSide(globalSide);
-                traverseData.setSideData(localSide, angle, packetData);
-                sideRecv.insert(make_pair(localSide,angle));
-            }
+    // Unpack data
+    for (int i = 0; i < numCompleted; i++) {
 
+        UINT index = indices[i];
+        int recvSize;
+        mpiError = MPI_Get_count(&statuses[i], MPI_BYTE, &recvSize);
+        Insist(mpiError == MPI_SUCCESS, "");
 
-            // Update numPacketsRead
-            numPacketsReadVector[currentDataChunk][index] = numPacketsWritten;
+        UINT dataSize = recvSize - sizeof(double);
+        UINT numPackets = dataSize / c_packetSizeInBytes;
+        Assert(dataSize % c_packetSizeInBytes == 0);
+        Assert(numPackets <= c_numPacketsLeft[index]);
+        memcpy(&c_neighborWait[index], &c_recvBuffers[index][dataSize], 
+               sizeof(double));
+
+        for (UINT packetIndex = 0; packetIndex < numPackets; packetIndex++) {
+            char *packet =
+                &c_recvBuffers[index][packetIndex * c_packetSizeInBytes];
+            UINT globalSide;
+            UINT angleIndex;
+            char *packetData;
+            splitPacket(packet, globalSide, angleIndex, &packetData);
+
+            UINT localSide = g_tychoMesh->getGLSide(globalSide);
+            traverseData.setSideData(localSide, angleIndex % g_nAngles, 
+                                     angleIndex / g_nAngles, packetData);
+            sideRecv.insert(make_pair(localSide, angleIndex));
         }
-    
-    
-        // Check to see if we need to move to other data chunk
-        if (headerDataVector[4 * index + currentDataChunk] == 1) {
-            
-            // Make sure all reads are completely done
-            mpiError = MPI_Win_flush(myRank, mpiWin);
-            Insist(mpiError == MPI_SUCCESS, "");
-            
-            // Set numWritten to zero
-            uint32_t zero1 = 0;
-            UINT offset = onRankOffset + 8 + 4 * currentDataChunk;
-            mpiError = MPI_Accumulate(&zero1, 1, MPI_UINT32_T, myRank, offset, 
-                                      1, MPI_UINT32_T, MPI_REPLACE, mpiWin);
-            Insist(mpiError == MPI_SUCCESS, "");
 
-            // Set writable bit for this data chunk back to zero
-            uint32_t zero2 = 0;
-            offset = onRankOffset + 4 * currentDataChunk;
-            mpiError = MPI_Accumulate(&zero2, 1, MPI_UINT32_T, myRank, offset, 
-                                      1, MPI_UINT32_T, MPI_REPLACE, mpiWin);
-            Insist(mpiError == MPI_SUCCESS, "");
-            mpiError = MPI_Win_flush_local(myRank, mpiWin);
-            Insist(mpiError == MPI_SUCCESS, "");
-            
-            // Update internal state
-            numPacketsReadVector[currentDataChunk][index] = 0;
-            currentDataChunkVector[index] = (currentDataChunk + 1) % 2;
-        }
+        c_numPacketsLeft[index] -= numPackets;
+        if (c_numPacketsLeft[index] > 0)
+            postRecv(index);
     }
 }
 
 
-
 /*
-    sendAndRecvData()
-    
-    The algorithm is
-    - Irecv data size for all adjacent ranks
-    - ISend data size and then data (if any)
-    - Wait on recv of data size, then blocking recv for data if there is any.
-    
-    Data is sent in two steps to each adjacent rank.
-    First is the number of bytes of data that will be sent.
-    Second is the raw data in bytes.
-    The tag for the first send is 0.
-    The tag for the second send is 1.
-    
-    The raw data is made of data packets containing:
-    globalSide, angle, and data to send.
-    The data can have different meanings depending on the TraverseData 
-    subclass.
-    
-    When done traversing local graph, you want to stop all communication.
-    This is done by setting killComm to true.
-    To mark killing communication, sendSize is set to UINT64_MAX.
-    In this event, commDark[rank] is set to true on the receiving rank 
-    so we no longer look for communication from this rank.
+    TwoSidedComm::finish
+
+    Waits for all sends to complete.
 */
-static
-void sendAndRecvData(const vector<vector<char>> &sendBuffers, 
-                     const vector<UINT> &adjRankIndexToRank, 
-                     TraverseData &traverseData, 
-                     const UINT dataSizeInBytes, 
-                     set<pair<UINT,UINT>> &sideRecv,
-                     vector<bool> &commDark, const bool killComm)
+void TwoSidedComm::finish()
 {
-    // Check input
-    Assert(adjRankIndexToRank.size() == sendBuffers.size());
-    Assert(adjRankIndexToRank.size() == commDark.size());
-    
-    
-    // Variables
-    UINT numAdjRanks = adjRankIndexToRank.size();
     int mpiError;
-    
-    vector<UINT> recvSizes(numAdjRanks);
-    vector<UINT> sendSizes(numAdjRanks);
-    vector<MPI_Request> mpiRecvRequests(numAdjRanks);
-    vector<MPI_Request> mpiSendRequests;
-    UINT numRecv = numAdjRanks;
-    
-    
-    // Setup recv of data size
-    for (UINT index = 0; index < numAdjRanks; index++) {
-        
-        // No recv if adjRank is no longer communicating
-        if (commDark[index]) {
-            mpiRecvRequests[index] = MPI_REQUEST_NULL;
-            numRecv--;
-            continue;
-        }
-        
-        // Irecv data size
-        int numDataToRecv = 1;
-        int adjRank = adjRankIndexToRank[index];
-        int tag0 = 0;
-        
-        mpiError = MPI_Irecv(&recvSizes[index], numDataToRecv, MPI_UINT64_T, 
-                             adjRank, tag0, MPI_COMM_WORLD, 
-                             &mpiRecvRequests[index]);
-        Insist(mpiError == MPI_SUCCESS, "");
-    }
-    
-    
-    // Send data size and data
-    for (UINT index = 0; index < numAdjRanks; index++) {
-        
-        // Don't send if adjRank is no longer communicating
-        if (commDark[index])
-            continue;
-        
-        const vector<char> &sendBuffer = sendBuffers[index];
-        int numDataToSend = 1;
-        int adjRank = adjRankIndexToRank[index];
-        int tag0 = 0;
-        int tag1 = 1;
-        
-        
-        // Send data size
-        MPI_Request request;
-        sendSizes[index] = sendBuffer.size();
-        if (killComm)
-            sendSizes[index] = UINT64_MAX;
-        
-        mpiError = MPI_Isend(&sendSizes[index], numDataToSend, MPI_UINT64_T, 
-                             adjRank, tag0, MPI_COMM_WORLD, &request);
-        Insist(mpiError == MPI_SUCCESS, "");
-        mpiSendRequests.push_back(request);
-        
-        
-        // Send data
-        if (sendSizes[index] > 0 && sendSizes[index] != UINT64_MAX) {
-            MPI_Request request;
-            Assert(sendBuffer.size() < INT_MAX);
-            
-            mpiError = MPI_Isend(const_cast<char*>(sendBuffer.data()), 
-                                 sendBuffer.size(), 
-                                 MPI_BYTE, adjRank, tag1, 
-                                 MPI_COMM_WORLD, &request);
-            Insist(mpiError == MPI_SUCCESS, "");
-            mpiSendRequests.push_back(request);
-        }
-    }
-    
-    
-    // Recv data size and data
-    for (UINT numWaits = 0; numWaits < numRecv; numWaits++) {
-        
-        // Wait for a data size to arrive
-        int index;
-        mpiError = MPI_Waitany(mpiRecvRequests.size(), mpiRecvRequests.data(), 
-                               &index, MPI_STATUS_IGNORE);
-        Insist(mpiError == MPI_SUCCESS, "");
-        
 
-        // Recv data
-        if (recvSizes[index] > 0 && recvSizes[index] != UINT64_MAX) {
-            
-            int adjRank = adjRankIndexToRank[index];
-            int tag1 = 1;
-            vector<char> dataPackets(recvSizes[index]);
-            
-            mpiError = MPI_Recv(dataPackets.data(), recvSizes[index], 
-                                MPI_BYTE, adjRank, tag1, MPI_COMM_WORLD, 
-                                MPI_STATUS_IGNORE);
-            Insist(mpiError == MPI_SUCCESS, "");
-            
-            UINT packetSize = 2 * sizeof(UINT) + dataSizeInBytes;
-            UINT numPackets = recvSizes[index] / packetSize;
-            Assert(recvSizes[index] % packetSize == 0);
-            
-            for (UINT i = 0; i < numPackets; i++) {
-                char *packet = &dataPackets[i * packetSize];
-                UINT globalSide;
-                UINT angle;
-                char *packetData;
-                splitPacket(packet, globalSide, angle, &packetData);
-                
-                UINT localSide = g_tychoMesh->getGLSide(globalSide);
-                traverseData.setSideData(localSide, angle, packetData);
-                sideRecv.insert(make_pair(localSide,angle));
-            }
-        }
-        
-        
-        // Stop communication with this rank
-        if (recvSizes[index] == UINT64_MAX) {
-            commDark[index] = true;
-        }
+    for (UINT index = 0; index < c_numPacketsLeft.size(); index++) {
+        Insist(c_numPacketsLeft[index] == 0,
+               "Traversal finished before all data arrived.");
     }
-    
-    
-    // Make sure all sends are done
-    if (mpiSendRequests.size() > 0) {
-        mpiError = MPI_Waitall(mpiSendRequests.size(), mpiSendRequests.data(), 
+
+    if (c_sendRequests.size() > 0) {
+        mpiError = MPI_Waitall(c_sendRequests.size(), c_sendRequests.data(),
                                MPI_STATUSES_IGNORE);
         Insist(mpiError == MPI_SUCCESS, "");
     }
-
+    c_sendRequests.clear();
+    c_sendBuffers.clear();
 }
 
 
@@ -601,12 +476,50 @@ void sendAndRecvData(const vector<vector<char>> &sendBuffers,
     If doComm is true, graph traversal is global.
     If doComm is false, each mesh partition is traversed locally with no
     consideration for boundaries between partitions.
+    Each (cell, angle) pair is traversed numGroupBlocks times, once for each
+    block of energy groups.  The group blocks of a pair are independent, so
+    each has its own dependency counts, queue, and packets.
 */
 GraphTraverser::GraphTraverser(Direction direction, bool doComm, 
-                               UINT dataSizeInBytes)
+                               UINT dataSizeInBytes, UINT numGroupBlocks)
     : c_direction(direction), c_doComm(doComm), 
-      c_dataSizeInBytes(dataSizeInBytes)
+      c_dataSizeInBytes(dataSizeInBytes), c_numGroupBlocks(numGroupBlocks),
+      c_waitFraction(0.0),
+      c_eagerFlush(false), c_flushNumPackets(0), c_patchGraph(NULL), 
+      c_angleBatchSize(1), c_prefetchLookahead(0), c_reduceTimes(true),
+      c_numRecordedSteps(0)
 {
+    // Queues of ready pairs, one per angle group and group block
+    // A traverser without group blocks spreads its angles over all queues
+    UINT numQueues = g_nThreads / g_nThreadsPerAngleGroup;
+    Insist(numQueues % c_numGroupBlocks == 0, 
+           "Group blocks must divide the number of queues.");
+    c_numAngleIndices = g_nAngles * c_numGroupBlocks;
+    c_numAngleGroups = numQueues / c_numGroupBlocks;
+    c_numQueues = numQueues;
+    
+    
+    // Dependency counts for each queue are stored together, with a cache
+    // line between queues, so threads on different queues don't share
+    // cache lines
+    c_queueAngleIndices.resize(c_numQueues);
+    for (UINT angleIndex = 0; angleIndex < c_numAngleIndices; angleIndex++) {
+        c_queueAngleIndices[queueIndex(angleIndex)].push_back(angleIndex);
+    }
+    
+    c_dependencyOffsets.resize(c_numAngleIndices);
+    c_dependencyStrides.resize(c_numAngleIndices);
+    c_numDependencySlots = 0;
+    for (const vector<UINT> &angleIndices : c_queueAngleIndices) {
+        UINT numAngleIndices = angleIndices.size();
+        for (UINT i = 0; i < numAngleIndices; i++) {
+            c_dependencyOffsets[angleIndices[i]] = c_numDependencySlots + i;
+            c_dependencyStrides[angleIndices[i]] = numAngleIndices;
+        }
+        c_numDependencySlots += numAngleIndices * g_nCells + c_padUINTs;
+    }
+    
+    
     // Get adjacent ranks
     for (UINT cell = 0; cell < g_nCells; cell++) {
     for (UINT face = 0; face < g_nFacePerCell; face++) {
@@ -625,30 +538,61 @@ GraphTraverser::GraphTraverser(Direction direction, bool doComm,
     }}
     
     
-    // Calc num dependencies for each (cell, angle) pair
-    c_initNumDependencies.resize(g_nAngles, g_nCells);
+    // Count packets sent to and received from each adjacent rank
+    // during one traversal
+    UINT numAdjRanks = c_adjRankIndexToRank.size();
+    c_numSendPackets.resize(numAdjRanks, 0);
+    c_numRecvPackets.resize(numAdjRanks, 0);
     for (UINT cell = 0; cell < g_nCells; cell++) {
-    for (UINT angle = 0; angle < g_nAngles; angle++) {
+    for (UINT face = 0; face < g_nFacePerCell; face++) {
         
-        c_initNumDependencies(angle, cell) = 0;
-        for (UINT face = 0; face < g_nFacePerCell; face++) {
-            
-            bool incoming = isIncoming(angle, cell, face, c_direction);
-            UINT adjRank = g_tychoMesh->getAdjRank(cell, face);
-            UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
-            
-            if (c_doComm && incoming && adjRank != TychoMesh::BAD_RANK) {
-                c_initNumDependencies(angle, cell)++;
-            }
-            else if (!c_doComm && incoming && adjCell != TychoMesh::BOUNDARY_FACE) {
-                c_initNumDependencies(angle, cell)++;
+        UINT adjRank = g_tychoMesh->getAdjRank(cell, face);
+        UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
+        
+        if (adjCell == TychoMesh::BOUNDARY_FACE && 
+            adjRank != TychoMesh::BAD_RANK)
+        {
+            UINT rankIndex = c_adjRankToRankIndex.at(adjRank);
+            for (UINT angle = 0; angle < g_nAngles; angle++) {
+                if (isIncoming(angle, cell, face, c_direction))
+                    c_numRecvPackets[rankIndex] += c_numGroupBlocks;
+                else
+                    c_numSendPackets[rankIndex] += c_numGroupBlocks;
             }
         }
     }}
-
-
+    
+    
+    // Adjacent ranks haven't reported waiting yet
+    c_neighborWait.assign(numAdjRanks, 0.0);
+    
+    
+    // Dependencies on other ranks for replaying a recorded order
+    // Threads sharing an angle group don't compute in a fixed order
+    bool replayTraversal = g_replayTraversal && g_nThreadsPerAngleGroup == 1;
+    c_replayState = replayTraversal ? ReplayState_Record : ReplayState_Off;
+    if (replayTraversal) {
+        c_replayDependencies.assign(c_numDependencySlots, 0);
+        for (UINT cell = 0; cell < g_nCells; cell++) {
+        for (UINT angleIndex = 0; angleIndex < c_numAngleIndices; 
+             angleIndex++)
+        {
+            
+            UINT angle = angleIndex % g_nAngles;
+            UINT count = g_dependencyGraph->getNumRemoteParents(
+                c_direction, cell, angle);
+            if (c_doComm && count > 0) {
+                c_remoteDependencies.push_back(
+                    make_pair(dependencyIndex(cell, angleIndex), count));
+            }
+        }}
+    }
+    
+    
     // Setup one-sided MPI
-    if (g_useOneSidedMPI) {
+    // Only needed for global traversals.  doComm is the same on all ranks, 
+    // so the collective window allocation is safe.
+    if (g_useOneSidedMPI && c_doComm) {
         setupOneSidedMPI();
     }
 }
@@ -656,31 +600,55 @@ GraphTraverser::GraphTraverser(Direction direction, bool doComm,
 
 /*
     setupOneSidedMPI
+
+    The window has a region for each adjacent rank.  A region is a header
+    followed by a ring buffer of packets written by the adjacent rank.
+    The ring buffer holds one traversal's worth of packets from the adjacent
+    rank, which is known from the mesh.
+
+    The header is three uint64_t values written by the adjacent rank with
+    MPI_Accumulate (never by this rank):
+    - Number of packets the adjacent rank has written into the ring buffer.
+    - Number of packets this rank has written into the adjacent rank's ring
+      buffer that the adjacent rank has consumed (credits).
+    - The adjacent rank's wait fraction (a double) for adaptive step sizes.
+    Both counters only increase, so they stay valid across traversals.
+    The credits are sent along with any data going back to the writer, so
+    flow control usually costs no extra messages.
+
+    All polling is of local window memory.  No rank reads remote memory.
 */
 void GraphTraverser::setupOneSidedMPI()
 {
     int mpiError;
-    c_maxPackets = 10 * g_maxCellsPerStep;
-    
-    
-    // Allocate MPI_Win
     UINT numAdjRanks = c_adjRankIndexToRank.size();
     UINT packetSize = 2 * sizeof(UINT) + c_dataSizeInBytes;
-    UINT windowSizeInBytes = 
-        (16 + 2 * c_maxPackets * packetSize) * numAdjRanks;
+
+
+    // Setup onRankOffsets
+    UINT windowSizeInBytes = 0;
+    c_onRankOffsets.resize(numAdjRanks);
+    for (UINT i = 0; i < numAdjRanks; i++) {
+        c_onRankOffsets[i] = windowSizeInBytes;
+        windowSizeInBytes += c_headerSize + c_numRecvPackets[i] * packetSize;
+    }
+
+
+    // Allocate MPI_Win
     MPI_Info mpiInfo;
     MPI_Info_create(&mpiInfo);
     MPI_Info_set(mpiInfo, "accumulate_ops", "same_op_no_op");
-    MPI_Win_allocate(windowSizeInBytes, 1, mpiInfo, 
+    MPI_Win_allocate(windowSizeInBytes, 1, mpiInfo,
                      MPI_COMM_WORLD, &c_mpiWinMemory, &c_mpiWin);
     MPI_Info_free(&mpiInfo);
 
 
-    // Setup onRankOffsets
-    c_onRankOffsets.resize(numAdjRanks);
-    for (UINT i = 0; i < numAdjRanks; i++) {
-        c_onRankOffsets[i] = i * (16 + 2 * c_maxPackets * packetSize);
-    }
+    // Local polling of the window needs the unified memory model
+    int *memoryModel;
+    int flag;
+    MPI_Win_get_attr(c_mpiWin, MPI_WIN_MODEL, &memoryModel, &flag);
+    Insist(flag && *memoryModel == MPI_WIN_UNIFIED,
+           "One-sided MPI requires the unified memory model.");
 
 
     // Setup offRankOffsets
@@ -690,112 +658,659 @@ void GraphTraverser::setupOneSidedMPI()
     for (UINT i = 0; i < numAdjRanks; i++) {
         UINT adjRank = c_adjRankIndexToRank[i];
         int tag = 0;
-        
+
         // Send index
-        mpiError = MPI_Isend(&c_onRankOffsets[i], 1, MPI_UINT64_T, adjRank, 
+        mpiError = MPI_Isend(&c_onRankOffsets[i], 1, MPI_UINT64_T, adjRank,
                              tag, MPI_COMM_WORLD, &mpiSendRequests[i]);
         Insist(mpiError == MPI_SUCCESS, "");
 
         // Recv index
-        mpiError = MPI_Irecv(&c_offRankOffsets[i], 1, MPI_UINT64_T, adjRank, 
+        mpiError = MPI_Irecv(&c_offRankOffsets[i], 1, MPI_UINT64_T, adjRank,
                              tag, MPI_COMM_WORLD, &mpiRecvRequests[i]);
         Insist(mpiError == MPI_SUCCESS, "");
     }
-    
+
 
     // Wait for messages to send/recv
     if (numAdjRanks > 0) {
-        mpiError = MPI_Waitall(mpiSendRequests.size(), mpiSendRequests.data(), 
+        mpiError = MPI_Waitall(mpiSendRequests.size(), mpiSendRequests.data(),
                                MPI_STATUSES_IGNORE);
         Insist(mpiError == MPI_SUCCESS, "");
-        
-        mpiError = MPI_Waitall(mpiRecvRequests.size(), mpiRecvRequests.data(), 
+
+        mpiError = MPI_Waitall(mpiRecvRequests.size(), mpiRecvRequests.data(),
                                MPI_STATUSES_IGNORE);
         Insist(mpiError == MPI_SUCCESS, "");
     }
 
 
+    // Internal state
+    c_numWritten.assign(numAdjRanks, 0);
+    c_numRead.assign(numAdjRanks, 0);
+    c_numReadReturned.assign(numAdjRanks, 0);
+    c_headers.assign(3 * numAdjRanks, 0);
+    c_pendingSends.assign(numAdjRanks, vector<char>());
+
+
     // Lock the window to start RMA operations and set memory to zero
     MPI_Win_lock_all(MPI_MODE_NOCHECK, c_mpiWin);
     memset(c_mpiWinMemory, 0, windowSizeInBytes);
     MPI_Win_sync(c_mpiWin);
     Comm::barrier();
-    
+
 
     // Print out use of one-sided MPI
     if (Comm::rank() == 0) {
-        if (g_useOneSidedMPI)
-            printf("Using one-sided MPI.\n");
-        else
-            printf("NOT using one-sided MPI.\n");
+        printf("Using one-sided MPI.\n");
     }
 }
 
 
 /*
-    ~GraphTraverser
+    putHeader
+
+    Writes our counters into the header of the adjacent rank's region for
+    this rank: packets written to it, credits for packets read from it and
+    our wait fraction.
 */
-GraphTraverser::~GraphTraverser()
+void GraphTraverser::putHeader(const UINT rankIndex)
 {
-    if (g_useOneSidedMPI) {
-        MPI_Win_unlock_all(c_mpiWin);
-        MPI_Win_free(&c_mpiWin);
-    }
+    int mpiError;
+    int adjRank = c_adjRankIndexToRank[rankIndex];
+
+    c_headers[3 * rankIndex] = c_numWritten[rankIndex];
+    c_headers[3 * rankIndex + 1] = c_numRead[rankIndex];
+    memcpy(&c_headers[3 * rankIndex + 2], &c_waitFraction, sizeof(double));
+    mpiError = MPI_Accumulate(&c_headers[3 * rankIndex], 3, MPI_UINT64_T,
+                              adjRank, c_offRankOffsets[rankIndex],
+                              3, MPI_UINT64_T, MPI_REPLACE, c_mpiWin);
+    Insist(mpiError == MPI_SUCCESS, "");
+    c_numReadReturned[rankIndex] = c_numRead[rankIndex];
 }
 
 
 /*
-    traverse
-    
-    Traverses g_tychoMesh.
+    sendOneSided
+
+    Writes as many pending packets into each adjacent rank's ring buffer as
+    its credits allow.  Packets that don't fit are kept and retried on the
+    next call.  Credits are returned with the data, or on their own when half
+    of a ring buffer is waiting on them (or when returnAllCredits is set).
 */
-void GraphTraverser::traverse(const UINT maxComputePerStep,
-                              TraverseData &traverseData)
+void GraphTraverser::sendOneSided(const vector<vector<char>> &sendBuffers,
+                                  const bool returnAllCredits)
 {
-    vector<priority_queue<Tuple>> canCompute(g_nThreads);
-    Mat2<UINT> numDependencies(g_nAngles, g_nCells);
-    UINT numCellAnglePairsToCalculate = g_nAngles * g_nCells;
-    set<pair<UINT,UINT>> sideRecv;
-    Mat2<vector<char>> sendBuffers;
-    vector<vector<char>> sendBuffers1;
-    vector<bool> commDark;
-    Timer totalTimer;
-    Timer setupTimer;
-    Timer commTimer;
-    Timer sendTimer;
-    Timer recvTimer;
-    
+    int mpiError;
+    UINT numAdjRanks = c_adjRankIndexToRank.size();
+    UINT packetSize = 2 * sizeof(UINT) + c_dataSizeInBytes;
+    vector<UINT> numPacketsPut(numAdjRanks, 0);
+    bool dataPut = false;
 
-    // Start total timer
-    totalTimer.start();
-    setupTimer.start();
-    
-    
-    // Calc num dependencies for each (cell, angle) pair
-    for (UINT cell = 0; cell < g_nCells; cell++) {
-    for (UINT angle = 0; angle < g_nAngles; angle++) {
-        numDependencies(angle, cell) = c_initNumDependencies(angle, cell);
+
+    // Make credits written by adjacent ranks visible
+    MPI_Win_sync(c_mpiWin);
+
+
+    // Write data
+    for (UINT index = 0; index < numAdjRanks; index++) {
+
+        vector<char> &pending = c_pendingSends[index];
+        pending.insert(pending.end(),
+                       sendBuffers[index].begin(), sendBuffers[index].end());
+        if (pending.size() == 0)
+            continue;
+
+
+        // Number of free packets in the adjacent rank's ring buffer
+        uint64_t numConsumed;
+        memcpy(&numConsumed, c_mpiWinMemory + c_onRankOffsets[index] + 8,
+               sizeof(uint64_t));
+        UINT capacity = c_numSendPackets[index];
+        UINT numFree = capacity - (c_numWritten[index] - numConsumed);
+        UINT numPackets = min(numFree, (UINT)(pending.size() / packetSize));
+        if (numPackets == 0)
+            continue;
+
+
+        // Put the data, in two pieces if it wraps around the ring buffer
+        int adjRank = c_adjRankIndexToRank[index];
+        UINT start = c_numWritten[index] % capacity;
+        UINT numPackets1 = min(numPackets, capacity - start);
+        UINT numPackets2 = numPackets - numPackets1;
+        UINT offset = c_offRankOffsets[index] + c_headerSize + 
+                      start * packetSize;
+        mpiError = MPI_Put(pending.data(), numPackets1 * packetSize, MPI_BYTE,
+                           adjRank, offset, numPackets1 * packetSize,
+                           MPI_BYTE, c_mpiWin);
+        Insist(mpiError == MPI_SUCCESS, "");
+
+        if (numPackets2 > 0) {
+            offset = c_offRankOffsets[index] + c_headerSize;
+            mpiError = MPI_Put(pending.data() + numPackets1 * packetSize,
+                               numPackets2 * packetSize, MPI_BYTE,
+                               adjRank, offset, numPackets2 * packetSize,
+                               MPI_BYTE, c_mpiWin);
+            Insist(mpiError == MPI_SUCCESS, "");
+        }
+
+        c_numWritten[index] += numPackets;
+        numPacketsPut[index] = numPackets;
+        dataPut = true;
+    }
+
+
+    // Data must be at the targets before the counters saying it is there
+    if (dataPut) {
+        mpiError = MPI_Win_flush_all(c_mpiWin);
+        Insist(mpiError == MPI_SUCCESS, "");
+    }
+
+
+    // Update headers on adjacent ranks
+    bool headerPut = false;
+    for (UINT index = 0; index < numAdjRanks; index++) {
+
+        UINT creditsOwed = c_numRead[index] - c_numReadReturned[index];
+        UINT creditsThreshold = max((UINT)1, c_numRecvPackets[index] / 2);
+
+        if (numPacketsPut[index] > 0 ||
+            creditsOwed >= creditsThreshold ||
+            (returnAllCredits && creditsOwed > 0))
+        {
+            putHeader(index);
+            headerPut = true;
+        }
+
+        vector<char> &pending = c_pendingSends[index];
+        pending.erase(pending.begin(),
+                      pending.begin() + numPacketsPut[index] * packetSize);
+    }
+
+    if (headerPut) {
+        mpiError = MPI_Win_flush_local_all(c_mpiWin);
+        Insist(mpiError == MPI_SUCCESS, "");
+    }
+}
+
+
+/*
+    recvOneSided
+
+    Reads all newly written packets from the ring buffers in local window
+    memory.  Credits for them go back with the next sendOneSided.
+*/
+template <typename TraverseDataType>
+void GraphTraverser::recvOneSided(TraverseDataType &traverseData,
+                                  set<pair<UINT,UINT>> &sideRecv)
+{
+    UINT numAdjRanks = c_adjRankIndexToRank.size();
+    UINT packetSize = 2 * sizeof(UINT) + c_dataSizeInBytes;
+
+
+    // Make data written by adjacent ranks visible
+    MPI_Win_sync(c_mpiWin);
+
+
+    // Recv data from each adjacent rank
+    for (UINT index = 0; index < numAdjRanks; index++) {
+
+        char *region = c_mpiWinMemory + c_onRankOffsets[index];
+        uint64_t numWritten;
+        memcpy(&numWritten, region, sizeof(uint64_t));
+        memcpy(&c_neighborWait[index], region + 2 * sizeof(uint64_t), 
+               sizeof(double));
+
+        UINT capacity = c_numRecvPackets[index];
+        for (uint64_t i = c_numRead[index]; i < numWritten; i++) {
+            char *packet = region + c_headerSize + (i % capacity) * packetSize;
+            UINT globalSide;
+            UINT angleIndex;
+            char *packetData;
+            splitPacket(packet, globalSide, angleIndex, &packetData);
+
+            UINT localSide = g_tychoMesh->getGLSide(globalSide);
+            traverseData.setSideData(localSide, angleIndex % g_nAngles, 
+                                     angleIndex / g_nAngles, packetData);
+            sideRecv.insert(make_pair(localSide, angleIndex));
+        }
+        c_numRead[index] = numWritten;
+    }
+}
+
+
+/*
+    finishOneSided
+
+    Called when the local traversal is done.  All of this traversal's data
+    has been received, so return the remaining credits and write out any
+    packets flow control held back.
+*/
+void GraphTraverser::finishOneSided()
+{
+    const vector<vector<char>> emptyBuffers(c_adjRankIndexToRank.size());
+    const bool returnAllCredits = true;
+
+    while (true) {
+        sendOneSided(emptyBuffers, returnAllCredits);
+
+        bool done = true;
+        for (const vector<char> &pending : c_pendingSends) {
+            if (pending.size() > 0)
+                done = false;
+        }
+
+        if (done)
+            break;
+    }
+}
+
+
+/*
+    ~GraphTraverser
+*/
+GraphTraverser::~GraphTraverser()
+{
+    if (g_useOneSidedMPI && c_doComm) {
+        MPI_Win_unlock_all(c_mpiWin);
+        MPI_Win_free(&c_mpiWin);
+    }
+}
+
+
+/*
+    setEagerFlush
+    
+    Ends a step early so outgoing data is sent right away when either
+    - a packet is for a (side, angle) pair whose downstream b-level is at
+      least bLevelThreshold, or
+    - a thread has numPacketsThreshold packets for one adjacent rank.
+    sideBLevels(side, angle) is the global b-level of the cell across an
+    outgoing interior boundary side.
+    A threshold of 0 turns off that part of the test.
+*/
+void GraphTraverser::setEagerFlush(const Mat2<UINT> &sideBLevels, 
+                                   const UINT bLevelThreshold, 
+                                   const UINT numPacketsThreshold)
+{
+    UINT numSides = g_tychoMesh->getNSides();
+    
+    c_criticalSides.resize(numSides, g_nAngles);
+    for (UINT side = 0; side < numSides; side++) {
+    for (UINT angle = 0; angle < g_nAngles; angle++) {
+        c_criticalSides(side, angle) = bLevelThreshold > 0 && 
+            sideBLevels(side, angle) >= bLevelThreshold;
     }}
     
+    c_flushNumPackets = numPacketsThreshold;
+    c_eagerFlush = c_doComm;
+}
+
+
+/*
+    setPatchGraph
+    
+    Traverse (patch, angle) pairs of patchGraph instead of (cell, angle) 
+    pairs.  Only for forward traversals.  Recording and replay of the
+    traversal order is turned off.
+*/
+void GraphTraverser::setPatchGraph(const PatchGraph *patchGraph)
+{
+    Insist(c_direction == Direction_Forward, 
+           "Patch graphs are only for forward traversals.");
+    Insist(c_angleBatchSize == 1, 
+           "Patch graphs can't be used with angle batches.");
+    c_patchGraph = patchGraph;
+    c_replayState = ReplayState_Off;
+}
+
+
+/*
+    setAngleBatchSize
+    
+    Compute up to batchSize ready angles of a cell together when they have
+    the same boundary types (see gatherAngleBatch).  Not used with patch
+    graphs.
+*/
+void GraphTraverser::setAngleBatchSize(const UINT batchSize)
+{
+    Insist(batchSize >= 1, "Angle batch size must be >= 1.");
+    Insist(c_patchGraph == NULL || batchSize == 1, 
+           "Angle batches can't be used with patch graphs.");
+    c_angleBatchSize = batchSize;
+}
+
+
+/*
+    setPrefetchLookahead
+    
+    Before computing a pair, prefetch the data of the next lookahead pairs
+    (see traverse).  Zero turns prefetching off.
+*/
+void GraphTraverser::setPrefetchLookahead(const UINT lookahead)
+{
+    c_prefetchLookahead = lookahead;
+}
+
+
+/*
+    setReduceTimes
+    
+    If false, the times printed after a traversal are rank 0's, so 
+    traversals need no collective calls and ranks may do different 
+    numbers of them (see SweeperPBJ::sweepAsync).  Only for traversals 
+    without communication.
+*/
+void GraphTraverser::setReduceTimes(const bool reduceTimes)
+{
+    Insist(reduceTimes || !c_doComm, 
+           "Communicating traversals must reduce times.");
+    c_reduceTimes = reduceTimes;
+}
+
+
+/*
+    gatherAngleBatch
+    
+    Puts angleIndex and other ready angle indices of the cell in the same 
+    queue and group block into batch.  Only angles whose faces have the 
+    same boundary types (i.e. same incoming and outgoing faces) as 
+    angleIndex's are added, so they can be updated together.  Returns the 
+    batch size, at most min(c_angleBatchSize, maxBatchSize) and at least 1.
+    
+    Batched pairs get dependency count c_batchedCount so they aren't 
+    computed again when popped from the queue.
+*/
+UINT GraphTraverser::gatherAngleBatch(const UINT cell, const UINT angleIndex,
+                                      const UINT queue, 
+                                      const UINT maxBatchSize,
+                                      vector<UINT> &numDependencies,
+                                      UINT *batch) const
+{
+    UINT angle = angleIndex % g_nAngles;
+    UINT groupBlock = angleIndex / g_nAngles;
+    UINT batchSize = 1;
+    UINT batchSizeLimit = min(c_angleBatchSize, max((UINT)1, maxBatchSize));
+    BoundaryType bdryType[g_nFacePerCell];
+    g_dependencyGraph->getBoundaryTypes(cell, angle, bdryType);
+    
+    batch[0] = angleIndex;
+    numDependencies[dependencyIndex(cell, angleIndex)] = c_batchedCount;
+    
+    for (UINT otherAngleIndex : c_queueAngleIndices[queue]) {
+        
+        if (batchSize == batchSizeLimit)
+            break;
+        
+        UINT &count = numDependencies[dependencyIndex(cell, otherAngleIndex)];
+        if (count != 0 || otherAngleIndex / g_nAngles != groupBlock)
+            continue;
+        
+        BoundaryType otherBdryType[g_nFacePerCell];
+        g_dependencyGraph->getBoundaryTypes(cell, otherAngleIndex % g_nAngles,
+                                            otherBdryType);
+        bool sameFaces = true;
+        for (UINT face = 0; face < g_nFacePerCell; face++) {
+            if (otherBdryType[face] != bdryType[face])
+                sameFaces = false;
+        }
+        
+        if (sameFaces) {
+            batch[batchSize] = otherAngleIndex;
+            batchSize++;
+            count = c_batchedCount;
+        }
+    }
+    
+    return batchSize;
+}
+
+
+/*
+    adaptCellsPerStep
+    
+    Adaptive mode for the number of cell/angle pairs each thread computes 
+    per step.
+    A thread's step size grows when communication overhead keeps the 
+    compute fraction of a step below g_targetOverlap.
+    It shrinks when an adjacent rank reports waiting on data for more than
+    1 - g_targetOverlap of its time, since smaller steps send data sooner.
+    Time spent waiting on data here is left to the upstream ranks to fix.
+    Only threads that used their whole step size are changed.
+*/
+void GraphTraverser::adaptCellsPerStep(const vector<UINT> &stepsTaken, 
+                                       const vector<UINT> &maxComputeThisStep,
+                                       const vector<Timer> &computeTimers,
+                                       const double commTime,
+                                       const double waitTime)
+{
+    const double growFactor = 1.25;
+    const double shrinkFactor = 0.8;
+    const double maxCellsPerStep = g_nCells * c_numAngleIndices;
+    
+    double neighborWait = 0.0;
+    for (double wait : c_neighborWait) {
+        neighborWait = max(neighborWait, wait);
+    }
+    
+    for (UINT thread = 0; thread < g_nThreads; thread++) {
+        
+        if (stepsTaken[thread] < maxComputeThisStep[thread])
+            continue;
+        
+        double computeTime = computeTimers[thread].wall_clock();
+        double totalTime = computeTime + commTime + waitTime;
+        if (totalTime <= 0.0)
+            continue;
+        
+        double overlap = computeTime / totalTime;
+        double &cellsPerStep = c_cellsPerStep[thread];
+        
+        if (neighborWait > 1.0 - g_targetOverlap) {
+            cellsPerStep = max(1.0, cellsPerStep * shrinkFactor);
+        }
+        else if (overlap < g_targetOverlap && commTime >= waitTime) {
+            cellsPerStep = min(maxCellsPerStep, cellsPerStep * growFactor);
+        }
+    }
+}
+
+
+/*
+    queueIndex
+    
+    Queue for an angle index.  Queues are ordered by angle group, then by
+    group block.
+*/
+UINT GraphTraverser::queueIndex(const UINT angleIndex) const
+{
+    UINT angle = angleIndex % g_nAngles;
+    UINT groupBlock = angleIndex / g_nAngles;
+    return angleGroupIndex(angle, c_numAngleGroups) * c_numGroupBlocks + 
+           groupBlock;
+}
+
+
+/*
+    dependencyIndex
+    
+    Index of the dependency count for a (task, angle index) pair.
+*/
+UINT GraphTraverser::dependencyIndex(const UINT task, 
+                                     const UINT angleIndex) const
+{
+    return c_dependencyOffsets[angleIndex] + 
+           task * c_dependencyStrides[angleIndex];
+}
+
+
+/*
+    getNumTasks
+    
+    Number of tasks for an angle: cells, or patches with a patch graph.
+*/
+UINT GraphTraverser::getNumTasks(const UINT angle) const
+{
+    return c_patchGraph != NULL ? c_patchGraph->getNumPatches(angle) : g_nCells;
+}
+
+
+/*
+    getFirstCell
+    
+    First cell computed for a task.  Its priority is the task's priority.
+*/
+UINT GraphTraverser::getFirstCell(const UINT task, const UINT angle) const
+{
+    return c_patchGraph != NULL ? *c_patchGraph->cellsBegin(task, angle) : task;
+}
+
+
+/*
+    traverse
+    
+    Traverses g_tychoMesh.
+    
+    With ReplayTraversal, the first traversal records the order each thread
+    computes cell/angle pairs in and where each step ends.  Since every
+    dependency of a pair has the same angle index, and so the same thread, the
+    recorded order satisfies all on-rank dependencies.  Later traversals
+    compute the recorded pairs in order, only checking for data from other
+    ranks, with no priority queues or on-rank dependency counts.
+    
+    With a prefetch lookahead, the data for the next pairs a thread will 
+    likely compute (the next pairs of a replay order, or the top of the 
+    queue's heap) is prefetched before computing each pair, so the loads 
+    overlap with the computation.
     
-    // Set size of sendBuffers and commDark
+    TraverseDataType is a final subclass of TraverseData, so calls to
+    traverseData are not virtual and can be inlined into the loop.
+    The virtual TraverseData version is kept for other subclasses.
+*/
+template <typename TraverseDataType>
+void GraphTraverser::traverse(const UINT maxComputePerStep,
+                              TraverseDataType &traverseData)
+{
+    vector<TaskQueue> canCompute(c_numQueues);
+    bool cellParallel = g_nThreadsPerAngleGroup > 1;
+    bool patches = c_patchGraph != NULL;
+    bool batching = c_angleBatchSize > 1;
+    vector<omp_lock_t> canComputeLocks(c_numQueues);
+    vector<UINT> numInFlight(c_numQueues * c_padUINTs, 0);
+    vector<UINT> numFinished(c_numQueues * c_padUINTs, 0);
+    bool replay = c_replayState == ReplayState_Replay;
+    bool record = c_replayState == ReplayState_Record;
+    bool fifo = !traverseData.hasPriorities();
+    vector<UINT> replayPosition(g_nThreads, 0);
+    vector<UINT> replayStep(g_nThreads, 0);
+    UINT numSteps = 0;
+    vector<UINT> dynamicDependencies;
+    vector<UINT> &numDependencies = 
+        replay ? c_replayDependencies : dynamicDependencies;
+    UINT numCellAnglePairsToCalculate = c_numAngleIndices * g_nCells;
+    set<pair<UINT,UINT>> sideRecv;
+    Mat2<vector<char>> sendBuffers;
+    vector<vector<char>> sendBuffers1;
+    bool useTwoSided = c_doComm && !g_useOneSidedMPI;
+    TwoSidedComm twoSidedComm(c_adjRankIndexToRank, 
+                              useTwoSided ? c_numRecvPackets : 
+                                  vector<UINT>(c_numRecvPackets.size(), 0),
+                              2 * sizeof(UINT) + c_dataSizeInBytes,
+                              c_neighborWait);
+    bool adaptive = g_adaptiveCellsPerStep && c_doComm && 
+                    maxComputePerStep != UINT64_MAX;
+    vector<UINT> maxComputeThisStep(g_nThreads, maxComputePerStep);
+    vector<UINT> stepsTaken(g_nThreads);
+    vector<Timer> computeTimers(g_nThreads);
+    double stepWaitTime = 0.0;
+    double waitTime = 0.0;
+    bool flushNow;
+    UINT numEagerFlushes = 0;
+    const UINT packetSizeInBytes = 2 * sizeof(UINT) + c_dataSizeInBytes;
+    const BoundaryType sendBdryType = c_direction == Direction_Forward ? 
+        BoundaryType_OutIntBdry : BoundaryType_InIntBdry;
+    Timer totalTimer;
+    Timer setupTimer;
+    Timer commTimer;
+    Timer sendTimer;
+    Timer recvTimer;
+    
+
+    // Start total timer
+    totalTimer.start();
+    setupTimer.start();
+    
+    
+    // Locks for queues shared by threads in an angle group
+    for (UINT queue = 0; queue < c_numQueues && cellParallel; queue++) {
+        omp_init_lock(&canComputeLocks[queue]);
+    }
+    
+    
+    // Calc num dependencies for each (task, angle index) pair
+    // A task is a cell, or a patch of cells when using a patch graph
+    // A replay only tracks dependencies on other ranks
+    if (replay) {
+        for (auto indexCount : c_remoteDependencies) {
+            numDependencies[indexCount.first] = indexCount.second;
+        }
+    }
+    else {
+        numDependencies.assign(c_numDependencySlots, 0);
+        for (UINT angleIndex = 0; angleIndex < c_numAngleIndices; 
+             angleIndex++)
+        {
+            UINT angle = angleIndex % g_nAngles;
+            for (UINT task = 0; task < getNumTasks(angle); task++) {
+                numDependencies[dependencyIndex(task, angleIndex)] = 
+                    patches ? 
+                    c_patchGraph->getNumParents(c_doComm, task, angle) :
+                    g_dependencyGraph->getNumParents(c_direction, c_doComm, 
+                                                     task, angle);
+            }
+        }
+    }
+    
+    if (record) {
+        c_replayOrder.assign(g_nThreads, vector<UINT>());
+        c_replayStepEnds.assign(g_nThreads, vector<UINT>());
+    }
+    
+    
+    // Set size of sendBuffers
     UINT numAdjRanks = c_adjRankIndexToRank.size();
-    sendBuffers.resize(g_nThreads, numAdjRanks);
+    // Each thread's buffers are padded to keep them off other threads' 
+    // cache lines
+    const UINT bufferSize = sizeof(vector<char>);
+    UINT sendBuffersPad = (g_nBytesPerCacheLine + bufferSize - 1) / bufferSize;
+    sendBuffers.resize(numAdjRanks + sendBuffersPad, g_nThreads);
     sendBuffers1.resize(numAdjRanks);
-    commDark.resize(numAdjRanks, false);
     
     
     // Initialize canCompute queue
-    for (UINT cell = 0; cell < g_nCells; cell++) {
-    for (UINT angle = 0; angle < g_nAngles; angle++) {
-        if (numDependencies(angle, cell) == 0) {
-            UINT priority = traverseData.getPriority(cell, angle);
-            UINT angleGroup = angleGroupIndex(angle);
-            canCompute[angleGroup].push(Tuple(cell, angle, priority));
+    for (UINT queue = 0; queue < c_numQueues; queue++) {
+        canCompute[queue].setFifo(fifo);
+    }
+    for (UINT angleIndex = 0; angleIndex < c_numAngleIndices && !replay; 
+         angleIndex++)
+    {
+        UINT angle = angleIndex % g_nAngles;
+        for (UINT task = 0; task < getNumTasks(angle); task++) {
+            if (numDependencies[dependencyIndex(task, angleIndex)] == 0) {
+                UINT priority = fifo ? 0 :
+                    traverseData.getPriority(getFirstCell(task, angle), angle);
+                canCompute[queueIndex(angleIndex)].push(
+                    Tuple(task, angleIndex, priority));
+            }
         }
-    }}
+    }
 
 
+    // Initial step sizes for adaptive mode
+    // Step sizes carry over from the last traversal
+    if (adaptive && c_cellsPerStep.size() == 0) {
+        c_cellsPerStep.assign(g_nThreads, maxComputePerStep);
+    }
+    
+    
     // End setup timer
     setupTimer.stop();
     
@@ -803,141 +1318,330 @@ void GraphTraverser::traverse(const UINT maxComputePerStep,
     // Traverse the graph
     while (numCellAnglePairsToCalculate > 0) {
         
+        // Step sizes for a replay come from the recorded steps
+        if (replay) {
+            for (UINT thread = 0; thread < g_nThreads; thread++) {
+                const vector<UINT> &stepEnds = c_replayStepEnds[thread];
+                UINT &step = replayStep[thread];
+                while (step < stepEnds.size() && 
+                       replayPosition[thread] == stepEnds[step])
+                {
+                    step++;
+                }
+                maxComputeThisStep[thread] = step < stepEnds.size() ? 
+                    stepEnds[step] - replayPosition[thread] : 0;
+            }
+        }
+        
+        // Step sizes for adaptive mode
+        else if (adaptive) {
+            for (UINT thread = 0; thread < g_nThreads; thread++) {
+                maxComputeThisStep[thread] = 
+                    (UINT)c_cellsPerStep[thread];
+            }
+        }
+        
+        
         // Do local traversal
+        // With eager flushing, all threads end the step once any thread 
+        // has data that should be sent right away
+        flushNow = false;
         #pragma omp parallel
         {
-            UINT stepsTaken = 0;
-            UINT angleGroup = omp_get_thread_num();
-            while (canCompute[angleGroup].size() > 0 && 
-                   stepsTaken < maxComputePerStep)
-            {
-                // Get cell/angle pair to compute
-                Tuple cellAnglePair = canCompute[angleGroup].top();
-                canCompute[angleGroup].pop();
-                UINT cell = cellAnglePair.getCell();
-                UINT angle = cellAnglePair.getAngle();
-                stepsTaken++;
-                
-                #pragma omp atomic
-                numCellAnglePairsToCalculate--;
-                
-                
-                // Get boundary type and adjacent cell/side data for each face
-                BoundaryType bdryType[g_nFacePerCell];
-                UINT adjCellsSides[g_nFacePerCell];
-                bool isOutgoingWrtDirection[g_nFacePerCell];
-                for (UINT face = 0; face < g_nFacePerCell; face++) {
+            UINT thread = omp_get_thread_num();
+            UINT queue = thread / g_nThreadsPerAngleGroup;
+            UINT numTaken = 0;
+            UINT position = replayPosition[thread];
+            vector<UINT> recorded;
+            vector<UINT> batch(c_angleBatchSize);
+            vector<UINT> batchAngles(c_angleBatchSize);
+            vector<pair<UINT,UINT>> lookahead;
+            bool flush = false;
+            computeTimers[thread].start();
+            while (numTaken < maxComputeThisStep[thread] && !flush) {
+                // Get task/angle pair to compute
+                // A replay stalls if the next pair needs data from another
+                // rank that hasn't arrived
+                UINT task;
+                UINT angleIndex;
+                UINT batchSize = 1;
+                lookahead.clear();
+                if (replay) {
+                    const vector<UINT> &order = c_replayOrder[thread];
+                    UINT index = order[position];
+                    task = index / c_numAngleIndices;
+                    angleIndex = index % c_numAngleIndices;
+                    if (numDependencies[dependencyIndex(task, angleIndex)] > 0)
+                        break;
                     
-                    UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
-                    UINT adjRank = g_tychoMesh->getAdjRank(cell, face);
-                    adjCellsSides[face] = adjCell;
+                    position++;
+                    for (UINT i = position; i < order.size() && 
+                         i < position + c_prefetchLookahead; i++)
+                    {
+                        lookahead.push_back(
+                            make_pair(order[i] / c_numAngleIndices, 
+                                      order[i] % c_numAngleIndices));
+                    }
+                }
+                else {
+                    // Threads in an angle group share its queue.  If it is
+                    // empty, a thread waits while others in its group are
+                    // computing pairs that may have children.
+                    // Pairs already computed in another pair's angle batch
+                    // are skipped.
+                    bool haveWork = false;
+                    bool groupIdle = false;
+                    bool queueEmpty = false;
+                    UINT finishedSeen = 0;
+                    if (cellParallel)
+                        omp_set_lock(&canComputeLocks[queue]);
                     
-                    if (g_tychoMesh->isOutgoing(angle, cell, face)) {
-                        
-                        if (adjCell == TychoMesh::BOUNDARY_FACE && 
-                            adjRank != TychoMesh::BAD_RANK)
-                        {
-                            bdryType[face] = BoundaryType_OutIntBdry;
-                            adjCellsSides[face] = 
-                                g_tychoMesh->getSide(cell, face);
-                        }
-                        
-                        else if (adjCell == TychoMesh::BOUNDARY_FACE && 
-                                 adjRank == TychoMesh::BAD_RANK)
+                    if (canCompute[queue].size() > 0) {
+                        Tuple taskAnglePair = canCompute[queue].top();
+                        canCompute[queue].pop();
+                        task = taskAnglePair.getTask();
+                        angleIndex = taskAnglePair.getAngleIndex();
+                        if (!batching || 
+                            numDependencies[dependencyIndex(task, angleIndex)]
+                            != c_batchedCount)
                         {
-                            bdryType[face] = BoundaryType_OutExtBdry;
-                        }
-                        
-                        else {
-                            bdryType[face] = BoundaryType_OutInt;
-                        }
-                        
-                        if (c_direction == Direction_Forward) {
-                            isOutgoingWrtDirection[face] = true;
-                        }
-                        else {
-                            isOutgoingWrtDirection[face] = false;
+                            if (batching) {
+                                UINT maxBatchSize = maxComputeThisStep[thread]
+                                                    - numTaken;
+                                batchSize = gatherAngleBatch(
+                                    task, angleIndex, queue, maxBatchSize, 
+                                    numDependencies, batch.data());
+                            }
+                            if (cellParallel)
+                                numInFlight[queue * c_padUINTs]++;
+                            haveWork = true;
+                            
+                            UINT numPeek = min(c_prefetchLookahead, 
+                                               (UINT)canCompute[queue].size());
+                            for (UINT i = 0; i < numPeek; i++) {
+                                const Tuple &next = canCompute[queue].peek(i);
+                                lookahead.push_back(
+                                    make_pair(next.getTask(), 
+                                              next.getAngleIndex()));
+                            }
                         }
                     }
+                    else if (numInFlight[queue * c_padUINTs] == 0) {
+                        groupIdle = true;
+                    }
                     else {
-                        
-                        if (adjCell == TychoMesh::BOUNDARY_FACE && 
-                            adjRank != TychoMesh::BAD_RANK)
-                        {
-                            bdryType[face] = BoundaryType_InIntBdry;
-                            adjCellsSides[face] = 
-                                g_tychoMesh->getSide(cell, face);
-                        }
-                        
-                        else if (adjCell == TychoMesh::BOUNDARY_FACE && 
-                                 adjRank == TychoMesh::BAD_RANK)
-                        {
-                            bdryType[face] = BoundaryType_InExtBdry;
-                        }
-                        
-                        else {
-                            bdryType[face] = BoundaryType_InInt;
-                        }
-                        
-                        if (c_direction == Direction_Forward) {
-                            isOutgoingWrtDirection[face] = false;
-                        }
-                        else {
-                            isOutgoingWrtDirection[face] = true;
+                        queueEmpty = true;
+                        finishedSeen = numFinished[queue * c_padUINTs];
+                    }
+                    
+                    if (cellParallel)
+                        omp_unset_lock(&canComputeLocks[queue]);
+                    
+                    if (groupIdle)
+                        break;
+                    
+                    // Children are only pushed when a pair of the group 
+                    // finishes, so wait for that outside the lock the busy
+                    // threads need
+                    if (queueEmpty) {
+                        UINT finished = finishedSeen;
+                        while (finished == finishedSeen) {
+                            this_thread::yield();
+                            #pragma omp atomic read
+                            finished = numFinished[queue * c_padUINTs];
                         }
                     }
+                    if (!haveWork)
+                        continue;
+                    
+                }
+                if (batchSize == 1)
+                    batch[0] = angleIndex;
+                if (record) {
+                    for (UINT i = 0; i < batchSize; i++) {
+                        recorded.push_back(
+                            task * c_numAngleIndices + batch[i]);
+                    }
                 }
+                UINT angle = angleIndex % g_nAngles;
+                UINT groupBlock = angleIndex / g_nAngles;
                 
                 
-                // Update data for this cell-angle pair
-                traverseData.update(cell, angle, adjCellsSides, bdryType);
+                // Cells of the task, in the order they are computed
+                const UINT *cellsBegin = &task;
+                const UINT *cellsEnd = &task + 1;
+                if (patches) {
+                    cellsBegin = c_patchGraph->cellsBegin(task, angle);
+                    cellsEnd = c_patchGraph->cellsEnd(task, angle);
+                }
+                numTaken += (cellsEnd - cellsBegin) * batchSize;
                 
                 
-                // Update dependency for children
-                for (UINT face = 0; face < g_nFacePerCell; face++) {
+                // Prefetch data for the next pairs while this one computes
+                for (const pair<UINT,UINT> &next : lookahead) {
+                    UINT nextAngle = next.second % g_nAngles;
+                    traverseData.prefetch(getFirstCell(next.first, nextAngle),
+                                          nextAngle, next.second / g_nAngles);
+                }
+                
+                for (const UINT *cellIter = cellsBegin; cellIter != cellsEnd; 
+                     cellIter++)
+                {
+                    UINT cell = *cellIter;
                     
-                    if (isOutgoingWrtDirection[face]) {
-
-                        UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
-                        UINT adjRank = g_tychoMesh->getAdjRank(cell, face);
-                        
-                        if (adjCell != TychoMesh::BOUNDARY_FACE) {
-                            numDependencies(angle, adjCell)--;
-                            if (numDependencies(angle, adjCell) == 0) {
-                                UINT priority = 
-                                    traverseData.getPriority(adjCell, angle);
-                                Tuple tuple(adjCell, angle, priority);
-                                canCompute[angleGroup].push(tuple);
-                            }
+                    // Get boundary type and adjacent cell/side data for each
+                    // face
+                    BoundaryType bdryType[g_nFacePerCell];
+                    UINT adjCellsSides[g_nFacePerCell];
+                    g_dependencyGraph->getBoundaryTypes(cell, angle, bdryType);
+                    g_dependencyGraph->getAdjCellsSides(cell, adjCellsSides);
+                    
+                    
+                    // Update data for this cell and the angles in the 
+                    // batch, which all have these boundary types
+                    if (batchSize == 1) {
+                        traverseData.update(cell, angle, groupBlock, 
+                                            adjCellsSides, bdryType);
+                    }
+                    else {
+                        for (UINT i = 0; i < batchSize; i++) {
+                            batchAngles[i] = batch[i] % g_nAngles;
                         }
+                        traverseData.updateBatch(cell, batchAngles.data(), 
+                                                 batchSize, groupBlock, 
+                                                 adjCellsSides, bdryType);
+                    }
+                    
+                    
+                    // Send data to children on other ranks
+                    for (UINT face = 0; face < g_nFacePerCell && c_doComm; 
+                         face++)
+                    {
+                        if (bdryType[face] != sendBdryType)
+                            continue;
                         
-                        else if (c_doComm && adjRank != TychoMesh::BAD_RANK) {
-                            UINT rankIndex = c_adjRankToRankIndex.at(adjRank);
-                            UINT side = g_tychoMesh->getSide(cell, face);
-                            UINT globalSide = g_tychoMesh->getLGSide(side);
-                            
+                        UINT adjRank = g_tychoMesh->getAdjRank(cell, face);
+                        UINT rankIndex = c_adjRankToRankIndex.at(adjRank);
+                        UINT side = adjCellsSides[face];
+                        UINT globalSide = g_tychoMesh->getLGSide(side);
+                        
+                        for (UINT i = 0; i < batchSize; i++) {
+                            UINT sendAngle = batch[i] % g_nAngles;
                             vector<char> packet;
-                            createPacket(packet, globalSide, angle, 
+                            createPacket(packet, globalSide, batch[i], 
                                          c_dataSizeInBytes, 
-                                         traverseData.getData(cell, face, angle));
+                                         traverseData.getData(cell, face, 
+                                                              sendAngle, 
+                                                              groupBlock));
                             
-                            sendBuffers(angleGroup, rankIndex).insert(
-                                sendBuffers(angleGroup, rankIndex).end(), 
+                            sendBuffers(rankIndex, thread).insert(
+                                sendBuffers(rankIndex, thread).end(), 
                                 packet.begin(), packet.end());
+                            
+                            if (c_eagerFlush && !replay &&
+                                (c_criticalSides(side, sendAngle) || 
+                                 (c_flushNumPackets > 0 && 
+                                  sendBuffers(rankIndex, thread).size() >= 
+                                  c_flushNumPackets * packetSizeInBytes)))
+                            {
+                                #pragma omp atomic write
+                                flushNow = true;
+                            }
                         }
                     }
                 }
+                
+                
+                // Update dependency for children on this rank
+                // A replay doesn't track these
+                if (!replay) {
+                    if (cellParallel)
+                        omp_set_lock(&canComputeLocks[queue]);
+                    
+                    for (UINT i = 0; i < batchSize; i++) {
+                        UINT childAngleIndex = batch[i];
+                        UINT childAngle = childAngleIndex % g_nAngles;
+                        const UINT *child;
+                        const UINT *childEnd;
+                        if (patches) {
+                            child = c_patchGraph->childrenBegin(task, 
+                                                                childAngle);
+                            childEnd = c_patchGraph->childrenEnd(task, 
+                                                                 childAngle);
+                        }
+                        else {
+                            child = g_dependencyGraph->childrenBegin(
+                                c_direction, task, childAngle);
+                            childEnd = g_dependencyGraph->childrenEnd(
+                                c_direction, task, childAngle);
+                        }
+                        
+                        for (; child != childEnd; child++) {
+                            UINT adjTask = *child;
+                            UINT &count = numDependencies[
+                                dependencyIndex(adjTask, childAngleIndex)];
+                            count--;
+                            if (count == 0) {
+                                UINT priority = fifo ? 0 :
+                                    traverseData.getPriority(
+                                        getFirstCell(adjTask, childAngle), 
+                                        childAngle);
+                                Tuple tuple(adjTask, childAngleIndex, 
+                                            priority);
+                                canCompute[queue].push(tuple);
+                            }
+                        }
+                    }
+                    if (cellParallel) {
+                        numInFlight[queue * c_padUINTs]--;
+                        #pragma omp atomic update
+                        numFinished[queue * c_padUINTs]++;
+                    }
+                    
+                    if (cellParallel)
+                        omp_unset_lock(&canComputeLocks[queue]);
+                }
+                
+                if (c_eagerFlush && !replay) {
+                    #pragma omp atomic read
+                    flush = flushNow;
+                }
+            }
+            computeTimers[thread].stop();
+            
+            stepsTaken[thread] = numTaken;
+            replayPosition[thread] = position;
+            if (record) {
+                c_replayOrder[thread].insert(c_replayOrder[thread].end(), 
+                                             recorded.begin(), recorded.end());
             }
         }
         
+        if (flushNow)
+            numEagerFlushes++;
+        
+        for (UINT thread = 0; thread < g_nThreads; thread++) {
+            numCellAnglePairsToCalculate -= stepsTaken[thread];
+        }
+        
+        numSteps++;
+        if (record) {
+            for (UINT thread = 0; thread < g_nThreads; thread++) {
+                if (stepsTaken[thread] > 0) {
+                    c_replayStepEnds[thread].push_back(
+                        c_replayOrder[thread].size());
+                }
+            }
+        }
         
-        // Put together sendBuffers from different angleGroups
-        for (UINT angleGroup = 0; angleGroup < g_nThreads; angleGroup++) {
+        
+        // Put together sendBuffers from different threads
+        for (UINT thread = 0; thread < g_nThreads; thread++) {
         for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
             sendBuffers1[rankIndex].insert(
                 sendBuffers1[rankIndex].end(), 
-                sendBuffers(angleGroup, rankIndex).begin(), 
-                sendBuffers(angleGroup, rankIndex).end());
+                sendBuffers(rankIndex, thread).begin(), 
+                sendBuffers(rankIndex, thread).end());
         }}
                
         
@@ -948,34 +1652,68 @@ void GraphTraverser::traverse(const UINT maxComputePerStep,
             // Send/Recv
             sideRecv.clear();
             
+            // Block for data if there is nothing to compute
+            bool block = numCellAnglePairsToCalculate > 0;
+            for (UINT thread = 0; thread < g_nThreads && replay; thread++) {
+                const vector<UINT> &order = c_replayOrder[thread];
+                UINT position = replayPosition[thread];
+                if (position < order.size()) {
+                    UINT task = order[position] / c_numAngleIndices;
+                    UINT angleIndex = order[position] % c_numAngleIndices;
+                    if (numDependencies[dependencyIndex(task, angleIndex)] 
+                        == 0)
+                    {
+                        block = false;
+                    }
+                }
+            }
+            for (UINT queue = 0; queue < c_numQueues; queue++) {
+                if (canCompute[queue].size() > 0)
+                    block = false;
+            }
+            
             if (!g_useOneSidedMPI) {
-                const bool killComm = false;
-                sendAndRecvData(sendBuffers1, c_adjRankIndexToRank, traverseData, 
-                                c_dataSizeInBytes, sideRecv, commDark, killComm);
+                
+                sendTimer.start();
+                twoSidedComm.send(sendBuffers1, c_waitFraction);
+                sendTimer.stop();
+                
+                recvTimer.start();
+                twoSidedComm.recv(traverseData, sideRecv, block);
+                recvTimer.stop();
+                
+                if (block)
+                    stepWaitTime += recvTimer.wall_clock();
             }
             else {
-                UINT packetSizeInBytes = 2 * sizeof(UINT) + c_dataSizeInBytes;
-                static bool firstTime = true;
-
+                const bool returnAllCredits = false;
+                const vector<vector<char>> emptyBuffers(numAdjRanks);
+                
                 sendTimer.start();
-                sendData(sendBuffers1, c_adjRankIndexToRank, c_offRankOffsets, 
-                         packetSizeInBytes, c_maxPackets, c_mpiWin, firstTime);
+                sendOneSided(sendBuffers1, returnAllCredits);
                 sendTimer.stop();
 
+                // Poll the local window until data arrives instead of 
+                // starting empty steps, retrying packets held back by
+                // flow control
                 recvTimer.start();
-                recvData(c_adjRankIndexToRank.size(), c_onRankOffsets, 
-                         packetSizeInBytes, traverseData, sideRecv, 
-                         c_maxPackets, c_mpiWin, firstTime);
+                recvOneSided(traverseData, sideRecv);
+                while (block && sideRecv.empty()) {
+                    this_thread::yield();
+                    sendOneSided(emptyBuffers, returnAllCredits);
+                    recvOneSided(traverseData, sideRecv);
+                }
                 recvTimer.stop();
-
-                firstTime = false;
+                
+                if (block)
+                    stepWaitTime += recvTimer.wall_clock();
             }
 
             
             // Clear send buffers for next iteration
-            for (UINT angleGroup = 0; angleGroup < g_nThreads; angleGroup++) {
+            for (UINT thread = 0; thread < g_nThreads; thread++) {
             for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
-                sendBuffers(angleGroup, rankIndex).clear();
+                sendBuffers(rankIndex, thread).clear();
             }}
             
             for (UINT rankIndex = 0; rankIndex < numAdjRanks; rankIndex++) {
@@ -986,49 +1724,85 @@ void GraphTraverser::traverse(const UINT maxComputePerStep,
             // Update dependency for parents using received side data
             for (auto sideAngle : sideRecv) {
                 UINT side = sideAngle.first;
-                UINT angle = sideAngle.second;
+                UINT angleIndex = sideAngle.second;
+                UINT angle = angleIndex % g_nAngles;
                 UINT cell = g_tychoMesh->getSideCell(side);
-                numDependencies(angle, cell)--;
-                if (numDependencies(angle, cell) == 0) {
-                    UINT priority = traverseData.getPriority(cell, angle);
-                    Tuple tuple(cell, angle, priority);
-                    canCompute[angleGroupIndex(angle)].push(tuple);
+                UINT task = 
+                    patches ? c_patchGraph->getPatch(cell, angle) : cell;
+                UINT &count = 
+                    numDependencies[dependencyIndex(task, angleIndex)];
+                count--;
+                if (count == 0 && !replay) {
+                    UINT priority = fifo ? 0 : traverseData.getPriority(
+                        getFirstCell(task, angle), angle);
+                    Tuple tuple(task, angleIndex, priority);
+                    canCompute[queueIndex(angleIndex)].push(tuple);
                 }
             }
         }
         commTimer.stop();
+        
+        
+        // Update wait fraction and adapt step sizes
+        if (c_doComm) {
+            double computeTime = 0.0;
+            bool computed = false;
+            for (UINT thread = 0; thread < g_nThreads; thread++) {
+                computeTime = max(computeTime, 
+                                  computeTimers[thread].wall_clock());
+                if (stepsTaken[thread] > 0)
+                    computed = true;
+            }
+            
+            // With one-sided MPI, a step with no computation is all waiting
+            if (!computed && g_useOneSidedMPI)
+                stepWaitTime = commTimer.wall_clock();
+            
+            double stepTime = computeTime + commTimer.wall_clock();
+            if (stepTime > 0.0) {
+                c_waitFraction = 0.5 * c_waitFraction + 
+                                 0.5 * stepWaitTime / stepTime;
+            }
+            
+            waitTime += stepWaitTime;
+            if (adaptive && computed && !replay) {
+                adaptCellsPerStep(stepsTaken, maxComputeThisStep, 
+                                  computeTimers, commTimer.wall_clock() - 
+                                  stepWaitTime, waitTime);
+                waitTime = 0.0;
+            }
+            stepWaitTime = 0.0;
+        }
     }
     
     
-    // Send kill comm signal to adjacent ranks
-    if (!g_useOneSidedMPI) {
-        commTimer.start();
-        if (c_doComm) {
-            const bool killComm = true;
-            sendAndRecvData(sendBuffers1, c_adjRankIndexToRank, traverseData, 
-                            c_dataSizeInBytes, sideRecv, commDark, killComm);
-        }
-        commTimer.stop();
+    // Finish outstanding sends
+    // For one-sided MPI, also return credits and flush held back data
+    commTimer.start();
+    if (useTwoSided) {
+        twoSidedComm.finish();
     }
+    else if (c_doComm) {
+        finishOneSided();
+    }
+    commTimer.stop();
 
     
     // Print times
     totalTimer.stop();
 
     double totalTime = totalTimer.wall_clock();
-    Comm::gmax(totalTime);
-
     double setupTime = setupTimer.wall_clock();
-    Comm::gmax(setupTime);
-
     double commTime = commTimer.sum_wall_clock();
-    Comm::gmax(commTime);
-    
     double sendTime = sendTimer.sum_wall_clock();
-    Comm::gmax(sendTime);
-    
     double recvTime = recvTimer.sum_wall_clock();
-    Comm::gmax(recvTime);
+    if (c_reduceTimes) {
+        Comm::gmax(totalTime);
+        Comm::gmax(setupTime);
+        Comm::gmax(commTime);
+        Comm::gmax(sendTime);
+        Comm::gmax(recvTime);
+    }
     
     if (Comm::rank() == 0) {
         printf("      Traverse Timer (comm):    %fs\n", commTime);
@@ -1037,7 +1811,74 @@ void GraphTraverser::traverse(const UINT maxComputePerStep,
         printf("      Traverse Timer (setup):   %fs\n", setupTime);
         printf("      Traverse Timer (total):   %fs\n", totalTime);
     }
+    
+    
+    // Free locks
+    for (UINT queue = 0; queue < c_numQueues && cellParallel; queue++) {
+        omp_destroy_lock(&canComputeLocks[queue]);
+    }
+    
+    
+    // Replay the recorded order from now on, unless the replay stalled
+    // on data from other ranks so much that dynamic scheduling is better
+    if (record) {
+        c_numRecordedSteps = numSteps;
+        c_replayState = ReplayState_Replay;
+    }
+    else if (replay && numSteps > c_replayStallFactor * c_numRecordedSteps) {
+        c_replayState = ReplayState_Off;
+    }
+    
+    
+    // Print number of steps ended early by eager flushing
+    if (c_eagerFlush) {
+        Comm::gsum(numEagerFlushes);
+        if (Comm::rank() == 0) {
+            printf("      Eager flushes: %" PRIu64 "\n", numEagerFlushes);
+        }
+    }
+    
+    
+    // Print step sizes chosen by adaptive mode
+    // The average, rounded, is printed as a maxCellsPerStep deck line to 
+    // reuse the tuned setting without AdaptiveCellsPerStep
+    if (adaptive) {
+        double minCellsPerStep = *min_element(c_cellsPerStep.begin(), 
+                                              c_cellsPerStep.end());
+        double maxCellsPerStep = *max_element(c_cellsPerStep.begin(), 
+                                              c_cellsPerStep.end());
+        double avgCellsPerStep = 0.0;
+        for (double cellsPerStep : c_cellsPerStep) {
+            avgCellsPerStep += cellsPerStep / g_nThreads;
+        }
+        
+        minCellsPerStep = -minCellsPerStep;
+        Comm::gmax(minCellsPerStep);
+        minCellsPerStep = -minCellsPerStep;
+        Comm::gmax(maxCellsPerStep);
+        Comm::gsum(avgCellsPerStep);
+        avgCellsPerStep /= Comm::numRanks();
+        
+        if (Comm::rank() == 0) {
+            printf("      Adaptive cells per step (min/avg/max): "
+                   "%.0f / %.0f / %.0f\n", 
+                   minCellsPerStep, avgCellsPerStep, maxCellsPerStep);
+            printf("      Suggested deck setting: maxCellsPerStep %.0f\n", 
+                   max(avgCellsPerStep, 1.0));
+        }
+    }
 }
 
 
+/*
+    Instantiations of traverse
+*/
+template void GraphTraverser::traverse<TraverseData>(
+    const UINT maxComputePerStep, TraverseData &traverseData);
+template void GraphTraverser::traverse<SweepData>(
+    const UINT maxComputePerStep, SweepData &traverseData);
+template void GraphTraverser::traverse<BLevelData>(
+    const UINT maxComputePerStep, BLevelData &traverseData);
+template void GraphTraverser::traverse<NeighborPriorityData>(
+    const UINT maxComputePerStep, NeighborPriorityData &traverseData);
 
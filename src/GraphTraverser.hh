@@ -42,52 +42,58 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "Global.hh"
 #include "Mat.hh"
+#include "DependencyGraph.hh"
+#include "Timer.hh"
 #include <mpi.h>
 #include <vector>
 #include <map>
-
-/*
-    Boundary Type for faces of a cell.
-    They are split into incoming and outgoing wrt sweep direction.
-    Interior means adjacent cell is on same proc.
-    Interior boundary means adj cell is on different proc.
-    Exterior boundary means it is a boundary for the whole mesh.
-*/
-enum BoundaryType
-{
-    // Outgoing
-    BoundaryType_OutIntBdry,    // Interior boundary
-    BoundaryType_OutExtBdry,    // Exterior boundary
-    BoundaryType_OutInt,        // Interior
-    
-    // Incoming
-    BoundaryType_InIntBdry,     // Interior boundary
-    BoundaryType_InExtBdry,     // Exterior boundary
-    BoundaryType_InInt          // Interior
-};
-
-
-enum Direction
-{
-    Direction_Forward,
-    Direction_Backward
-};
-
+#include <set>
+#include <utility>
 
 /*
     TraverseData class
     
     Abstract class defining the methods needed to traverse a graph.
+    Data for a (cell, angle) pair may be split into group blocks, each
+    traversed on its own (see GraphTraverser).
+    Ready angles of a cell may be updated together with updateBatch.
+    Pairs about to be updated are passed to prefetch.
+    If hasPriorities is false, getPriority isn't called and ready pairs are
+    computed in FIFO order.
 */
 class TraverseData
 {
 public:
-    virtual const char* getData(UINT cell, UINT face, UINT angle) = 0;
-    virtual void setSideData(UINT side, UINT angle, const char *data) = 0;
+    virtual const char* getData(UINT cell, UINT face, UINT angle, 
+                                UINT groupBlock) = 0;
+    virtual void setSideData(UINT side, UINT angle, UINT groupBlock, 
+                             const char *data) = 0;
     virtual UINT getPriority(UINT cell, UINT angle) = 0;
-    virtual void update(UINT cell, UINT angle, 
+    virtual bool hasPriorities() { return true; }
+    virtual void update(UINT cell, UINT angle, UINT groupBlock, 
                         UINT adjCellsSides[g_nFacePerCell], 
                         BoundaryType bdryType[g_nFacePerCell]) = 0;
+    
+    // Hint that the (cell, angle) pair will be updated soon
+    // Subclasses can override this to prefetch the pair's data
+    virtual void prefetch(UINT cell, UINT angle, UINT groupBlock)
+    {
+        UNUSED_VARIABLE(cell);
+        UNUSED_VARIABLE(angle);
+        UNUSED_VARIABLE(groupBlock);
+    }
+    
+    // Updates several angles of a cell that have the same boundary types
+    // Subclasses can override this to share work between the angles
+    virtual void updateBatch(UINT cell, const UINT *angles, UINT numAngles, 
+                             UINT groupBlock, 
+                             UINT adjCellsSides[g_nFacePerCell], 
+                             BoundaryType bdryType[g_nFacePerCell])
+    {
+        for (UINT i = 0; i < numAngles; i++) {
+            update(cell, angles[i], groupBlock, adjCellsSides, bdryType);
+        }
+    }
 
 protected:
     // Don't allow construction of this base class.
@@ -97,25 +103,122 @@ protected:
 class GraphTraverser
 {
 public:
-    GraphTraverser(Direction direction, bool doComm, UINT dataSizeInBytes);
+    GraphTraverser(Direction direction, bool doComm, UINT dataSizeInBytes,
+                   UINT numGroupBlocks);
     ~GraphTraverser();
 
-    void traverse(const UINT maxComputePerStep, TraverseData &traverseData);
+    // Instantiated for TraverseData, SweepData, BLevelData, and 
+    // NeighborPriorityData in GraphTraverser.cc
+    template <typename TraverseDataType>
+    void traverse(const UINT maxComputePerStep, 
+                  TraverseDataType &traverseData);
+    void setEagerFlush(const Mat2<UINT> &sideBLevels, 
+                       const UINT bLevelThreshold, 
+                       const UINT numPacketsThreshold);
+    void setPatchGraph(const PatchGraph *patchGraph);
+    void setAngleBatchSize(const UINT batchSize);
+    void setPrefetchLookahead(const UINT lookahead);
+    void setReduceTimes(const bool reduceTimes);
 
 private:
     void setupOneSidedMPI();
+    void sendOneSided(const std::vector<std::vector<char>> &sendBuffers,
+                      const bool returnAllCredits);
+    template <typename TraverseDataType>
+    void recvOneSided(TraverseDataType &traverseData, 
+                      std::set<std::pair<UINT,UINT>> &sideRecv);
+    void finishOneSided();
+    void putHeader(const UINT rankIndex);
+    UINT queueIndex(const UINT angleIndex) const;
+    UINT dependencyIndex(const UINT task, const UINT angleIndex) const;
+    UINT getNumTasks(const UINT angle) const;
+    UINT getFirstCell(const UINT task, const UINT angle) const;
+    UINT gatherAngleBatch(const UINT cell, const UINT angleIndex, 
+                          const UINT queue, const UINT maxBatchSize,
+                          std::vector<UINT> &numDependencies,
+                          UINT *batch) const;
+    void adaptCellsPerStep(const std::vector<UINT> &stepsTaken, 
+                           const std::vector<UINT> &maxComputeThisStep,
+                           const std::vector<Timer> &computeTimers,
+                           const double commTime,
+                           const double waitTime);
     
     std::vector<UINT> c_adjRankIndexToRank;
     std::map<UINT,UINT> c_adjRankToRankIndex;
-    Mat2<UINT> c_initNumDependencies;
+    std::vector<UINT> c_numSendPackets;
+    std::vector<UINT> c_numRecvPackets;
     Direction c_direction;
     bool c_doComm;
+    UINT c_dataSizeInBytes;
+    
+    // Each (cell, angle) pair is traversed once per group block
+    // Angle indices are groupBlock * g_nAngles + angle
+    UINT c_numGroupBlocks;
+    UINT c_numAngleIndices;
+    UINT c_numAngleGroups;
+    UINT c_numQueues;
+    
+    // Dependency counts are partitioned by queue (see dependencyIndex)
+    // Counters written by different threads are c_padUINTs apart
+    static const UINT c_padUINTs = g_nBytesPerCacheLine / sizeof(UINT);
+    std::vector<UINT> c_dependencyOffsets;
+    std::vector<UINT> c_dependencyStrides;
+    UINT c_numDependencySlots;
+    std::vector<std::vector<UINT>> c_queueAngleIndices;
+    
+    // Adaptive step sizes (see adaptCellsPerStep)
+    // Wait fractions are sent along with traversal data
+    std::vector<double> c_cellsPerStep;
+    std::vector<double> c_neighborWait;
+    double c_waitFraction;
+    
+    // Eager flushing (see setEagerFlush)
+    bool c_eagerFlush;
+    Mat2<bool> c_criticalSides;
+    UINT c_flushNumPackets;
+    
+    // Patches of cells scheduled as single tasks (see setPatchGraph)
+    const PatchGraph *c_patchGraph;
+    
+    // Ready angles of a cell computed together (see gatherAngleBatch)
+    static const UINT c_batchedCount = UINT64_MAX;
+    UINT c_angleBatchSize;
+    
+    // Number of pairs ahead of the current one to prefetch (see traverse)
+    UINT c_prefetchLookahead;
+    
+    // Times are reduced over ranks after each traversal (see setReduceTimes)
+    bool c_reduceTimes;
+    
+    // Record and replay of the traversal order (see traverse)
+    // Orders are indices task * c_numAngleIndices + angle index for each 
+    // thread
+    // Step ends are positions in the orders where each step ended
+    enum ReplayState
+    {
+        ReplayState_Off,
+        ReplayState_Record,
+        ReplayState_Replay
+    };
+    static const UINT c_replayStallFactor = 2;
+    ReplayState c_replayState;
+    std::vector<std::vector<UINT>> c_replayOrder;
+    std::vector<std::vector<UINT>> c_replayStepEnds;
+    UINT c_numRecordedSteps;
+    std::vector<UINT> c_replayDependencies;
+    std::vector<std::pair<UINT,UINT>> c_remoteDependencies;
+    
+    // One-sided MPI state (see setupOneSidedMPI)
+    static const UINT c_headerSize = 3 * sizeof(uint64_t);
     MPI_Win c_mpiWin;
     char *c_mpiWinMemory;
-    UINT c_dataSizeInBytes;
-    UINT c_maxPackets;
     std::vector<UINT> c_onRankOffsets;
     std::vector<UINT> c_offRankOffsets;
+    std::vector<uint64_t> c_numWritten;
+    std::vector<uint64_t> c_numRead;
+    std::vector<uint64_t> c_numReadReturned;
+    std::vector<uint64_t> c_headers;
+    std::vector<std::vector<char>> c_pendingSends;
 };
 
 #endif
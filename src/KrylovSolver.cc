@@ -98,7 +98,10 @@ KrylovSolver::KrylovSolver(UINT localVecSize, double rtol, UINT iterMax,
     KSPCreate(MPI_COMM_WORLD, &c_ksp);
     KSPSetOperators(c_ksp, c_mat, c_mat);
     KSPSetTolerances(c_ksp, rtol, PETSC_DEFAULT, PETSC_DEFAULT, iterMax);
-    KSPSetType(c_ksp, KSPGMRES);
+    if (g_krylovType == KrylovType_BiCGStab)
+        KSPSetType(c_ksp, KSPBCGS);
+    else
+        KSPSetType(c_ksp, KSPGMRES);
 
 
     // Set data
@@ -178,4 +181,311 @@ KrylovSolver::~KrylovSolver()
     KSPDestroy(&c_ksp);
 }
 
+
+
+
+/*
+    If not using PETSc.
+*/
+#else
+
+#include "KrylovSolver.hh"
+#include "Comm.hh"
+#include "Mat.hh"
+#include <math.h>
+
+using namespace std;
+
+
+/*
+    dot
+    
+    Local part of the dot product of x and y.
+*/
+static
+double dot(const vector<double> &x, const vector<double> &y)
+{
+    double sum = 0.0;
+    for (UINT i = 0; i < x.size(); i++) {
+        sum += x[i] * y[i];
+    }
+    return sum;
+}
+
+
+KrylovSolver::KrylovSolver(UINT localVecSize, double rtol, UINT iterMax, 
+                           Function lhsOperator)
+    : c_localVecSize(localVecSize), c_rtol(rtol), c_iterMax(iterMax),
+      c_initialGuessNonzero(false), c_numIterations(0), 
+      c_residualNorm(0.0), c_x(localVecSize, 0.0), c_b(localVecSize, 0.0)
+{
+    c_krylovData.data = NULL;
+    c_krylovData.lhsOperator = lhsOperator;
+}
+
+
+void KrylovSolver::solve()
+{
+    c_numIterations = 0;
+    c_residualNorm = 0.0;
+    
+    if (!c_initialGuessNonzero)
+        c_x.assign(c_localVecSize, 0.0);
+    
+    if (g_krylovType == KrylovType_BiCGStab)
+        solveBiCGStab();
+    else
+        solveGMRES();
+}
+
+
+/*
+    residual
+    
+    r = b - A x
+*/
+double KrylovSolver::residual(vector<double> &r)
+{
+    c_krylovData.lhsOperator(c_x.data(), r.data(), c_krylovData.data);
+    for (UINT i = 0; i < c_localVecSize; i++) {
+        r[i] = c_b[i] - r[i];
+    }
+    return dot(r, r);
+}
+
+
+/*
+    solveGMRES
+    
+    Restarted GMRES.  Each iteration orthogonalizes A v_j against the basis 
+    with classical Gram-Schmidt and gets the dot products and the norm of 
+    A v_j from one reduction.  The new basis vector's norm follows from
+    ||w - V h||^2 = ||w||^2 - ||h||^2, which loses digits when most of w is 
+    in the span of the basis, so then w is orthogonalized a second time 
+    with a second reduction.
+*/
+void KrylovSolver::solveGMRES()
+{
+    const double reorthogonalizeFraction = 1e-4;
+    vector<vector<double>> v(c_restart + 1, 
+                             vector<double>(c_localVecSize, 0.0));
+    vector<double> w(c_localVecSize);
+    Mat2<double> h(c_restart + 1, c_restart);
+    vector<double> cs(c_restart), sn(c_restart), g(c_restart + 1);
+    vector<double> y(c_restart);
+    vector<double> dots;
+    double bNorm, rNorm, tol;
+    
+    
+    // Initial residual
+    // With a zero initial guess, r = b and one reduction gets both norms
+    dots.resize(2);
+    if (c_initialGuessNonzero) {
+        dots[1] = residual(v[0]);
+    }
+    else {
+        v[0] = c_b;
+        dots[1] = dot(c_b, c_b);
+    }
+    dots[0] = dot(c_b, c_b);
+    Comm::gsum(dots);
+    bNorm = sqrt(dots[0]);
+    rNorm = sqrt(dots[1]);
+    tol = c_rtol * bNorm;
+    c_residualNorm = rNorm;
+    
+    
+    // Restart cycles
+    while (rNorm > tol && c_numIterations < c_iterMax) {
+        
+        UINT numBasis = 0;
+        bool breakdown = false;
+        for (UINT i = 0; i < c_localVecSize; i++) {
+            v[0][i] /= rNorm;
+        }
+        g.assign(c_restart + 1, 0.0);
+        g[0] = rNorm;
+        
+        for (UINT j = 0; j < c_restart && c_numIterations < c_iterMax; j++) {
+            
+            // w = A v_j orthogonalized against v_0 ... v_j
+            c_krylovData.lhsOperator(v[j].data(), w.data(), 
+                                     c_krylovData.data);
+            
+            double hh = 0.0;
+            for (UINT pass = 0; pass < 2; pass++) {
+                dots.resize(j + 2);
+                for (UINT i = 0; i <= j; i++) {
+                    dots[i] = dot(v[i], w);
+                }
+                dots[j + 1] = dot(w, w);
+                Comm::gsum(dots);
+                
+                hh = dots[j + 1];
+                for (UINT i = 0; i <= j; i++) {
+                    if (pass == 0)
+                        h(i, j) = dots[i];
+                    else
+                        h(i, j) += dots[i];
+                    hh -= dots[i] * dots[i];
+                    for (UINT k = 0; k < c_localVecSize; k++) {
+                        w[k] -= dots[i] * v[i][k];
+                    }
+                }
+                
+                if (hh > reorthogonalizeFraction * dots[j + 1])
+                    break;
+            }
+            double hNorm = hh > 0.0 ? sqrt(hh) : 0.0;
+            h(j + 1, j) = hNorm;
+            
+            
+            // Apply the Givens rotations to the new column of h
+            for (UINT i = 0; i < j; i++) {
+                double temp = cs[i] * h(i, j) + sn[i] * h(i + 1, j);
+                h(i + 1, j) = -sn[i] * h(i, j) + cs[i] * h(i + 1, j);
+                h(i, j) = temp;
+            }
+            double denom = sqrt(h(j, j) * h(j, j) + hNorm * hNorm);
+            Insist(denom > 0.0, "KrylovSolver: GMRES breakdown.");
+            cs[j] = h(j, j) / denom;
+            sn[j] = hNorm / denom;
+            h(j, j) = denom;
+            h(j + 1, j) = 0.0;
+            g[j + 1] = -sn[j] * g[j];
+            g[j] = cs[j] * g[j];
+            
+            c_numIterations++;
+            numBasis = j + 1;
+            rNorm = fabs(g[j + 1]);
+            
+            if (hNorm == 0.0) {
+                breakdown = true;
+                break;
+            }
+            if (rNorm <= tol)
+                break;
+            
+            for (UINT k = 0; k < c_localVecSize; k++) {
+                v[j + 1][k] = w[k] / hNorm;
+            }
+        }
+        
+        
+        // x += V y where H y = g
+        for (UINT i = numBasis; i-- > 0;) {
+            y[i] = g[i];
+            for (UINT k = i + 1; k < numBasis; k++) {
+                y[i] -= h(i, k) * y[k];
+            }
+            y[i] /= h(i, i);
+        }
+        for (UINT i = 0; i < numBasis; i++) {
+            for (UINT k = 0; k < c_localVecSize; k++) {
+                c_x[k] += y[i] * v[i][k];
+            }
+        }
+        c_residualNorm = rNorm;
+        
+        if (breakdown || rNorm <= tol || c_numIterations >= c_iterMax)
+            break;
+        
+        
+        // Restart from the true residual
+        rNorm = residual(v[0]);
+        Comm::gsum(rNorm);
+        rNorm = sqrt(rNorm);
+        c_residualNorm = rNorm;
+    }
+}
+
+
+/*
+    solveBiCGStab
+    
+    BiCGStab with one reduction per application of A.  The dot products 
+    after the second application are fused, and the residual norm and the 
+    next rho are found from them instead of from the new residual.  The 
+    residual norm is only computed directly when that loses too many 
+    digits or shows convergence.
+*/
+void KrylovSolver::solveBiCGStab()
+{
+    const double recomputeFraction = 1e-8;
+    vector<double> r(c_localVecSize), rHat(c_localVecSize);
+    vector<double> p(c_localVecSize, 0.0), v(c_localVecSize, 0.0);
+    vector<double> s(c_localVecSize), t(c_localVecSize);
+    vector<double> dots(2);
+    double rho, rhoOld = 1.0, alpha = 1.0, omega = 1.0;
+    double bNorm, rNorm, tol;
+    
+    
+    // Initial residual
+    if (c_initialGuessNonzero) {
+        dots[1] = residual(r);
+    }
+    else {
+        r = c_b;
+        dots[1] = dot(c_b, c_b);
+    }
+    dots[0] = dot(c_b, c_b);
+    Comm::gsum(dots);
+    bNorm = sqrt(dots[0]);
+    rNorm = sqrt(dots[1]);
+    tol = c_rtol * bNorm;
+    c_residualNorm = rNorm;
+    rHat = r;
+    rho = dots[1];
+    
+    
+    // Iterate
+    while (rNorm > tol && c_numIterations < c_iterMax) {
+        
+        Insist(rho != 0.0, "KrylovSolver: BiCGStab breakdown.");
+        double beta = (rho / rhoOld) * (alpha / omega);
+        for (UINT i = 0; i < c_localVecSize; i++) {
+            p[i] = r[i] + beta * (p[i] - omega * v[i]);
+        }
+        
+        c_krylovData.lhsOperator(p.data(), v.data(), c_krylovData.data);
+        double rHatV = dot(rHat, v);
+        Comm::gsum(rHatV);
+        Insist(rHatV != 0.0, "KrylovSolver: BiCGStab breakdown.");
+        alpha = rho / rHatV;
+        for (UINT i = 0; i < c_localVecSize; i++) {
+            s[i] = r[i] - alpha * v[i];
+        }
+        
+        c_krylovData.lhsOperator(s.data(), t.data(), c_krylovData.data);
+        dots.resize(5);
+        dots[0] = dot(t, s);
+        dots[1] = dot(t, t);
+        dots[2] = dot(s, s);
+        dots[3] = dot(rHat, s);
+        dots[4] = dot(rHat, t);
+        Comm::gsum(dots);
+        
+        omega = dots[1] > 0.0 ? dots[0] / dots[1] : 0.0;
+        for (UINT i = 0; i < c_localVecSize; i++) {
+            c_x[i] += alpha * p[i] + omega * s[i];
+            r[i] = s[i] - omega * t[i];
+        }
+        c_numIterations++;
+        
+        double rr = dots[2] - 2.0 * omega * dots[0] + 
+                    omega * omega * dots[1];
+        if (rr <= recomputeFraction * dots[2] || rr <= tol * tol) {
+            rr = dot(r, r);
+            Comm::gsum(rr);
+        }
+        rNorm = sqrt(rr);
+        c_residualNorm = rNorm;
+        
+        if (omega == 0.0)
+            break;
+        rhoOld = rho;
+        rho = dots[3] - omega * dots[4];
+    }
+}
+
 #endif
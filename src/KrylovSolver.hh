@@ -92,9 +92,16 @@ private:
 
 /*
     If not using PETSc.
+    
+    Matrix-free GMRES(c_restart) or BiCGStab (see g_krylovType) written to 
+    need as few global reductions per iteration as possible.
+    Like PETSc, the solve has converged when the residual norm is at most 
+    rtol times the norm of b, and x is zeroed before the solve unless 
+    setInitialGuessNonzero is called.
 */
 #else
 #include "Global.hh"
+#include <vector>
 
 class KrylovSolver
 {
@@ -103,26 +110,19 @@ public:
 
 
     KrylovSolver(UINT localVecSize, double rtol, UINT iterMax,
-                 Function lhsOperator)
-    {
-        UNUSED_VARIABLE(localVecSize);
-        UNUSED_VARIABLE(rtol);
-        UNUSED_VARIABLE(iterMax);
-        UNUSED_VARIABLE(lhsOperator);
-        Insist(false, "KrylovSolver: PETSc not in use.");
-    }
+                 Function lhsOperator);
     ~KrylovSolver() {}
 
 
-    void solve()                    { }
-    double* getB()                  { return NULL; }
+    void solve();
+    double* getB()                  { return c_b.data(); }
     void releaseB()                 {}
-    double* getX()                  { return NULL; }
+    double* getX()                  { return c_x.data(); }
     void releaseX()                 {}
-    UINT getNumIterations()         { return 0; }
-    double getResidualNorm()        { return 0.0; }
-    void setData(void *data)        { UNUSED_VARIABLE(data); }
-    void setInitialGuessNonzero()   {}
+    UINT getNumIterations()         { return c_numIterations; }
+    double getResidualNorm()        { return c_residualNorm; }
+    void setData(void *data)        { c_krylovData.data = data; }
+    void setInitialGuessNonzero()   { c_initialGuessNonzero = true; }
 
 
     struct Data
@@ -133,6 +133,19 @@ public:
 
 private:
     
+    void solveGMRES();
+    void solveBiCGStab();
+    double residual(std::vector<double> &r);
+    
+    static const UINT c_restart = 30;
+    UINT c_localVecSize;
+    double c_rtol;
+    UINT c_iterMax;
+    bool c_initialGuessNonzero;
+    UINT c_numIterations;
+    double c_residualNorm;
+    std::vector<double> c_x, c_b;
+    Data c_krylovData;
 };
 
 
@@ -45,6 +45,8 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Comm.hh"
 #include "KeyValueReader.hh"
 #include "GraphTraverser.hh"
+#include "DependencyGraph.hh"
+#include "PatchGraph.hh"
 #include "Global.hh"
 #include "Assert.hh"
 #include "Timer.hh"
@@ -121,6 +123,151 @@ void readInput(const string &inputFileName,
     kvr.getDouble("DD_ErrMax", g_ddErrMax);
     kvr.getBool("SourceIteration", g_useSourceIteration);
     kvr.getBool("OneSidedMPI", g_useOneSidedMPI);
+    
+    
+    // Optional data
+    g_adaptiveCellsPerStep = false;
+    if (kvr.hasKey("AdaptiveCellsPerStep"))
+        kvr.getBool("AdaptiveCellsPerStep", g_adaptiveCellsPerStep);
+    
+    g_targetOverlap = 0.9;
+    if (kvr.hasKey("TargetOverlap"))
+        kvr.getDouble("TargetOverlap", g_targetOverlap);
+    Insist(g_targetOverlap > 0.0 && g_targetOverlap < 1.0, 
+           "TargetOverlap must be between 0 and 1.");
+    
+    g_eagerFlush = false;
+    if (kvr.hasKey("EagerFlush"))
+        kvr.getBool("EagerFlush", g_eagerFlush);
+    
+    g_eagerFlushBLevelFraction = 0.75;
+    if (kvr.hasKey("EagerFlushBLevelFraction"))
+        kvr.getDouble("EagerFlushBLevelFraction", g_eagerFlushBLevelFraction);
+    
+    int eagerFlushPackets = 0;
+    if (kvr.hasKey("EagerFlushPackets"))
+        kvr.getInt("EagerFlushPackets", eagerFlushPackets);
+    Insist(eagerFlushPackets >= 0, "EagerFlushPackets must be >= 0.");
+    g_eagerFlushPackets = eagerFlushPackets;
+    
+    g_replayTraversal = false;
+    if (kvr.hasKey("ReplayTraversal"))
+        kvr.getBool("ReplayTraversal", g_replayTraversal);
+    
+    g_localSweepFIFO = false;
+    if (kvr.hasKey("LocalSweepFIFO"))
+        kvr.getBool("LocalSweepFIFO", g_localSweepFIFO);
+    
+    g_useDSA = false;
+    if (kvr.hasKey("DSA"))
+        kvr.getBool("DSA", g_useDSA);
+    
+    g_dsaErrMax = 1e-10;
+    if (kvr.hasKey("DSA_ErrMax"))
+        kvr.getDouble("DSA_ErrMax", g_dsaErrMax);
+    Insist(g_dsaErrMax > 0.0, "DSA_ErrMax must be > 0.");
+    
+    int dsaIterMax = 1000;
+    if (kvr.hasKey("DSA_IterMax"))
+        kvr.getInt("DSA_IterMax", dsaIterMax);
+    Insist(dsaIterMax >= 1, "DSA_IterMax must be >= 1.");
+    g_dsaIterMax = dsaIterMax;
+    
+    int andersonDepth = 0;
+    if (kvr.hasKey("AndersonDepth"))
+        kvr.getInt("AndersonDepth", andersonDepth);
+    Insist(andersonDepth >= 0, "AndersonDepth must be >= 0.");
+    g_andersonDepth = andersonDepth;
+    
+    int ddAndersonDepth = 0;
+    if (kvr.hasKey("DD_AndersonDepth"))
+        kvr.getInt("DD_AndersonDepth", ddAndersonDepth);
+    Insist(ddAndersonDepth >= 0, "DD_AndersonDepth must be >= 0.");
+    g_ddAndersonDepth = ddAndersonDepth;
+    
+    g_ddCoarseCorrection = false;
+    if (kvr.hasKey("DD_CoarseCorrection"))
+        kvr.getBool("DD_CoarseCorrection", g_ddCoarseCorrection);
+    
+    g_ddIncrementalTol = 0.0;
+    if (kvr.hasKey("DD_IncrementalTol"))
+        kvr.getDouble("DD_IncrementalTol", g_ddIncrementalTol);
+    Insist(g_ddIncrementalTol >= 0.0, "DD_IncrementalTol must be >= 0.");
+    
+    g_ddAsync = false;
+    if (kvr.hasKey("DD_Async"))
+        kvr.getBool("DD_Async", g_ddAsync);
+    Insist(!g_ddAsync || (g_ddAndersonDepth == 0 && !g_ddCoarseCorrection),
+           "DD_Async can't be used with DD_AndersonDepth or "
+           "DD_CoarseCorrection.");
+    
+    int threadsPerAngleGroup = 1;
+    if (kvr.hasKey("ThreadsPerAngleGroup"))
+        kvr.getInt("ThreadsPerAngleGroup", threadsPerAngleGroup);
+    Insist(threadsPerAngleGroup >= 1, "ThreadsPerAngleGroup must be >= 1.");
+    g_nThreadsPerAngleGroup = threadsPerAngleGroup;
+    
+    int groupBlocks = 1;
+    if (kvr.hasKey("GroupBlocks"))
+        kvr.getInt("GroupBlocks", groupBlocks);
+    Insist(groupBlocks >= 1, "GroupBlocks must be >= 1.");
+    g_nGroupBlocks = groupBlocks;
+    
+    int cellsPerPatch = 0;
+    if (kvr.hasKey("CellsPerPatch"))
+        kvr.getInt("CellsPerPatch", cellsPerPatch);
+    Insist(cellsPerPatch >= 0, "CellsPerPatch must be >= 0.");
+    g_cellsPerPatch = cellsPerPatch;
+    
+    int angleBatchSize = 1;
+    if (kvr.hasKey("AngleBatchSize"))
+        kvr.getInt("AngleBatchSize", angleBatchSize);
+    Insist(angleBatchSize >= 1, "AngleBatchSize must be >= 1.");
+    Insist(angleBatchSize == 1 || cellsPerPatch == 0, 
+           "AngleBatchSize can't be used with CellsPerPatch.");
+    g_angleBatchSize = angleBatchSize;
+    
+    int prefetchLookahead = 0;
+    if (kvr.hasKey("PrefetchLookahead"))
+        kvr.getInt("PrefetchLookahead", prefetchLookahead);
+    Insist(prefetchLookahead >= 0, "PrefetchLookahead must be >= 0.");
+    g_prefetchLookahead = prefetchLookahead;
+    
+    int cellsPerTile = 256;
+    if (kvr.hasKey("CellsPerTile"))
+        kvr.getInt("CellsPerTile", cellsPerTile);
+    Insist(cellsPerTile >= 1, "CellsPerTile must be >= 1.");
+    g_cellsPerTile = cellsPerTile;
+    
+    g_cellNumbering = CellNumbering_Original;
+    if (kvr.hasKey("CellNumbering")) {
+        string cellNumbering;
+        kvr.getString("CellNumbering", cellNumbering);
+        if (cellNumbering == "Original")
+            g_cellNumbering = CellNumbering_Original;
+        else if (cellNumbering == "RCM")
+            g_cellNumbering = CellNumbering_RCM;
+        else if (cellNumbering == "Morton")
+            g_cellNumbering = CellNumbering_Morton;
+        else
+            Insist(false, "Cell numbering not recognized.");
+    }
+    
+    g_scheduleCache = "";
+    if (kvr.hasKey("ScheduleCache"))
+        kvr.getString("ScheduleCache", g_scheduleCache);
+    
+    g_krylovType = KrylovType_GMRES;
+    if (kvr.hasKey("KrylovType")) {
+        string krylovType;
+        kvr.getString("KrylovType", krylovType);
+        if (krylovType == "GMRES")
+            g_krylovType = KrylovType_GMRES;
+        else if (krylovType == "BiCGStab")
+            g_krylovType = KrylovType_BiCGStab;
+        else
+            Insist(false, "Krylov type not recognized.");
+    }
        
     g_snOrder = snOrder;
     g_iterMax = iterMax;
@@ -154,6 +301,9 @@ void readInput(const string &inputFileName,
         g_sweepType = SweepType_SchurKrylov;
     else
         Insist(false, "Sweep type not recognized.");
+    Insist(!g_ddCoarseCorrection || g_sweepType == SweepType_PBJ || 
+           g_sweepType == SweepType_PBJOuter,
+           "DD_CoarseCorrection is only for SweepType PBJ and PBJOuter.");
 
 
     string gaussElimMethod;
@@ -220,16 +370,30 @@ int main(int argc, char *argv[])
     
     
     // Get number of angle groups
-    // This is the same as the number of OpenMP threads
-    g_nAngleGroups = 1;
+    // Each angle group has a thread team for each group block
+    g_nThreads = 1;
     #pragma omp parallel
     {
         if(omp_get_thread_num() == 0)
-            g_nAngleGroups = omp_get_num_threads();
+            g_nThreads = omp_get_num_threads();
     }
-    g_nThreads = g_nAngleGroups;
-    if (Comm::rank() == 0)
+    Insist(g_nThreads % (g_nThreadsPerAngleGroup * g_nGroupBlocks) == 0, 
+           "ThreadsPerAngleGroup * GroupBlocks must divide the number of "
+           "threads.");
+    Insist(g_nGroups % g_nGroupBlocks == 0, 
+           "GroupBlocks must divide nGroups.");
+    Insist((g_nThreadsPerAngleGroup == 1 && g_nGroupBlocks == 1) || 
+           (g_sweepType != SweepType_OriginalTycho1 && 
+            g_sweepType != SweepType_OriginalTycho2), 
+           "OriginalTycho sweeps need ThreadsPerAngleGroup = GroupBlocks = 1.");
+    g_nAngleGroups = 
+        g_nThreads / (g_nThreadsPerAngleGroup * g_nGroupBlocks);
+    if (Comm::rank() == 0) {
         printf("Num angle groups: %" PRIu64 "\n", g_nAngleGroups);
+        printf("Num group blocks: %" PRIu64 "\n", g_nGroupBlocks);
+        printf("Threads per angle group: %" PRIu64 "\n", 
+               g_nThreadsPerAngleGroup);
+    }
             
     
     // Create quadrature
@@ -251,6 +415,15 @@ int main(int argc, char *argv[])
     }
 
 
+    // Create dependency graph of (cell, angle) pairs
+    g_dependencyGraph = new DependencyGraph();
+    double graphMemory = g_dependencyGraph->getMemoryInBytes() / 1.0e6;
+    Comm::gsum(graphMemory);
+    if (Comm::rank() == 0) {
+        printf("Dependency graph memory (all ranks): %.2f MB\n", graphMemory);
+    }
+
+
     // Create cross sections for each cell
     Problem::createCrossSections(g_sigmaT, g_sigmaS, sigmaT1, sigmaS1, 
                                  sigmaT2, sigmaS2);
@@ -267,49 +440,88 @@ int main(int argc, char *argv[])
         case SweepType_TraverseGraph:
             g_graphTraverserForward = 
                 new GraphTraverser(Direction_Forward, true, 
-                                   SweepData::getDataSizeInBytes());
+                                   SweepData::getDataSizeInBytes(), 
+                                   g_nGroupBlocks);
             sweeper = new SweeperTraverse();
             break;
         case SweepType_Schur:
             g_graphTraverserForward = 
                 new GraphTraverser(Direction_Forward, false, 
-                                   SweepData::getDataSizeInBytes());
+                                   SweepData::getDataSizeInBytes(), 
+                                   g_nGroupBlocks);
             sweeper = new SweeperSchur();
             break;
         case SweepType_SchurOuter:
             g_graphTraverserForward = 
                 new GraphTraverser(Direction_Forward, false, 
-                                   SweepData::getDataSizeInBytes());
+                                   SweepData::getDataSizeInBytes(), 
+                                   g_nGroupBlocks);
             sweeper = new SweeperSchurOuter();
             break;
         case SweepType_SchurKrylov:
             g_graphTraverserForward = 
                 new GraphTraverser(Direction_Forward, false, 
-                                   SweepData::getDataSizeInBytes());
+                                   SweepData::getDataSizeInBytes(), 
+                                   g_nGroupBlocks);
             sweeper = new SweeperSchurKrylov();
             break;
         case SweepType_PBJ:
             g_graphTraverserForward = 
                 new GraphTraverser(Direction_Forward, false, 
-                                   SweepData::getDataSizeInBytes());
+                                   SweepData::getDataSizeInBytes(), 
+                                   g_nGroupBlocks);
             sweeper = new SweeperPBJ();
             break;
         case SweepType_PBJOuter:
             g_graphTraverserForward = 
                 new GraphTraverser(Direction_Forward, false, 
-                                   SweepData::getDataSizeInBytes());
+                                   SweepData::getDataSizeInBytes(), 
+                                   g_nGroupBlocks);
             sweeper = new SweeperPBJOuter();
             break;
         case SweepType_PBJSI:
             g_graphTraverserForward = 
                 new GraphTraverser(Direction_Forward, false, 
-                                   SweepData::getDataSizeInBytes());
+                                   SweepData::getDataSizeInBytes(), 
+                                   g_nGroupBlocks);
             sweeper = new SweeperPBJSI();
             break;
         default:
             Insist(false, "Sweep type not recognized.");
             break;
     }
+    
+    
+    // Compute ready angles of a cell together
+    if (g_angleBatchSize > 1 && g_graphTraverserForward != NULL) {
+        g_graphTraverserForward->setAngleBatchSize(g_angleBatchSize);
+    }
+    
+    
+    // Prefetch data for pairs about to be computed
+    if (g_prefetchLookahead > 0 && g_graphTraverserForward != NULL) {
+        g_graphTraverserForward->setPrefetchLookahead(g_prefetchLookahead);
+    }
+    
+    
+    // Asynchronous PBJ does different numbers of local sweeps on each rank
+    if (g_ddAsync && g_sweepType == SweepType_PBJ) {
+        g_graphTraverserForward->setReduceTimes(false);
+    }
+    
+    
+    // Group cells into patches scheduled as single tasks
+    g_patchGraph = NULL;
+    if (g_cellsPerPatch > 0 && g_graphTraverserForward != NULL) {
+        g_patchGraph = new PatchGraph(g_cellsPerPatch);
+        g_graphTraverserForward->setPatchGraph(g_patchGraph);
+        
+        double patchMemory = g_patchGraph->getMemoryInBytes() / 1.0e6;
+        Comm::gsum(patchMemory);
+        if (Comm::rank() == 0) {
+            printf("Patch graph memory (all ranks): %.2f MB\n", patchMemory);
+        }
+    }
 
     
     // Solve
@@ -0,0 +1,272 @@
+/*
+Copyright (c) 2016, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2016. Los Alamos National Security, LLC. This software was produced 
+under U.S. Government contract DE-AC52-06NA25396 for Los Alamos National 
+Laboratory (LANL), which is operated by Los Alamos National Security, LLC for 
+the U.S. Department of Energy. The U.S. Government has rights to use, 
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR LOS 
+ALAMOS NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR 
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified 
+to produce derivative works, such modified software should be clearly marked, 
+so as not to confuse it with the version available from LANL.
+
+Additionally, redistribution and use in source and binary forms, with or 
+without modification, are permitted provided that the following conditions 
+are met:
+1.      Redistributions of source code must retain the above copyright notice, 
+        this list of conditions and the following disclaimer.
+2.      Redistributions in binary form must reproduce the above copyright 
+        notice, this list of conditions and the following disclaimer in the 
+        documentation and/or other materials provided with the distribution.
+3.      Neither the name of Los Alamos National Security, LLC, Los Alamos 
+        National Laboratory, LANL, the U.S. Government, nor the names of its 
+        contributors may be used to endorse or promote products derived from 
+        this software without specific prior written permission.
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND 
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT 
+NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS ALAMOS NATIONAL 
+SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; 
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "PatchGraph.hh"
+#include "DependencyGraph.hh"
+#include "GraphTraverser.hh"
+#include "TychoMesh.hh"
+#include "Assert.hh"
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+
+/*
+    StageData
+    
+    Calculates the stage of each (cell, angle) pair when traversing the
+    graph forward: the most interior boundaries crossed by any path to the
+    cell.
+*/
+namespace {
+class StageData : public TraverseData
+{
+public:
+    
+    StageData(Mat2<UINT> &stages)
+    : c_stages(stages), c_sideStages(g_tychoMesh->getNSides(), g_nAngles)
+    {
+        c_stages.setAll(0);
+        c_sideStages.setAll(0);
+    }
+    
+    virtual const char* getData(UINT cell, UINT face, UINT angle, 
+                                UINT groupBlock)
+    {
+        UNUSED_VARIABLE(face);
+        UNUSED_VARIABLE(groupBlock);
+        return (char*) (&c_stages(cell, angle));
+    }
+    
+    virtual void setSideData(UINT side, UINT angle, UINT groupBlock, 
+                             const char *data)
+    {
+        UNUSED_VARIABLE(groupBlock);
+        c_sideStages(side, angle) = *((UINT*)(data));
+    }
+    
+    virtual UINT getPriority(UINT cell, UINT angle)
+    {
+        UNUSED_VARIABLE(cell);
+        UNUSED_VARIABLE(angle);
+        return 1;
+    }
+    
+    virtual void update(UINT cell, UINT angle, UINT groupBlock, 
+                        UINT adjCellsSides[g_nFacePerCell], 
+                        BoundaryType bdryType[g_nFacePerCell])
+    {
+        UNUSED_VARIABLE(groupBlock);
+        c_stages(cell, angle) = 0;
+        for (UINT face = 0; face < g_nFacePerCell; face++) {
+            
+            if (bdryType[face] == BoundaryType_InIntBdry) {
+                UINT adjSide = adjCellsSides[face];
+                c_stages(cell, angle) = max(c_stages(cell, angle), 
+                                            c_sideStages(adjSide, angle) + 1);
+            }
+            
+            else if (bdryType[face] == BoundaryType_InInt) {
+                UINT adjCell = adjCellsSides[face];
+                c_stages(cell, angle) = max(c_stages(cell, angle), 
+                                            c_stages(adjCell, angle));
+            }
+        }
+    }
+    
+private:
+    Mat2<UINT> &c_stages;
+    Mat2<UINT> c_sideStages;
+};}
+
+
+/*
+    calcStages
+*/
+static
+void calcStages(Mat2<UINT> &stages)
+{
+    const bool doComm = true;
+    const UINT numGroupBlocks = 1;
+    GraphTraverser graphTraverser(Direction_Forward, doComm, sizeof(UINT), 
+                                  numGroupBlocks);
+    StageData stageData(stages);
+    TraverseData &traverseData = stageData;
+    
+    graphTraverser.traverse(g_maxCellsPerStep, traverseData);
+}
+
+
+/*
+    PatchGraph constructor
+    
+    Patches are grown one at a time from a cell whose parents are all in
+    earlier patches.  A patch takes on children that become ready while it
+    grows and have the same stage, so it stays spatially compact.  Ready
+    cells the patch doesn't take wait for a later patch.
+*/
+PatchGraph::PatchGraph(const UINT cellsPerPatch)
+{
+    Insist(cellsPerPatch > 0, "Patches need at least one cell.");
+    
+    Mat2<UINT> stages(g_nCells, g_nAngles);
+    calcStages(stages);
+    
+    c_patchStarts.resize(g_nAngles + 1);
+    c_patches.resize(g_nCells * g_nAngles);
+    c_cells.reserve(g_nCells * g_nAngles);
+    
+    vector<UINT> numParentsLeft(g_nCells);
+    vector<UINT> ready;
+    vector<UINT> frontier;
+    
+    
+    // Patches for each angle
+    for (UINT angle = 0; angle < g_nAngles; angle++) {
+        
+        c_patchStarts[angle] = c_cellOffsets.size();
+        UINT numPatches = 0;
+        
+        ready.clear();
+        for (UINT cell = 0; cell < g_nCells; cell++) {
+            numParentsLeft[cell] = g_dependencyGraph->getNumParents(
+                Direction_Forward, false, cell, angle);
+            if (numParentsLeft[cell] == 0)
+                ready.push_back(cell);
+        }
+        
+        while (ready.size() > 0) {
+            
+            UINT seed = ready.back();
+            ready.pop_back();
+            UINT stage = stages(seed, angle);
+            UINT numCells = 0;
+            
+            c_cellOffsets.push_back(c_cells.size());
+            frontier.assign(1, seed);
+            
+            while (frontier.size() > 0 && numCells < cellsPerPatch) {
+                UINT cell = frontier.back();
+                frontier.pop_back();
+                
+                c_cells.push_back(cell);
+                c_patches[cell * g_nAngles + angle] = numPatches;
+                numCells++;
+                
+                const UINT *child = g_dependencyGraph->childrenBegin(
+                    Direction_Forward, cell, angle);
+                const UINT *childEnd = g_dependencyGraph->childrenEnd(
+                    Direction_Forward, cell, angle);
+                for (; child != childEnd; child++) {
+                    numParentsLeft[*child]--;
+                    if (numParentsLeft[*child] > 0)
+                        continue;
+                    
+                    if (stages(*child, angle) == stage)
+                        frontier.push_back(*child);
+                    else
+                        ready.push_back(*child);
+                }
+            }
+            
+            ready.insert(ready.end(), frontier.begin(), frontier.end());
+            numPatches++;
+        }
+        
+        Insist(c_cells.size() == (angle + 1) * g_nCells, 
+               "Cycle in the dependency graph.");
+    }
+    c_patchStarts[g_nAngles] = c_cellOffsets.size();
+    c_cellOffsets.push_back(c_cells.size());
+    
+    
+    // Children and number of parents of each patch
+    UINT totalPatches = c_patchStarts[g_nAngles];
+    vector<UINT> lastParent(g_nCells, numeric_limits<UINT>::max());
+    c_childOffsets.resize(totalPatches + 1);
+    c_numLocalParents.assign(totalPatches, 0);
+    c_numRemoteParents.assign(totalPatches, 0);
+    
+    for (UINT angle = 0; angle < g_nAngles; angle++) {
+    for (UINT patch = 0; patch < getNumPatches(angle); patch++) {
+        
+        UINT index = c_patchStarts[angle] + patch;
+        c_childOffsets[index] = c_children.size();
+        
+        for (const UINT *cell = cellsBegin(patch, angle); 
+             cell != cellsEnd(patch, angle); cell++)
+        {
+            c_numRemoteParents[index] += 
+                g_dependencyGraph->getNumRemoteParents(
+                    Direction_Forward, *cell, angle);
+            
+            const UINT *child = g_dependencyGraph->childrenBegin(
+                Direction_Forward, *cell, angle);
+            const UINT *childEnd = g_dependencyGraph->childrenEnd(
+                Direction_Forward, *cell, angle);
+            for (; child != childEnd; child++) {
+                UINT childPatch = getPatch(*child, angle);
+                if (childPatch == patch || lastParent[childPatch] == index)
+                    continue;
+                
+                lastParent[childPatch] = index;
+                c_children.push_back(childPatch);
+                c_numLocalParents[c_patchStarts[angle] + childPatch]++;
+            }
+        }
+    }}
+    
+    c_childOffsets[totalPatches] = c_children.size();
+    c_children.shrink_to_fit();
+}
+
+
+/*
+    getMemoryInBytes
+    
+    Memory used by the graph on this rank.
+*/
+UINT PatchGraph::getMemoryInBytes() const
+{
+    return (c_patchStarts.size() + c_patches.size() + c_cellOffsets.size() + 
+            c_cells.size() + c_childOffsets.size() + c_children.size() + 
+            c_numLocalParents.size() + c_numRemoteParents.size()) * 
+           sizeof(UINT);
+}
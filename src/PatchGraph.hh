@@ -0,0 +1,114 @@
+/*
+Copyright (c) 2016, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2016. Los Alamos National Security, LLC. This software was produced 
+under U.S. Government contract DE-AC52-06NA25396 for Los Alamos National 
+Laboratory (LANL), which is operated by Los Alamos National Security, LLC for 
+the U.S. Department of Energy. The U.S. Government has rights to use, 
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR LOS 
+ALAMOS NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR 
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified 
+to produce derivative works, such modified software should be clearly marked, 
+so as not to confuse it with the version available from LANL.
+
+Additionally, redistribution and use in source and binary forms, with or 
+without modification, are permitted provided that the following conditions 
+are met:
+1.      Redistributions of source code must retain the above copyright notice, 
+        this list of conditions and the following disclaimer.
+2.      Redistributions in binary form must reproduce the above copyright 
+        notice, this list of conditions and the following disclaimer in the 
+        documentation and/or other materials provided with the distribution.
+3.      Neither the name of Los Alamos National Security, LLC, Los Alamos 
+        National Laboratory, LANL, the U.S. Government, nor the names of its 
+        contributors may be used to endorse or promote products derived from 
+        this software without specific prior written permission.
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND 
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT 
+NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS ALAMOS NATIONAL 
+SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; 
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __PATCH_GRAPH_HH__
+#define __PATCH_GRAPH_HH__
+
+#include "Global.hh"
+#include "Mat.hh"
+#include <vector>
+
+
+/*
+    PatchGraph class
+    
+    Coarsens the forward DependencyGraph by grouping spatially adjacent 
+    cells into patches of at most cellsPerPatch cells, separately for each
+    angle.  A graph traverser can then schedule (patch, angle) pairs, 
+    solving the cells of a patch in a precomputed order.
+    
+    The patches of an angle are consecutive pieces of a topological order
+    of its cells, so the patch graph on this rank is acyclic.  All cells of
+    a patch also have the same stage, the most rank boundaries crossed by 
+    any path to the cell.  A path leaving a patch through another rank has 
+    a larger stage when it comes back, so it can't come back to the same
+    patch and waiting for a whole patch can't deadlock.
+    
+    Patches are numbered separately for each angle.
+*/
+class PatchGraph
+{
+public:
+    PatchGraph(const UINT cellsPerPatch);
+    
+    UINT getNumPatches(const UINT angle) const
+        { return c_patchStarts[angle + 1] - c_patchStarts[angle]; }
+    
+    UINT getPatch(const UINT cell, const UINT angle) const
+        { return c_patches[cell * g_nAngles + angle]; }
+    
+    UINT getNumParents(const bool doComm, 
+                       const UINT patch, const UINT angle) const
+    {
+        UINT index = c_patchStarts[angle] + patch;
+        UINT numParents = c_numLocalParents[index];
+        if (doComm)
+            numParents += c_numRemoteParents[index];
+        return numParents;
+    }
+    
+    // Cells of a patch in the order they are solved
+    const UINT* cellsBegin(const UINT patch, const UINT angle) const
+        { return &c_cells[c_cellOffsets[c_patchStarts[angle] + patch]]; }
+    
+    const UINT* cellsEnd(const UINT patch, const UINT angle) const
+        { return &c_cells[c_cellOffsets[c_patchStarts[angle] + patch + 1]]; }
+    
+    const UINT* childrenBegin(const UINT patch, const UINT angle) const
+        { return &c_children[c_childOffsets[c_patchStarts[angle] + patch]]; }
+    
+    const UINT* childrenEnd(const UINT patch, const UINT angle) const
+    { 
+        return &c_children[c_childOffsets[c_patchStarts[angle] + patch + 1]];
+    }
+    
+    UINT getMemoryInBytes() const;
+    
+private:
+    std::vector<UINT> c_patchStarts;
+    std::vector<UINT> c_patches;
+    std::vector<UINT> c_cellOffsets;
+    std::vector<UINT> c_cells;
+    std::vector<UINT> c_childOffsets;
+    std::vector<UINT> c_children;
+    std::vector<UINT> c_numLocalParents;
+    std::vector<UINT> c_numRemoteParents;
+};
+
+#endif
@@ -38,243 +38,22 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "Priorities.hh"
+#include "PriorityData.hh"
 #include "GraphTraverser.hh"
 #include "Mat.hh"
 #include "Global.hh"
 #include "TychoMesh.hh"
 #include "Comm.hh"
+#include "CellOrdering.hh"
+#include "ScheduleCache.hh"
+#include "DependencyGraph.hh"
 #include <vector>
 #include <algorithm>
+#include <utility>
 
 using namespace std;
 
 
-/*
-    BLevelData
-    
-    Calculates b-levels when traversing a graph.
-    Note: OpenMP assumes threading across angle.
-          Without this assumption, there could be a race condition.
-*/
-class BLevelData : public TraverseData
-{
-public:
-    
-    /*
-        Constructor
-    */
-    BLevelData(Mat2<UINT> &bLevels, Mat2<UINT> &sideBLevels)
-    : c_bLevels(bLevels), c_sideBLevels(sideBLevels)
-    {
-        // Initialize all to 0 b-level
-        c_maxBLevel = 0;
-        bLevels.setAll(0);
-        sideBLevels.setAll(0);
-        c_bLevels.setAll(0);
-        c_sideBLevels.setAll(0);
-    }
-    
-    
-    /*
-        getData
-        
-        Return b-level data given (cell, angle) pair.
-    */
-    virtual const char* getData(UINT cell, UINT face, UINT angle)
-    {
-        UNUSED_VARIABLE(face);
-        return (char*) (&c_bLevels(cell, angle));
-    }
-    
-    
-    /*
-        setSideData
-        
-        Return b-level data given (side, angle) pair.
-    */
-    virtual void setSideData(UINT side, UINT angle, const char *data)
-    {
-        c_sideBLevels(side, angle) = *((UINT*)(data));
-    }
-    
-    
-    /*
-        getPriority
-        
-        Return a priority for the cell/angle pair.
-        Not needed for this class, so it is just set to a constant.
-    */
-    virtual UINT getPriority(UINT cell, UINT angle)
-    {
-        UNUSED_VARIABLE(cell);
-        UNUSED_VARIABLE(angle);
-        return 1;
-    }
-    
-    
-    /*
-        update
-        
-        Updates b-level information for a given (cell, angle) pair.
-    */
-    virtual void update(UINT cell, UINT angle, 
-                        UINT adjCellsSides[g_nFacePerCell], 
-                        BoundaryType bdryType[g_nFacePerCell])
-    {
-        c_bLevels(cell, angle) = 0;
-        for (UINT face = 0; face < g_nFacePerCell; face++) {
-            
-            if (bdryType[face] == BoundaryType_OutIntBdry) {
-                UINT adjSide = adjCellsSides[face];
-                UINT adjBLevel = c_sideBLevels(adjSide, angle);
-                c_bLevels(cell, angle) = max(c_bLevels(cell, angle), adjBLevel + 1);
-            }
-            
-            else if (bdryType[face] == BoundaryType_OutInt) {
-                UINT adjCell = adjCellsSides[face];
-                UINT adjBLevel = c_bLevels(adjCell, angle);
-                c_bLevels(cell, angle) = max(c_bLevels(cell, angle), adjBLevel + 1);
-            }
-        }
-        
-        #pragma omp critical
-        {
-            c_maxBLevel = max(c_maxBLevel, c_bLevels(cell, angle));
-        }
-    }
-    
-    
-    /*
-        getMaxBLevel
-    */
-    virtual UINT getMaxBLevel()
-    {
-        UINT maxBLevel;
-        
-        #pragma omp atomic read
-        maxBLevel = c_maxBLevel;
-        
-        return maxBLevel;
-    }
-    
-private:
-    Mat2<UINT> &c_bLevels;
-    Mat2<UINT> &c_sideBLevels;
-    UINT c_maxBLevel;
-};
-
-
-/*
-    NeighborPriorityData
-    
-    Calculates priorities when traversing a graph.
-    Can calculate BFDS, DFDS, or DFHDS depending on 
-    boundScale, boundShift, parentShift.
-    
-            boundScale   boundShift   parentShift
-    BFDS  =     1             0             0
-    DFDS  =     1         maxBLevel        -1
-    DFHDS =  maxBLevel    maxBLevel        -1
-    
-    Note: OpenMP assumes threading across angle.
-          Without this assumption, there could be a race condition.
-*/
-class NeighborPriorityData : public TraverseData
-{
-public:
-    
-    /*
-        Constructor
-    */
-    NeighborPriorityData(Mat2<UINT> &priorities, const Mat2<UINT> &sideBLevels, 
-                         const UINT boundScale, const UINT boundShift, 
-                         const int parentShift)
-    : c_priorities(priorities), c_sideBLevels(sideBLevels), 
-      c_boundScale(boundScale), c_boundShift(boundShift), c_parentShift(parentShift)
-    {
-        c_priorities.setAll(0);
-    }
-    
-    
-    /*
-        data
-        
-        Return priority data given (cell, angle) pair.
-    */
-    virtual const char* getData(UINT cell, UINT face, UINT angle)
-    {
-        UNUSED_VARIABLE(face);
-        return (char*) (&c_priorities(cell, angle));
-    }
-    
-    
-    /*
-        getPriority
-        
-        Return a priority for the cell/angle pair.
-        Not needed for this class, so it is just set to a constant.
-    */
-    virtual UINT getPriority(UINT cell, UINT angle)
-    {
-        UNUSED_VARIABLE(cell);
-        UNUSED_VARIABLE(angle);
-        return 1;
-    }
-    
-    
-    /*
-        update
-        
-        Updates priority information for a given (cell, angle) pair.
-    */
-    virtual void update(UINT cell, UINT angle, 
-                        UINT adjCellsSides[g_nFacePerCell], 
-                        BoundaryType bdryType[g_nFacePerCell])
-    {
-        c_priorities(cell, angle) = 0;
-        
-        for (UINT face = 0; face < g_nFacePerCell; face++) {
-            
-            UINT priority = 0;
-            
-            if (bdryType[face] == BoundaryType_OutIntBdry) {
-                UINT adjSide = adjCellsSides[face];
-                priority = c_sideBLevels(adjSide, angle) * c_boundScale + 
-                           c_boundShift;
-            }
-            
-            else if (bdryType[face] == BoundaryType_OutInt) {
-                UINT adjCell = adjCellsSides[face];
-                priority = c_priorities(adjCell, angle) + c_parentShift;
-            }
-            
-            c_priorities(cell, angle) = max(c_priorities(cell, angle), priority);
-        }
-    }
-    
-    
-    /*
-        These should never be called.
-        They are only used when communication is involved in traversing the
-        graph.
-    */
-    virtual void setSideData(UINT side, UINT angle, const char *data)
-    {
-        UNUSED_VARIABLE(side);
-        UNUSED_VARIABLE(angle);
-        UNUSED_VARIABLE(data);
-        Assert(false);
-    }
-    
-private:
-    Mat2<UINT> &c_priorities;
-    const Mat2<UINT> &c_sideBLevels;
-    const UINT c_boundScale;
-    const UINT c_boundShift;
-    const int c_parentShift;
-};
-
-
 /*
     calcBLevels
 */
@@ -327,15 +106,35 @@ void neighborPriorities(const Mat2<UINT> &sideBLevels,
                         const UINT boundScale, 
                         const UINT boundShift, 
                         const int parentShift,  // Can be -1 or 0
+                        const bool sumBoundary,
                         Mat2<UINT> &priorities,
                         GraphTraverser *graphTraverser)
 {
     NeighborPriorityData priorityData(priorities, sideBLevels, 
-                                      boundScale, boundShift, parentShift);
+                                      boundScale, boundShift, parentShift,
+                                      sumBoundary);
     graphTraverser->traverse(g_maxCellsPerStep, priorityData);
 }
 
 
+/*
+    cadsPriorities
+    
+    CADS weights off rank downstream faces by the b-level of the remote cell,
+    so it needs the global side b-levels.  The local traverser has none 
+    (doComm = false never sets side data).
+*/
+static
+void cadsPriorities(Mat2<UINT> &priorities, GraphTraverser *graphTraverser)
+{
+    Mat2<UINT> sideBLevels(g_tychoMesh->getNSides(), g_nAngles);
+    UINT globalMaxBLevel = 
+        Priorities::calcGlobalSideBLevels(sideBLevels);
+    neighborPriorities(sideBLevels, 1, globalMaxBLevel, -1, true, 
+                       priorities, graphTraverser);
+}
+
+
 /*
     anglePriorities
 */
@@ -383,6 +182,18 @@ void anglePriorities(const UINT numAngles, const UINT interAngleP,
             }
             break;
         }
+        case 3:  // spatial tiles, angles interleaved within a tile
+        {
+            vector<UINT> tiles;
+            CellOrdering::calcTiles(g_cellsPerTile, tiles);
+            UINT numTiles = (g_nCells + g_cellsPerTile - 1) / g_cellsPerTile;
+            for (UINT angle = 0; angle < numAngles; ++angle) {
+            for (UINT cell = 0; cell < g_nCells; ++cell) {
+                priorities(cell, angle) += 
+                    (numTiles - 1 - tiles[cell]) * nlevels * ncells;
+            }}
+            break;
+        }
     }
 }
 
@@ -390,13 +201,70 @@ void anglePriorities(const UINT numAngles, const UINT interAngleP,
 namespace Priorities
 {
 
+/*
+    calcGlobalSideBLevels
+    
+    Global b-levels for the whole mesh, not just each partition.
+    sideBLevels(side, angle) is the b-level of the cell on the adjacent rank
+    across each interior boundary side.
+    Returns the maximum b-level.
+*/
+UINT calcGlobalSideBLevels(Mat2<UINT> &sideBLevels)
+{
+    // Cached side b-levels followed by the maximum b-level
+    vector<UINT> params = {g_snOrder, g_nAngles};
+    UINT cacheKey = ScheduleCache::calcKey(params);
+    vector<UINT> cacheData;
+    if (ScheduleCache::read("SideBLevels", cacheKey, cacheData)) {
+        Insist(cacheData.size() == sideBLevels.size() + 1, 
+               "Corrupt side b-levels in cache.");
+        for (UINT i = 0; i < sideBLevels.size(); i++) {
+            sideBLevels[i] = cacheData[i];
+        }
+        return cacheData.back();
+    }
+    
+    const bool doComm = true;
+    const UINT numGroupBlocks = 1;
+    GraphTraverser graphTraverser(Direction_Backward, doComm, sizeof(UINT), 
+                                  numGroupBlocks);
+    Mat2<UINT> bLevels(g_nCells, g_nAngles);
+    
+    UINT maxBLevel = calcBLevels(bLevels, sideBLevels, &graphTraverser);
+    
+    cacheData.assign(&sideBLevels[0], &sideBLevels[0] + sideBLevels.size());
+    cacheData.push_back(maxBLevel);
+    ScheduleCache::write("SideBLevels", cacheKey, cacheData);
+    return maxBLevel;
+}
+
+
 /*
     calcPriorities
 */
 void calcPriorities(Mat2<UINT> &priorities)
 {
+    // Cached priorities for these parameters
+    vector<UINT> params = {g_snOrder, g_nAngles, g_intraAngleP, 
+                           g_interAngleP, g_cellsPerTile};
+    UINT cacheKey = ScheduleCache::calcKey(params);
+    vector<UINT> cacheData;
+    if (ScheduleCache::read("Priorities", cacheKey, cacheData)) {
+        Insist(cacheData.size() == priorities.size(), 
+               "Corrupt priorities in cache.");
+        for (UINT i = 0; i < priorities.size(); i++) {
+            priorities[i] = cacheData[i];
+        }
+        if (Comm::rank() == 0) {
+            printf("Priorities read from cache\n");
+        }
+        return;
+    }
+    
     const bool doComm = false;
-    GraphTraverser graphTraverser(Direction_Backward, doComm, sizeof(UINT));
+    const UINT numGroupBlocks = 1;
+    GraphTraverser graphTraverser(Direction_Backward, doComm, sizeof(UINT), 
+                                  numGroupBlocks);
     
     UINT numAngles = g_nAngles;
     Mat2<UINT> bLevels(g_nCells, numAngles);
@@ -416,22 +284,100 @@ void calcPriorities(Mat2<UINT> &priorities)
         levelPriorities(bLevels, numAngles, priorities);
         break;
       case 2:  // breadth-first dependent seeking
-        neighborPriorities(sideBLevels, 1, 0, 0, 
+        neighborPriorities(sideBLevels, 1, 0, 0, false, 
                            priorities, &graphTraverser);
         break;
       case 3:  // depth-first dependent seeking
-        neighborPriorities(sideBLevels, 1, maxBLevel, -1, 
+        neighborPriorities(sideBLevels, 1, maxBLevel, -1, false, 
                            priorities, &graphTraverser);
         break;
       case 4:  // strict depth-first dependent seeking
-        neighborPriorities(sideBLevels, maxBLevel, maxBLevel, -1, 
+        neighborPriorities(sideBLevels, maxBLevel, maxBLevel, -1, false, 
                            priorities, &graphTraverser);
         break;
+      case 5:  // communication aware dependent seeking
+        cadsPriorities(priorities, &graphTraverser);
+        break;
     }
     
     
     // Calculate inter-angle priorities
     anglePriorities(numAngles, g_interAngleP, maxBLevel, priorities);
+    
+    
+    // Save for later runs
+    cacheData.assign(&priorities[0], &priorities[0] + priorities.size());
+    ScheduleCache::write("Priorities", cacheKey, cacheData);
+}
+
+
+/*
+    calcLocalPriorities
+    
+    Priorities for sweeps that don't communicate (Util::sweepLocal), where
+    only cache reuse matters.  Angles are done one after another and the 
+    cells of an angle in a depth-first topological order of the local 
+    dependency graph, so a cell is usually computed right after the parent
+    whose data it reads.
+*/
+void calcLocalPriorities(Mat2<UINT> &priorities)
+{
+    const bool doComm = false;
+    vector<UINT> numParentsLeft(g_nCells);
+    vector<UINT> order;
+    vector<pair<const UINT*, const UINT*>> stack;
+    order.reserve(g_nCells);
+    
+    for (UINT angle = 0; angle < g_nAngles; angle++) {
+        
+        // Topological order found depth first from each source cell
+        // A cell is added once all its local parents are, and the search 
+        // continues from it right away
+        order.clear();
+        for (UINT cell = 0; cell < g_nCells; cell++) {
+            numParentsLeft[cell] = g_dependencyGraph->getNumParents(
+                Direction_Forward, doComm, cell, angle);
+        }
+        
+        for (UINT source = 0; source < g_nCells; source++) {
+            if (g_dependencyGraph->getNumParents(
+                    Direction_Forward, doComm, source, angle) != 0)
+                continue;
+            
+            stack.push_back(make_pair(
+                g_dependencyGraph->childrenBegin(Direction_Forward, source, 
+                                                 angle),
+                g_dependencyGraph->childrenEnd(Direction_Forward, source, 
+                                               angle)));
+            order.push_back(source);
+            while (stack.size() > 0) {
+                pair<const UINT*, const UINT*> &top = stack.back();
+                if (top.first == top.second) {
+                    stack.pop_back();
+                    continue;
+                }
+                
+                UINT child = *(top.first++);
+                if (--numParentsLeft[child] == 0) {
+                    order.push_back(child);
+                    stack.push_back(make_pair(
+                        g_dependencyGraph->childrenBegin(Direction_Forward, 
+                                                         child, angle),
+                        g_dependencyGraph->childrenEnd(Direction_Forward, 
+                                                       child, angle)));
+                }
+            }
+        }
+        Insist(order.size() == g_nCells, 
+               "Local dependency graph has a cycle.");
+        
+        
+        // Earlier in the order and earlier angles go first
+        for (UINT i = 0; i < g_nCells; i++) {
+            priorities(order[i], angle) = 
+                (g_nAngles - 1 - angle) * g_nCells + (g_nCells - 1 - i);
+        }
+    }
 }
 
 } // End namespace
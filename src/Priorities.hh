@@ -47,6 +47,8 @@ namespace Priorities
 {
 
 void calcPriorities(Mat2<UINT> &priorities);
+UINT calcGlobalSideBLevels(Mat2<UINT> &sideBLevels);
+void calcLocalPriorities(Mat2<UINT> &priorities);
 
 }
 
@@ -0,0 +1,316 @@
+/*
+Copyright (c) 2016, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2016. Los Alamos National Security, LLC. This software was produced 
+under U.S. Government contract DE-AC52-06NA25396 for Los Alamos National 
+Laboratory (LANL), which is operated by Los Alamos National Security, LLC for 
+the U.S. Department of Energy. The U.S. Government has rights to use, 
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR LOS 
+ALAMOS NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR 
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified 
+to produce derivative works, such modified software should be clearly marked, 
+so as not to confuse it with the version available from LANL.
+
+Additionally, redistribution and use in source and binary forms, with or 
+without modification, are permitted provided that the following conditions 
+are met:
+1.      Redistributions of source code must retain the above copyright notice, 
+        this list of conditions and the following disclaimer.
+2.      Redistributions in binary form must reproduce the above copyright 
+        notice, this list of conditions and the following disclaimer in the 
+        documentation and/or other materials provided with the distribution.
+3.      Neither the name of Los Alamos National Security, LLC, Los Alamos 
+        National Laboratory, LANL, the U.S. Government, nor the names of its 
+        contributors may be used to endorse or promote products derived from 
+        this software without specific prior written permission.
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND 
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT 
+NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS ALAMOS NATIONAL 
+SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; 
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __PRIORITY_DATA_HH__
+#define __PRIORITY_DATA_HH__
+
+#include "GraphTraverser.hh"
+#include "Mat.hh"
+#include "Global.hh"
+#include "Assert.hh"
+#include <algorithm>
+#include <vector>
+#include <omp.h>
+
+
+/*
+    BLevelData
+    
+    Calculates b-levels when traversing a graph.
+    Note: update only writes the (cell, angle) pair it is given and only
+          reads pairs the traversal has finished, so threads may share an
+          angle.
+*/
+class BLevelData final : public TraverseData
+{
+public:
+    
+    /*
+        Constructor
+    */
+    BLevelData(Mat2<UINT> &bLevels, Mat2<UINT> &sideBLevels)
+    : c_bLevels(bLevels), c_sideBLevels(sideBLevels)
+    {
+        // Initialize all to 0 b-level
+        // Each thread keeps its own maximum, a cache line apart from the 
+        // others
+        c_maxBLevels.assign(g_nThreads * c_padUINTs, 0);
+        bLevels.setAll(0);
+        sideBLevels.setAll(0);
+        c_bLevels.setAll(0);
+        c_sideBLevels.setAll(0);
+    }
+    
+    
+    /*
+        getData
+        
+        Return b-level data given (cell, angle) pair.
+    */
+    virtual const char* getData(UINT cell, UINT face, UINT angle, 
+                                UINT groupBlock)
+    {
+        UNUSED_VARIABLE(face);
+        UNUSED_VARIABLE(groupBlock);
+        return (char*) (&c_bLevels(cell, angle));
+    }
+    
+    
+    /*
+        setSideData
+        
+        Return b-level data given (side, angle) pair.
+    */
+    virtual void setSideData(UINT side, UINT angle, UINT groupBlock, 
+                             const char *data)
+    {
+        UNUSED_VARIABLE(groupBlock);
+        c_sideBLevels(side, angle) = *((UINT*)(data));
+    }
+    
+    
+    /*
+        getPriority
+        
+        Return a priority for the cell/angle pair.
+        Not needed for this class, so it is just set to a constant.
+    */
+    virtual UINT getPriority(UINT cell, UINT angle)
+    {
+        UNUSED_VARIABLE(cell);
+        UNUSED_VARIABLE(angle);
+        return 1;
+    }
+    
+    
+    /*
+        update
+        
+        Updates b-level information for a given (cell, angle) pair.
+    */
+    virtual void update(UINT cell, UINT angle, UINT groupBlock, 
+                        UINT adjCellsSides[g_nFacePerCell], 
+                        BoundaryType bdryType[g_nFacePerCell])
+    {
+        UNUSED_VARIABLE(groupBlock);
+        c_bLevels(cell, angle) = 0;
+        for (UINT face = 0; face < g_nFacePerCell; face++) {
+            
+            if (bdryType[face] == BoundaryType_OutIntBdry) {
+                UINT adjSide = adjCellsSides[face];
+                UINT adjBLevel = c_sideBLevels(adjSide, angle);
+                c_bLevels(cell, angle) = 
+                    std::max(c_bLevels(cell, angle), adjBLevel + 1);
+            }
+            
+            else if (bdryType[face] == BoundaryType_OutInt) {
+                UINT adjCell = adjCellsSides[face];
+                UINT adjBLevel = c_bLevels(adjCell, angle);
+                c_bLevels(cell, angle) = 
+                    std::max(c_bLevels(cell, angle), adjBLevel + 1);
+            }
+        }
+        
+        UINT &maxBLevel = c_maxBLevels[omp_get_thread_num() * c_padUINTs];
+        maxBLevel = std::max(maxBLevel, c_bLevels(cell, angle));
+    }
+    
+    
+    /*
+        getMaxBLevel
+        
+        Reduces the per-thread maxima.  Call outside of the traversal.
+    */
+    UINT getMaxBLevel()
+    {
+        UINT maxBLevel = 0;
+        for (UINT thread = 0; thread < g_nThreads; thread++) {
+            maxBLevel = std::max(maxBLevel, c_maxBLevels[thread * c_padUINTs]);
+        }
+        return maxBLevel;
+    }
+    
+private:
+    static const UINT c_padUINTs = g_nBytesPerCacheLine / sizeof(UINT);
+    Mat2<UINT> &c_bLevels;
+    Mat2<UINT> &c_sideBLevels;
+    std::vector<UINT> c_maxBLevels;
+};
+
+
+/*
+    NeighborPriorityData
+    
+    Calculates priorities when traversing a graph.
+    Can calculate BFDS, DFDS, DFHDS, or CADS depending on 
+    boundScale, boundShift, parentShift, sumBoundary.
+    
+            boundScale   boundShift   parentShift   sumBoundary
+    BFDS  =     1             0             0           false
+    DFDS  =     1         maxBLevel        -1           false
+    DFHDS =  maxBLevel    maxBLevel        -1           false
+    CADS  =     1         maxBLevel        -1           true
+    
+    CADS (communication aware dependent seeking) sums remote b-level + 1 
+    over all of a cell's off rank downstream faces, so cells feeding more 
+    remote cells, or remote cells further from the end of the sweep, go 
+    first.  The remote b-levels must be global ones 
+    (Priorities::calcGlobalSideBLevels) with maxBLevel the global maximum.
+    
+    Note: update only writes the (cell, angle) pair it is given and only
+          reads pairs the traversal has finished, so threads may share an
+          angle.
+*/
+class NeighborPriorityData final : public TraverseData
+{
+public:
+    
+    /*
+        Constructor
+    */
+    NeighborPriorityData(Mat2<UINT> &priorities, const Mat2<UINT> &sideBLevels, 
+                         const UINT boundScale, const UINT boundShift, 
+                         const int parentShift, const bool sumBoundary)
+    : c_priorities(priorities), c_sideBLevels(sideBLevels), 
+      c_boundScale(boundScale), c_boundShift(boundShift), 
+      c_parentShift(parentShift), c_sumBoundary(sumBoundary)
+    {
+        c_priorities.setAll(0);
+    }
+    
+    
+    /*
+        data
+        
+        Return priority data given (cell, angle) pair.
+    */
+    virtual const char* getData(UINT cell, UINT face, UINT angle, 
+                                UINT groupBlock)
+    {
+        UNUSED_VARIABLE(face);
+        UNUSED_VARIABLE(groupBlock);
+        return (char*) (&c_priorities(cell, angle));
+    }
+    
+    
+    /*
+        getPriority
+        
+        Return a priority for the cell/angle pair.
+        Not needed for this class, so it is just set to a constant.
+    */
+    virtual UINT getPriority(UINT cell, UINT angle)
+    {
+        UNUSED_VARIABLE(cell);
+        UNUSED_VARIABLE(angle);
+        return 1;
+    }
+    
+    
+    /*
+        update
+        
+        Updates priority information for a given (cell, angle) pair.
+    */
+    virtual void update(UINT cell, UINT angle, UINT groupBlock, 
+                        UINT adjCellsSides[g_nFacePerCell], 
+                        BoundaryType bdryType[g_nFacePerCell])
+    {
+        UNUSED_VARIABLE(groupBlock);
+        c_priorities(cell, angle) = 0;
+        UINT boundarySum = 0;
+        
+        for (UINT face = 0; face < g_nFacePerCell; face++) {
+            
+            UINT priority = 0;
+            
+            if (bdryType[face] == BoundaryType_OutIntBdry && c_sumBoundary) {
+                UINT adjSide = adjCellsSides[face];
+                boundarySum += (c_sideBLevels(adjSide, angle) + 1) * 
+                               c_boundScale;
+            }
+            
+            else if (bdryType[face] == BoundaryType_OutIntBdry) {
+                UINT adjSide = adjCellsSides[face];
+                priority = c_sideBLevels(adjSide, angle) * c_boundScale + 
+                           c_boundShift;
+            }
+            
+            else if (bdryType[face] == BoundaryType_OutInt) {
+                UINT adjCell = adjCellsSides[face];
+                priority = c_priorities(adjCell, angle) + c_parentShift;
+            }
+            
+            c_priorities(cell, angle) = 
+                std::max(c_priorities(cell, angle), priority);
+        }
+        
+        if (boundarySum > 0) {
+            c_priorities(cell, angle) = 
+                std::max(c_priorities(cell, angle), 
+                         boundarySum + c_boundShift);
+        }
+    }
+    
+    
+    /*
+        These should never be called.
+        They are only used when communication is involved in traversing the
+        graph.
+    */
+    virtual void setSideData(UINT side, UINT angle, UINT groupBlock, 
+                             const char *data)
+    {
+        UNUSED_VARIABLE(side);
+        UNUSED_VARIABLE(angle);
+        UNUSED_VARIABLE(groupBlock);
+        UNUSED_VARIABLE(data);
+        Assert(false);
+    }
+    
+private:
+    Mat2<UINT> &c_priorities;
+    const Mat2<UINT> &c_sideBLevels;
+    const UINT c_boundScale;
+    const UINT c_boundShift;
+    const int c_parentShift;
+    const bool c_sumBoundary;
+};
+
+#endif
@@ -96,10 +96,12 @@ void PsiData::writeToFile(const std::string &filename)
         int dataSize = c_na * c_ng * c_nv;
         uint64_t globalCell = g_tychoMesh->getLGCell(cell);
         uint64_t offset = 8 + globalCell * dataSize;
-        float *data = &c_data[index(0, 0, 0, cell)];
-	for(int i=0; i< dataSize; i++){
-		dbldata[i] = (double)data[i];
-	}
+        for (size_t angle = 0; angle < c_na; angle++) {
+        for (size_t vrtx = 0; vrtx < c_nv; vrtx++) {
+        for (size_t group = 0; group < c_ng; group++) {
+            dbldata[(angle * c_nv + vrtx) * c_ng + group] = 
+                (double)c_data[index(group, vrtx, angle, cell)];
+        }}}
         Comm::writeDoublesAt(file, offset, dbldata.data(), dataSize);
     }
 
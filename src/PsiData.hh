@@ -46,6 +46,7 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Quadrature.hh"
 #include "TychoMesh.hh"
 #include <string>
+#include <vector>
 
 
 /*
@@ -55,6 +56,11 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
     v = vertex
     a = angle
     c = cell
+    
+    Groups are split into g_nGroupBlocks blocks, each stored on its own as
+    psi(g in block, v, a, c).  Threads sweeping different group blocks then
+    write to different cache lines.  With one group block, groups are the
+    fastest index.
 */
 class PsiData {
 public:
@@ -97,6 +103,7 @@ public:
         c_nv = g_nVrtxPerCell;
         c_na = g_nAngles;
         c_nc = g_nCells;
+        setGroupOffsets();
         c_data = new float[size()];
         setToValue(0.0);
         c_ownData = true;
@@ -108,6 +115,7 @@ public:
         c_nv = g_nVrtxPerCell;
         c_na = g_nAngles;
         c_nc = g_nCells;
+        setGroupOffsets();
         c_data = data;
         c_ownData = false;
     }
@@ -147,10 +155,26 @@ public:
 // Private    
 private:
     size_t c_ng, c_nv, c_na, c_nc;
+    size_t c_ngb;
+    std::vector<size_t> c_groupOffsets;
     float *c_data;
     bool c_ownData;
 
 
+    // Offset of each group from the start of its group block's (v, a, c)
+    // entry
+    void setGroupOffsets()
+    {
+        c_ngb = c_ng / g_nGroupBlocks;
+        c_groupOffsets.resize(c_ng);
+        for (size_t g = 0; g < c_ng; g++) {
+            size_t block = g / c_ngb;
+            c_groupOffsets[g] = block * c_ngb * c_nv * c_na * c_nc + 
+                                g % c_ngb;
+        }
+    }
+
+
     // Compute the offset into the data array.
     size_t index(size_t g, size_t v, size_t a, size_t c) const
     {
@@ -159,7 +183,7 @@ private:
         Assert(a < c_na);
         Assert(c < c_nc);
         
-        return ((c * c_na + a) * c_nv + v) * c_ng + g;
+        return ((c * c_na + a) * c_nv + v) * c_ngb + c_groupOffsets[g];
     }
 };
 
@@ -0,0 +1,234 @@
+/*
+Copyright (c) 2016, Los Alamos National Security, LLC
+All rights reserved.
+
+Copyright 2016. Los Alamos National Security, LLC. This software was produced 
+under U.S. Government contract DE-AC52-06NA25396 for Los Alamos National 
+Laboratory (LANL), which is operated by Los Alamos National Security, LLC for 
+the U.S. Department of Energy. The U.S. Government has rights to use, 
+reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR LOS 
+ALAMOS NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR 
+ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified 
+to produce derivative works, such modified software should be clearly marked, 
+so as not to confuse it with the version available from LANL.
+
+Additionally, redistribution and use in source and binary forms, with or 
+without modification, are permitted provided that the following conditions 
+are met:
+1.      Redistributions of source code must retain the above copyright notice, 
+        this list of conditions and the following disclaimer.
+2.      Redistributions in binary form must reproduce the above copyright 
+        notice, this list of conditions and the following disclaimer in the 
+        documentation and/or other materials provided with the distribution.
+3.      Neither the name of Los Alamos National Security, LLC, Los Alamos 
+        National Laboratory, LANL, the U.S. Government, nor the names of its 
+        contributors may be used to endorse or promote products derived from 
+        this software without specific prior written permission.
+THIS SOFTWARE IS PROVIDED BY LOS ALAMOS NATIONAL SECURITY, LLC AND 
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT 
+NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LOS ALAMOS NATIONAL 
+SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, 
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; 
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, 
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR 
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED 
+OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "ScheduleCache.hh"
+#include "TychoMesh.hh"
+#include "Global.hh"
+#include "Comm.hh"
+#include "Assert.hh"
+#include <mpi.h>
+#include <climits>
+#include <cstring>
+#include <vector>
+#include <string>
+
+using namespace std;
+
+
+// Bump when the format of any record changes
+static const uint64_t c_version = 1;
+static const UINT c_headerSize = 3;
+
+
+/*
+    hashWord
+    
+    FNV-1a style hash, one 64 bit word at a time.
+*/
+static
+void hashWord(const uint64_t word, uint64_t &hash)
+{
+    hash ^= word;
+    hash *= 1099511628211ULL;
+}
+
+
+/*
+    hashMesh
+    
+    Hash of the local part of the mesh, including where its neighbors are.
+    Cells renumbered by CellNumbering hash differently.
+*/
+static
+void hashMesh(uint64_t &hash)
+{
+    hashWord(Comm::rank(), hash);
+    hashWord(Comm::numRanks(), hash);
+    hashWord(g_nCells, hash);
+    hashWord(g_tychoMesh->getNNodes(), hash);
+    hashWord(g_tychoMesh->getNSides(), hash);
+    
+    for (UINT node = 0; node < g_tychoMesh->getNNodes(); node++) {
+    for (UINT dim = 0; dim < g_ndim; dim++) {
+        double coord = g_tychoMesh->getNodeCoord(node, dim);
+        uint64_t word;
+        memcpy(&word, &coord, sizeof(uint64_t));
+        hashWord(word, hash);
+    }}
+    
+    for (UINT cell = 0; cell < g_nCells; cell++) {
+        hashWord(g_tychoMesh->getLGCell(cell), hash);
+        for (UINT vrtx = 0; vrtx < g_nVrtxPerCell; vrtx++) {
+            hashWord(g_tychoMesh->getCellNode(cell, vrtx), hash);
+        }
+        for (UINT face = 0; face < g_nFacePerCell; face++) {
+            hashWord(g_tychoMesh->getAdjCell(cell, face), hash);
+            hashWord(g_tychoMesh->getAdjRank(cell, face), hash);
+        }
+    }
+    
+    for (UINT side = 0; side < g_tychoMesh->getNSides(); side++) {
+        hashWord(g_tychoMesh->getLGSide(side), hash);
+    }
+}
+
+
+/*
+    getFilename
+*/
+static
+string getFilename(const string &name)
+{
+    return g_scheduleCache + "." + name + "." + to_string(Comm::rank());
+}
+
+
+namespace ScheduleCache
+{
+
+/*
+    calcKey
+    
+    Key for a record computed from params on this rank's part of the mesh.
+*/
+UINT calcKey(const vector<UINT> &params)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    
+    hashMesh(hash);
+    hashWord(params.size(), hash);
+    for (UINT param : params) {
+        hashWord(param, hash);
+    }
+    
+    return hash;
+}
+
+
+/*
+    read
+    
+    Reads record name into data.  Returns true only if every rank found the
+    record with a matching key, so ranks either all use the cache or all 
+    recompute.
+*/
+bool read(const string &name, const UINT key, vector<UINT> &data)
+{
+    if (g_scheduleCache == "")
+        return false;
+    
+    
+    // Read this rank's file
+    UINT miss = 1;
+    MPI_File file;
+    string filename = getFilename(name);
+    int result = MPI_File_open(MPI_COMM_SELF, const_cast<char*>
+                               (filename.c_str()), MPI_MODE_RDONLY, 
+                               MPI_INFO_NULL, &file);
+    if (result == MPI_SUCCESS) {
+        uint64_t header[c_headerSize] = {0, 0, 0};
+        MPI_Offset fileSize = 0;
+        MPI_File_get_size(file, &fileSize);
+        
+        if ((UINT)fileSize >= c_headerSize * sizeof(uint64_t)) {
+            result = MPI_File_read_at(file, 0, header, c_headerSize, 
+                                      MPI_UINT64_T, MPI_STATUS_IGNORE);
+            Insist(result == MPI_SUCCESS, "ScheduleCache::read MPI error.");
+        }
+        
+        if (header[0] == c_version && header[1] == key && 
+            (UINT)fileSize == (c_headerSize + header[2]) * sizeof(uint64_t))
+        {
+            Insist(header[2] < INT_MAX, "Schedule cache record too large.");
+            data.resize(header[2]);
+            result = MPI_File_read_at(file, c_headerSize * sizeof(uint64_t),
+                                      data.data(), data.size(), 
+                                      MPI_UINT64_T, MPI_STATUS_IGNORE);
+            Insist(result == MPI_SUCCESS, "ScheduleCache::read MPI error.");
+            miss = 0;
+        }
+        
+        MPI_File_close(&file);
+    }
+    
+    
+    // All ranks must have the record
+    Comm::gmax(miss);
+    if (miss == 1)
+        data.clear();
+    
+    return miss == 0;
+}
+
+
+/*
+    write
+    
+    Writes data to record name, replacing what was there.
+*/
+void write(const string &name, const UINT key, const vector<UINT> &data)
+{
+    if (g_scheduleCache == "")
+        return;
+    
+    MPI_File file;
+    string filename = getFilename(name);
+    uint64_t header[c_headerSize] = {c_version, key, data.size()};
+    
+    int result = MPI_File_open(MPI_COMM_SELF, const_cast<char*>
+                               (filename.c_str()), 
+                               MPI_MODE_CREATE | MPI_MODE_WRONLY, 
+                               MPI_INFO_NULL, &file);
+    Insist(result == MPI_SUCCESS, "ScheduleCache::write can't open file.");
+    
+    Insist(data.size() < INT_MAX, "Schedule cache record too large.");
+    result = MPI_File_set_size(file, 0);
+    Insist(result == MPI_SUCCESS, "ScheduleCache::write MPI error.");
+    result = MPI_File_write_at(file, 0, header, c_headerSize, MPI_UINT64_T, 
+                               MPI_STATUS_IGNORE);
+    Insist(result == MPI_SUCCESS, "ScheduleCache::write MPI error.");
+    result = MPI_File_write_at(file, c_headerSize * sizeof(uint64_t), 
+                               data.data(), data.size(), MPI_UINT64_T, 
+                               MPI_STATUS_IGNORE);
+    Insist(result == MPI_SUCCESS, "ScheduleCache::write MPI error.");
+    
+    MPI_File_close(&file);
+}
+
+} // End namespace ScheduleCache
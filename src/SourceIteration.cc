@@ -44,6 +44,8 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Timer.hh"
 #include "Util.hh"
 #include "KrylovSolver.hh"
+#include "DSA.hh"
+#include "Anderson.hh"
 #include <math.h>
 
 
@@ -54,6 +56,7 @@ namespace
     LHSData
     
     Data needed by the Krylov solver
+    dsa is NULL if DSA isn't used.
 */
 class LHSData
 {
@@ -61,9 +64,11 @@ public:
     PsiData &c_psi;
     PsiData &c_source;
     SweeperAbstract &c_sweeper;
+    DSA *c_dsa;
 
-    LHSData(PsiData &psi, PsiData &source, SweeperAbstract &sweeper) :
-    c_psi(psi), c_source(source), c_sweeper(sweeper)    
+    LHSData(PsiData &psi, PsiData &source, SweeperAbstract &sweeper, 
+            DSA *dsa) :
+    c_psi(psi), c_source(source), c_sweeper(sweeper), c_dsa(dsa)
     {}
 };
 
@@ -72,6 +77,8 @@ public:
     lhsOperator
 
     Performs b = (I - D L^{-1} M S) x
+    With DSA, b is then left preconditioned by P = I + C^{-1} sigma_s, 
+    where C is the diffusion operator.
 */
 void lhsOperator(const double *x, double *b, void *voidData)
 {
@@ -111,6 +118,11 @@ void lhsOperator(const double *x, double *b, void *voidData)
     for (UINT i = 0; i < vecSize; i++) {
         b[i] = x[i] - b[i];
     }
+
+
+    // P operator
+    if (data->c_dsa != NULL)
+        data->c_dsa->addCorrection(phi, phi);
 }
 
 } // End anonymous namespace
@@ -123,6 +135,10 @@ namespace SourceIteration
 /*
     Fixed point iteration (typically called source iteration)
     L Psi^{n+1} = MS \Phi^n + Q
+    With DSA, the change in Phi from each sweep is followed by a diffusion 
+    correction.
+    With AndersonDepth > 0, Phi^{n+1} is mixed with the previous iterates 
+    by Anderson acceleration.
 */
 UINT fixedPoint(SweeperAbstract &sweeper, PsiData &psi, const PsiData &source)
 {
@@ -130,6 +146,10 @@ UINT fixedPoint(SweeperAbstract &sweeper, PsiData &psi, const PsiData &source)
     PsiData totalSource;
     PhiData phiNew;
     PhiData phiOld;
+    DSA *dsa = g_useDSA ? new DSA() : NULL;
+    Anderson *anderson = NULL;
+    if (g_andersonDepth > 0)
+        anderson = new Anderson(phiNew.size(), g_andersonDepth);
     
     
     // Get phi
@@ -163,8 +183,18 @@ UINT fixedPoint(SweeperAbstract &sweeper, PsiData &psi, const PsiData &source)
         sweeper.sweep(psi, totalSource);
         
         
-        // Calculate L_1 relative error for phi
+        // Diffusion correction
         Util::psiToPhi(phiNew, psi);
+        if (dsa != NULL) {
+            PhiData phiChange;
+            for (UINT i = 0; i < phiChange.size(); i++) {
+                phiChange[i] = phiNew[i] - phiOld[i];
+            }
+            dsa->addCorrection(phiChange, phiNew);
+        }
+        
+        
+        // Calculate L_1 relative error for phi
         error = 0.0;
         for (UINT i = 0; i < phiNew.size(); i++) {
             error += fabs(phiNew[i] - phiOld[i]);
@@ -184,6 +214,11 @@ UINT fixedPoint(SweeperAbstract &sweeper, PsiData &psi, const PsiData &source)
                    iter, error, wallClockTime);
         }
         
+        
+        // Anderson mixing
+        if (anderson != NULL && error > g_errMax)
+            anderson->update(&phiOld[0], &phiNew[0]);
+        
 
         // Increment iteration
         ++iter;
@@ -200,6 +235,14 @@ UINT fixedPoint(SweeperAbstract &sweeper, PsiData &psi, const PsiData &source)
         printf("Average source iteration time: %.2f\n\n",
                clockTime / iter);
     }
+    if (dsa != NULL) {
+        if (Comm::rank() == 0) {
+            printf("DSA CG iterations: %" PRIu64 " in %" PRIu64 " solves\n\n",
+                   dsa->getNumIterations(), dsa->getNumSolves());
+        }
+        delete dsa;
+    }
+    delete anderson;
 
 
     // Return number of iterations
@@ -227,12 +270,13 @@ UINT krylov(SweeperAbstract &sweeper, PsiData &psi, const PsiData &source)
 
     // Create the Krylov solver
     vecSize = g_nCells * g_nVrtxPerCell * g_nGroups;
-    LHSData data(psi, tempSource, sweeper);
+    DSA *dsa = g_useDSA ? new DSA() : NULL;
+    LHSData data(psi, tempSource, sweeper, dsa);
     KrylovSolver krylovSolver(vecSize, g_errMax, g_iterMax, lhsOperator);
     krylovSolver.setData(&data);
 
 
-    // Setup RHS (b = D L^{-1} Q)
+    // Setup RHS (b = D L^{-1} Q, or P D L^{-1} Q with DSA)
     if (Comm::rank() == 0)
         printf("Krylov source\n");
     sweeper.sweep(psi, source);
@@ -240,6 +284,8 @@ UINT krylov(SweeperAbstract &sweeper, PsiData &psi, const PsiData &source)
     bArray = krylovSolver.getB();
     PhiData phiB(bArray);
     Util::psiToPhi(phiB, psi);
+    if (dsa != NULL)
+        dsa->addCorrection(phiB, phiB);
     krylovSolver.releaseB();
 
 
@@ -278,6 +324,13 @@ UINT krylov(SweeperAbstract &sweeper, PsiData &psi, const PsiData &source)
         printf("Average Krylov time: %.2f\n\n",
                clockTime / its);
     }
+    if (dsa != NULL) {
+        if (Comm::rank() == 0) {
+            printf("DSA CG iterations: %" PRIu64 " in %" PRIu64 " solves\n\n",
+                   dsa->getNumIterations(), dsa->getNumSolves());
+        }
+        delete dsa;
+    }
 
 
     // Return number of iterations
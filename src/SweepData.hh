@@ -44,16 +44,22 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Assert.hh"
 #include "GraphTraverser.hh"
 #include "Transport.hh"
+#include "TychoMesh.hh"
+#include "DependencyGraph.hh"
 #include "Global.hh"
 #include <stddef.h>
+#include <vector>
+#include <utility>
 #include <omp.h>
 
 /*
     SweepData
     
     Holds psi and other data for the sweep.
+    Each (cell, angle) pair is updated one group block at a time, so data
+    sent between ranks is for one group block.
 */
-class SweepData : public TraverseData
+class SweepData final : public TraverseData
 {
 public:
     
@@ -62,7 +68,8 @@ public:
     : c_psi(psi), c_psiBound(psiBound), c_source(source), 
       c_priorities(priorities), c_localFaceData(g_nThreads),
       c_localSource(g_nThreads), c_localPsi(g_nThreads),
-      c_localPsiBound(g_nThreads)
+      c_localPsiBound(g_nThreads), c_changedSides(NULL), c_updated(NULL),
+      c_updatedPairs(g_nThreads * c_padVectors)
     {
         for (UINT angleGroup = 0; angleGroup < g_nThreads; angleGroup++) {
             c_localFaceData[angleGroup].resize(g_nVrtxPerFace, g_nGroups);
@@ -74,48 +81,107 @@ public:
     }
     
 
+    /*
+        setIncremental
+        
+        Only updates pairs with an incoming face whose data changed since 
+        the last sweep, which are the pairs downstream of changed incoming 
+        boundary data.  changedSides(side, angle) marks the changed 
+        boundary data.  psi of the other pairs is kept.
+        updated(cell, groupBlock * g_nAngles + angle) marks the pairs this 
+        sweep updated.  It is kept by the caller across sweeps and must be
+        all false; clearUpdated resets only the entries the sweep set.
+    */
+    void setIncremental(const Mat2<bool> &changedSides, Mat2<bool> &updated)
+    {
+        c_changedSides = &changedSides;
+        c_updated = &updated;
+    }
+    
+    
+    /*
+        clearUpdated
+        
+        Sets the entries of updated marked by the last incremental sweep 
+        back to false.
+    */
+    void clearUpdated()
+    {
+        for (UINT i = 0; i < c_updatedPairs.size(); i++) {
+            for (const std::pair<UINT,UINT> &pair : c_updatedPairs[i]) {
+                (*c_updated)(pair.first, pair.second) = false;
+            }
+            c_updatedPairs[i].clear();
+        }
+    }
+    
+    
+    /*
+        getNumUpdated
+        
+        Number of (cell, angle, group block) updates done by an incremental
+        sweep.
+    */
+    UINT getNumUpdated() const
+    {
+        UINT numUpdated = 0;
+        for (UINT i = 0; i < c_updatedPairs.size(); i++) {
+            numUpdated += c_updatedPairs[i].size();
+        }
+        return numUpdated;
+    }
+    
+    
     /*
         getDataSizeInBytes
     */
     static
     size_t getDataSizeInBytes()
     {
-        return g_nGroups * g_nVrtxPerFace * sizeof(double);
+        return g_nGroups / g_nGroupBlocks * g_nVrtxPerFace * sizeof(double);
     }
     
     
     /*
         data
         
-        Return psi for vertices and groups at the given (cell,face,angle) tuple
+        Return psi for vertices and groups in the group block at the given 
+        (cell,face,angle) tuple
     */
-    virtual const char* getData(UINT cell, UINT face, UINT angle)
+    virtual const char* getData(UINT cell, UINT face, UINT angle, 
+                                UINT groupBlock)
     {
         Mat2<double> &localFaceData = c_localFaceData[omp_get_thread_num()];
+        UINT groupBegin = groupBlock * (g_nGroups / g_nGroupBlocks);
+        UINT groupEnd = groupBegin + g_nGroups / g_nGroupBlocks;
         
-        for (UINT group = 0; group < g_nGroups; group++) {
+        for (UINT group = groupBegin; group < groupEnd; group++) {
         for (UINT fvrtx = 0; fvrtx < g_nVrtxPerFace; fvrtx++) {
             UINT vrtx = g_tychoMesh->getFaceToCellVrtx(cell, face, fvrtx);
             localFaceData(fvrtx, group) = c_psi(group, vrtx, angle, cell);
         }}
         
-        return (char*) (&localFaceData[0]);
+        return (char*) (&localFaceData(0, groupBegin));
     }
        
         
     /*
         sideData
         
-        Set psiBound for the (side, angle) pair.
+        Set psiBound for the (side, angle) pair and the group block.
     */
-    virtual void setSideData(UINT side, UINT angle, const char *data)
+    virtual void setSideData(UINT side, UINT angle, UINT groupBlock, 
+                             const char *data)
     {
-        Mat2<double> localFaceData(g_nVrtxPerFace, g_nGroups);
+        UINT groupsPerBlock = g_nGroups / g_nGroupBlocks;
+        UINT groupBegin = groupBlock * groupsPerBlock;
+        Mat2<double> localFaceData(g_nVrtxPerFace, groupsPerBlock);
         localFaceData.setData((double*)data);
         
         for (UINT fvrtx = 0; fvrtx < g_nVrtxPerFace; fvrtx++) {
-        for (UINT group = 0; group < g_nGroups; group++) {
-            c_psiBound(group, fvrtx, angle, side) = localFaceData(fvrtx, group);
+        for (UINT group = 0; group < groupsPerBlock; group++) {
+            c_psiBound(groupBegin + group, fvrtx, angle, side) = 
+                localFaceData(fvrtx, group);
         }}
     }
 
@@ -131,49 +197,194 @@ public:
     }
     
     
+    /*
+        hasPriorities
+        
+        An empty priorities matrix means pairs are computed in FIFO order.
+    */
+    virtual bool hasPriorities()
+    {
+        return c_priorities.size() > 0;
+    }
+    
+    
+    /*
+        prefetch
+        
+        Prefetches the source, upwind psi and mesh data the update of the 
+        cell/angle pair and group block will read.
+        The upwind faces come from the dependency graph, whose data for a 
+        pair is compact.
+    */
+    virtual void prefetch(UINT cell, UINT angle, UINT groupBlock)
+    {
+        UINT groupBegin = groupBlock * (g_nGroups / g_nGroupBlocks);
+        UINT groupLast = groupBegin + g_nGroups / g_nGroupBlocks - 1;
+        BoundaryType bdryType[g_nFacePerCell];
+        UINT adjCellsSides[g_nFacePerCell];
+        g_dependencyGraph->getBoundaryTypes(cell, angle, bdryType);
+        g_dependencyGraph->getAdjCellsSides(cell, adjCellsSides);
+        
+        g_tychoMesh->prefetchCell(cell, angle);
+        prefetchRange(&c_source(groupBegin, 0, angle, cell), 
+                      &c_source(groupLast, g_nVrtxPerCell - 1, angle, cell));
+        
+        for (UINT face = 0; face < g_nFacePerCell; face++) {
+            UINT adjCellSide = adjCellsSides[face];
+            
+            if (bdryType[face] == BoundaryType_InInt) {
+                prefetchRange(
+                    &c_psi(groupBegin, 0, angle, adjCellSide), 
+                    &c_psi(groupLast, g_nVrtxPerCell - 1, angle, adjCellSide));
+                g_tychoMesh->prefetchIncomingFace(cell, face);
+            }
+            else if (bdryType[face] == BoundaryType_InIntBdry) {
+                prefetchRange(
+                    &c_psiBound(groupBegin, 0, angle, adjCellSide), 
+                    &c_psiBound(groupLast, g_nVrtxPerFace - 1, angle, 
+                                adjCellSide));
+                g_tychoMesh->prefetchIncomingFace(cell, face);
+            }
+        }
+    }
+    
+    
     /*
         update
         
-        Does a transport update for the given cell/angle pair.
+        Does a transport update for the given cell/angle pair and the groups
+        in the group block.
     */
-    virtual void update(UINT cell, UINT angle, 
+    virtual void update(UINT cell, UINT angle, UINT groupBlock, 
                         UINT adjCellsSides[g_nFacePerCell], 
                         BoundaryType bdryType[g_nFacePerCell])
     {
-        UNUSED_VARIABLE(adjCellsSides);
-        UNUSED_VARIABLE(bdryType);
+        if (!needsUpdate(cell, angle, groupBlock, adjCellsSides, bdryType))
+            return;
+        
+        Transport::CellGeometry geometry;
+        Transport::getCellGeometry(cell, geometry);
+        solve(geometry, cell, angle, groupBlock);
+    }
+    
+    
+    /*
+        updateBatch
+        
+        Does transport updates for several angles of a cell back to back,
+        loading the cell's geometry once.
+    */
+    virtual void updateBatch(UINT cell, const UINT *angles, UINT numAngles, 
+                             UINT groupBlock, 
+                             UINT adjCellsSides[g_nFacePerCell], 
+                             BoundaryType bdryType[g_nFacePerCell])
+    {
+        Transport::CellGeometry geometry;
+        bool haveGeometry = false;
+        for (UINT i = 0; i < numAngles; i++) {
+            if (!needsUpdate(cell, angles[i], groupBlock, adjCellsSides, 
+                             bdryType))
+            {
+                continue;
+            }
+            if (!haveGeometry) {
+                Transport::getCellGeometry(cell, geometry);
+                haveGeometry = true;
+            }
+            solve(geometry, cell, angles[i], groupBlock);
+        }
+    }
+    
+private:
+    
+    /*
+        needsUpdate
+        
+        True unless the sweep is incremental and no incoming face of the 
+        pair changed.  Marks the pair as updated for the pairs downstream.
+        Upwind pairs in the same group block are done before this one.
+    */
+    bool needsUpdate(UINT cell, UINT angle, UINT groupBlock, 
+                     const UINT adjCellsSides[g_nFacePerCell], 
+                     const BoundaryType bdryType[g_nFacePerCell])
+    {
+        if (c_changedSides == NULL)
+            return true;
+        
+        UINT angleIndex = groupBlock * g_nAngles + angle;
+        bool changed = false;
+        for (UINT face = 0; face < g_nFacePerCell; face++) {
+            UINT adjCellSide = adjCellsSides[face];
+            if (bdryType[face] == BoundaryType_InInt)
+                changed = changed || (*c_updated)(adjCellSide, angleIndex);
+            else if (bdryType[face] == BoundaryType_InIntBdry)
+                changed = changed || (*c_changedSides)(adjCellSide, angle);
+        }
+        
+        if (changed) {
+            (*c_updated)(cell, angleIndex) = true;
+            c_updatedPairs[omp_get_thread_num() * c_padVectors].push_back(
+                std::make_pair(cell, angleIndex));
+        }
+        return changed;
+    }
+    
+    
+    /*
+        prefetchRange
+        
+        Prefetches the cache lines from first to last.
+    */
+    static void prefetchRange(const void *first, const void *last)
+    {
+        uintptr_t address = (uintptr_t)first & ~(g_nBytesPerCacheLine - 1);
+        for (; address <= (uintptr_t)last; address += g_nBytesPerCacheLine) {
+            PREFETCH((const void*)address);
+        }
+    }
+    
+    
+    /*
+        solve
         
+        Transport update for the cell/angle pair and the groups in the group
+        block, given the cell's geometry.
+    */
+    void solve(const Transport::CellGeometry &geometry, UINT cell, UINT angle,
+               UINT groupBlock)
+    {
         Mat2<double> &localSource = c_localSource[omp_get_thread_num()];
         Mat2<double> &localPsi = c_localPsi[omp_get_thread_num()];
         Mat3<double> &localPsiBound = c_localPsiBound[omp_get_thread_num()];
+        UINT groupBegin = groupBlock * (g_nGroups / g_nGroupBlocks);
+        UINT groupEnd = groupBegin + g_nGroups / g_nGroupBlocks;
 
         
         // Populate localSource
         #pragma omp simd
-        for (UINT group = 0; group < g_nGroups; group++) {
+        for (UINT group = groupBegin; group < groupEnd; group++) {
         for (UINT vrtx = 0; vrtx < g_nVrtxPerCell; vrtx++) {
             localSource(vrtx, group) = c_source(group, vrtx, angle, cell);
         }}
         
         
         // Populate localPsiBound
-        Transport::populateLocalPsiBound(angle, cell, c_psi, c_psiBound, 
-                                         localPsiBound);
+        Transport::populateLocalPsiBound(angle, cell, groupBegin, groupEnd, 
+                                         c_psi, c_psiBound, localPsiBound);
         
         
         // Transport solve
-        Transport::solve(cell, angle, g_sigmaT[cell],
-                         localPsiBound, localSource, localPsi);
+        Transport::solve(geometry, cell, angle, groupBegin, groupEnd, 
+                         g_sigmaT[cell], localPsiBound, localSource, localPsi);
         
         
         // localPsi -> psi
-        for (UINT group = 0; group < g_nGroups; group++) {
+        for (UINT group = groupBegin; group < groupEnd; group++) {
         for (UINT vrtx = 0; vrtx < g_nVrtxPerCell; vrtx++) {
             c_psi(group, vrtx, angle, cell) = localPsi(vrtx, group);
         }}
     }
     
-private:
     PsiData &c_psi;
     PsiBoundData &c_psiBound;
     const PsiData &c_source;
@@ -182,6 +393,16 @@ private:
     std::vector<Mat2<double>> c_localSource;
     std::vector<Mat2<double>> c_localPsi;
     std::vector<Mat3<double>> c_localPsiBound;
+    
+    // Incremental sweep (see setIncremental)
+    // c_updatedPairs are the (cell, angleIndex) entries of c_updated set by
+    // each thread, c_padVectors apart
+    static const UINT c_padVectors = 
+        (g_nBytesPerCacheLine + sizeof(std::vector<std::pair<UINT,UINT>>) 
+         - 1) / sizeof(std::vector<std::pair<UINT,UINT>>);
+    const Mat2<bool> *c_changedSides;
+    Mat2<bool> *c_updated;
+    std::vector<std::vector<std::pair<UINT,UINT>>> c_updatedPairs;
 };
 
 #endif
@@ -43,18 +43,22 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "TychoMesh.hh"
 #include "Mat.hh"
 #include "Priorities.hh"
+#include "DependencyGraph.hh"
+#include "CellOrdering.hh"
+#include "ScheduleCache.hh"
 
 #include <cmath>
 #include <algorithm>
-#include <algorithm>
 #include <utility>
 #include <iostream>
 #include <set>
+#include <map>
 #include <queue>
+#include <string>
+#include <mpi.h>
 
 
 using namespace std;
-const static double TOL = 1.e-10;
 
 
 /*
@@ -84,6 +88,40 @@ public:
 };
 
 
+/*
+    GroupBuild struct
+    
+    State for building the schedule of one angle group.
+    All angle groups are built together (see stepGroups).
+    localAngles maps a global angle to its index in angles.
+*/
+struct GroupBuild
+{
+    vector<UINT> angles;
+    vector<UINT> localAngles;
+    Mat2<UINT> nNeeded;
+    Mat2<UINT> cellLevels;
+    Mat2<UINT> sideLevels;
+    Mat2<UINT> priorities;
+    priority_queue<PriorityWork> availableWork;
+    UINT numLeft;
+    UINT nlevels;
+    vector<SweepSchedule::Work> workDone;
+    vector<UINT> stepSizes;
+    vector<vector<SweepSchedule::Work>> workOrders;
+    vector<vector<UINT>> sendProcs;
+    vector<vector<UINT>> recvProcs;
+};
+
+
+// Schedule builder phases
+enum BuildPhase
+{
+    BuildPhase_Levels,
+    BuildPhase_Ordering
+};
+
+
 /*
     calcNeighborProcs
 */
@@ -101,43 +139,21 @@ void calcNeighborProcs(set<UINT> &neighborProcs)
 }
 
 
-/*
-    calcDependencies
-*/
-static
-void calcDependencies(const vector<UINT> &angles, 
-                      Mat3<bool> &hasChild, Mat3<bool> &hasParent)
-{
-    for (unsigned angle = 0; angle < angles.size(); ++angle) {
-    for (UINT cell = 0; cell < g_nCells; ++cell) {
-    for (UINT face = 0; face < g_nFacePerCell; ++face) {
-        hasChild(angle, cell, face) = false;
-        
-        if (g_tychoMesh->getOmegaDotN(angles[angle], cell, face) > TOL) {
-            if (g_tychoMesh->getAdjRank(cell, face) != TychoMesh::BAD_RANK)
-                hasChild(angle, cell, face) = true;
-        }
-        else if (g_tychoMesh->getOmegaDotN(angles[angle], cell, face) < -TOL) {
-            if (g_tychoMesh->getAdjRank(cell, face) != TychoMesh::BAD_RANK)
-                hasParent(angle, cell, face) = true;
-        }
-    }}}
-}
-
-
 /*
     calcNumDependents
+    
+    Number of parents wrt direction for each (cell, angle) pair.
+    If doComm is false, only parents on this rank are counted.
 */
 static
-void calcNumDependents(UINT numAngles, const Mat3<bool> &hasChild, 
-                       Mat2<UINT> &nDependents)
+void calcNumDependents(const vector<UINT> &angles, const Direction direction,
+                       const bool doComm, Mat2<UINT> &nDependents)
 {
-    for (UINT angle = 0; angle < numAngles; ++angle) {
+    for (UINT angle = 0; angle < angles.size(); ++angle) {
     for (UINT cell = 0; cell < g_nCells; ++cell) {
-    for (UINT face = 0; face < g_nFacePerCell; ++face) {
-        if (hasChild(angle, cell, face))
-            ++nDependents(angle, cell);
-    }}}
+        nDependents(angle, cell) = g_dependencyGraph->getNumParents(
+            direction, doComm, cell, angles[angle]);
+    }}
 }
 
 
@@ -158,37 +174,13 @@ void initializeWorkQ(const UINT numAngles, const Mat2<UINT> &nNeeded,
 }
 
 
-/*
-    allDone
-*/
-static
-bool allDone(const priority_queue<PriorityWork> &availableWork)
-{
-    bool done;
-    UINT doneInt;
-    
-    if (availableWork.empty())
-        doneInt = 0;
-    else
-        doneInt = 1;
-
-    Comm::gmax(doneInt);
-    if (doneInt == 1)
-        done = false;
-    else
-        done = true;
-
-    return done;
-}
-
-
 /*
     partialTopoSort
 */
 static
 void partialTopoSort(priority_queue<PriorityWork> &availableWork, 
                      Mat2<UINT> &nNeeded,
-                     const Mat3<bool> &hasChild, 
+                     const Direction direction, 
                      const Mat2<UINT> &priorities, 
                      const unsigned maxCellsPerStep,
                      const vector<UINT> &angles,
@@ -201,323 +193,300 @@ void partialTopoSort(priority_queue<PriorityWork> &availableWork,
         UINT angle = cellWork.getAngle();
         workDone.push_back(SweepSchedule::Work(cell, angles[angle]));
 
-        for (UINT face = 0; face < g_nFacePerCell; ++face) {
-            if (hasChild(angle, cell, face)) {
-                UINT childCell = g_tychoMesh->getAdjCell(cell, face);
-                
-                // on processor
-                if (childCell != TychoMesh::BOUNDARY_FACE) {
-                    --nNeeded(angle, childCell);
-                    if (nNeeded(angle, childCell) == 0) {
-                        availableWork.push(PriorityWork(childCell, angle,
-                                           priorities(angle, childCell)));
-                    }
-                }
+        // on processor
+        const UINT *child = 
+            g_dependencyGraph->childrenBegin(direction, cell, angles[angle]);
+        const UINT *childEnd = 
+            g_dependencyGraph->childrenEnd(direction, cell, angles[angle]);
+        for (; child != childEnd; ++child) {
+            UINT childCell = *child;
+            --nNeeded(angle, childCell);
+            if (nNeeded(angle, childCell) == 0) {
+                availableWork.push(PriorityWork(childCell, angle,
+                                   priorities(angle, childCell)));
             }
         }
     }
 }
 
 
-/*
-    glAngle
-*/
-static
-UINT glAngle(const vector<UINT> &angles, const UINT gAngle)
-{
-    unsigned angle = 0;
-    for (angle = 0; angle < angles.size(); ++angle) {
-        if(angles[angle] == gAngle)
-            break;
-    }
-    
-    return angle;
-}
-
-
 /*
     updateLevels
 */
 static
 void updateLevels(const vector<SweepSchedule::Work> &workDone,
-                  const vector<UINT> &angles, 
-                  Mat2<UINT> &cellLevels,
-                  const Mat3<bool> &hasParent)
+                  const vector<UINT> &localAngles, 
+                  Mat2<UINT> &cellLevels)
 {
     for (const SweepSchedule::Work &work : workDone) {
         UINT cell = work.getCell();
-        UINT angle = glAngle(angles, work.getAngle());
-        for (UINT face = 0; face < g_nFacePerCell; ++face) {
-            UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
-            if (hasParent(angle, cell, face) &&
-                adjCell != TychoMesh::BOUNDARY_FACE) // on processor
-            {
-                cellLevels(angle, adjCell) = 
-                    max(cellLevels(angle, adjCell), cellLevels(angle, cell)+1);
-            }
+        UINT angle = localAngles[work.getAngle()];
+        
+        // Parents on processor
+        const UINT *parent = g_dependencyGraph->childrenBegin(
+            Direction_Backward, cell, work.getAngle());
+        const UINT *parentEnd = g_dependencyGraph->childrenEnd(
+            Direction_Backward, cell, work.getAngle());
+        for (; parent != parentEnd; ++parent) {
+            UINT adjCell = *parent;
+            cellLevels(angle, adjCell) = 
+                max(cellLevels(angle, adjCell), cellLevels(angle, cell)+1);
         }
     }
 }
 
 
 /*
-    sendLevels
+    packSides
+    
+    Sides this step's work sends across ranks, for each neighbor index.
+    Levels send (global side, angle, level) for off processor parents.
+    Orderings send (global side, angle) for off processor children.
 */
 static
-void sendLevels(const vector<SweepSchedule::Work> &workDone,
-                const vector<UINT> &angles, 
-                const Mat2<UINT> &cellLevels,
-                const Mat3<bool> &hasParent,
-                const set<UINT> &neighborProcs)
+void packSides(const GroupBuild &group, const BuildPhase phase,
+               const map<UINT,UINT> &procIndices,
+               vector<vector<UINT>> &procSides)
 {
-    vector<vector<UINT> > commSidesAnglesLevels(Comm::numRanks());
+    const BoundaryType bdryType = (phase == BuildPhase_Levels) ? 
+        BoundaryType_InIntBdry : BoundaryType_OutIntBdry;
     
-    for (const SweepSchedule::Work &work : workDone) {
+    procSides.assign(procIndices.size(), vector<UINT>());
+    for (const SweepSchedule::Work &work : group.workDone) {
         UINT cell = work.getCell();
-        UINT angle = glAngle(angles, work.getAngle());
+        UINT angle = group.localAngles[work.getAngle()];
         for (UINT face = 0; face < g_nFacePerCell; ++face) {
-            UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
-            if (hasParent(angle, cell, face) &&
-                adjCell == TychoMesh::BOUNDARY_FACE) // off processor
+            if (g_dependencyGraph->getBoundaryType(cell, work.getAngle(), 
+                    face) == bdryType)
             {
                 UINT side = g_tychoMesh->getSide(cell, face);
-                UINT gSide = g_tychoMesh->getLGSide(side);
                 UINT neighborProc = g_tychoMesh->getAdjRank(cell, face);
-                commSidesAnglesLevels[neighborProc].push_back(gSide);
-                commSidesAnglesLevels[neighborProc].push_back(angle);
-                commSidesAnglesLevels[neighborProc].push_back
-                    (cellLevels(angle, cell));
+                vector<UINT> &sides = 
+                    procSides[procIndices.find(neighborProc)->second];
+                sides.push_back(g_tychoMesh->getLGSide(side));
+                sides.push_back(angle);
+                if (phase == BuildPhase_Levels)
+                    sides.push_back(group.cellLevels(angle, cell));
             }
         }
     }
-    
-    for(UINT proc : neighborProcs) {
-        UINT nSides = commSidesAnglesLevels[proc].size()/3;
-        Comm::sendUInt(nSides, proc);
-        if (nSides > 0) {
-            Comm::sendUIntVector(commSidesAnglesLevels[proc], proc);
-        }
-    }
 }
 
 
 /*
-    recvLevels
+    unpackSides
+    
+    Applies sides received from a neighbor to a group.  Each received side
+    satisfies one dependency of the cell it belongs to.
 */
 static
-void recvLevels(Mat2<UINT> &cellLevels, Mat2<UINT> &sideLevels,
-                   priority_queue<PriorityWork> &availableWork,
-                   const Mat2<UINT> &priorities,
-                   Mat2<UINT> &nNeeded,
-                   const set<UINT> &neighborProcs)
+void unpackSides(GroupBuild &group, const BuildPhase phase,
+                 const UINT *sides, const UINT nSides)
 {
-    for (UINT proc : neighborProcs) {
-        UINT nSides;
-        Comm::recvUInt(nSides, proc);
-        if (nSides > 0) {
-            vector<UINT> commSidesAnglesLevels(3*nSides);
-            Comm::recvUIntVector(commSidesAnglesLevels, proc);
-
-            for (UINT child = 0; child < nSides; ++child) {
-                const UINT globalSide = commSidesAnglesLevels[child * 3];
-                const UINT angle = commSidesAnglesLevels[child * 3 + 1];
-                const UINT level = commSidesAnglesLevels[child * 3 + 2];
-                const UINT localSide = g_tychoMesh->getGLSide(globalSide);
-                const UINT cell = g_tychoMesh->getSideCell(localSide);
-                
-                --nNeeded(angle, cell);  // dependencies must be in sync
-                if (nNeeded(angle, cell) == 0) {
-                    availableWork.push(PriorityWork(cell, angle, 
-                            priorities(angle, cell)));
-                }
-                cellLevels(angle, cell) = max(cellLevels(angle, cell), level+1);
-                sideLevels(angle, localSide) = level;
-            }
+    const UINT stride = (phase == BuildPhase_Levels) ? 3 : 2;
+    
+    for (UINT i = 0; i < nSides; ++i) {
+        const UINT globalSide = sides[i * stride];
+        const UINT angle = sides[i * stride + 1];
+        const UINT localSide = g_tychoMesh->getGLSide(globalSide);
+        const UINT cell = g_tychoMesh->getSideCell(localSide);
+        
+        --group.nNeeded(angle, cell);  // dependencies must be in sync
+        if (group.nNeeded(angle, cell) == 0) {
+            group.availableWork.push(PriorityWork(cell, angle, 
+                    group.priorities(angle, cell)));
+        }
+        
+        if (phase == BuildPhase_Levels) {
+            const UINT level = sides[i * stride + 2];
+            group.cellLevels(angle, cell) = 
+                max(group.cellLevels(angle, cell), level+1);
+            group.sideLevels(angle, localSide) = level;
         }
     }
 }
 
 
 /*
-    sendOrders
+    stepGroups
+    
+    Lock-step schedule builder for all angle groups at once.
+    In each step, every group takes up to maxCellsPerStep of its available
+    work (in parallel over groups), then each active neighbor gets one 
+    nonblocking message holding the sides of all groups.
+    Message layout: done flag, then for each group the number of sides 
+    followed by the sides (see packSides).
+    
+    Termination is by counting.  A rank is done stepping once all its 
+    groups have scheduled all their cell/angle pairs.  It then sends no more
+    data and needs none, so it tells its active neighbors in the header of
+    that step's message and stops.  Neighbors drop it from their active set
+    after that step.  No global reduction is needed.
 */
 static
-void sendOrders(const vector<SweepSchedule::Work> &workDone,
-                const vector<UINT> &angles, 
-                const Mat3<bool> &hasChild,
-                const set<UINT> &neighborProcs,
-                vector<vector<UINT> > &sendProcs)
+void stepGroups(vector<GroupBuild> &groups, const BuildPhase phase,
+                const set<UINT> &neighborProcs, const UINT maxCellsPerStep)
 {
-    vector<vector<UINT> > commSidesAngles(Comm::numRanks());
+    const int tag = 0;
+    const UINT numGroups = groups.size();
+    const UINT stride = (phase == BuildPhase_Levels) ? 3 : 2;
+    const Direction direction = (phase == BuildPhase_Levels) ? 
+        Direction_Backward : Direction_Forward;
     
-    for (const SweepSchedule::Work &work : workDone) {
-        UINT cell = work.getCell();
-        UINT angle = glAngle(angles, work.getAngle());
-        for (UINT face = 0; face < g_nFacePerCell; ++face) {
-            UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
-            if (hasChild(angle, cell, face) &&
-                adjCell == TychoMesh::BOUNDARY_FACE) // off processor
-            {
-                UINT side = g_tychoMesh->getSide(cell, face);
-                UINT gSide = g_tychoMesh->getLGSide(side);
-                UINT neighborProc = g_tychoMesh->getAdjRank(cell, face);
-                commSidesAngles[neighborProc].push_back(gSide);
-                commSidesAngles[neighborProc].push_back(angle);
+    vector<UINT> procs(neighborProcs.begin(), neighborProcs.end());
+    map<UINT,UINT> procIndices;
+    for (UINT i = 0; i < procs.size(); i++) {
+        procIndices[procs[i]] = i;
+    }
+    
+    
+    // Initial work and counts
+    #pragma omp parallel for schedule(dynamic)
+    for (UINT g = 0; g < numGroups; g++) {
+        GroupBuild &group = groups[g];
+        const UINT numAngles = group.angles.size();
+        group.nNeeded.resize(numAngles, g_nCells);
+        calcNumDependents(group.angles, direction, true, group.nNeeded);
+        initializeWorkQ(numAngles, group.nNeeded, group.priorities, 
+                        group.availableWork);
+        group.numLeft = numAngles * g_nCells;
+    }
+    
+    
+    // Step until all local work is scheduled
+    vector<bool> active(procs.size(), true);
+    UINT numActive = procs.size();
+    bool done = false;
+    while (!done) {
+        
+        if (phase == BuildPhase_Ordering) {
+            for (GroupBuild &group : groups) {
+                group.sendProcs.push_back(vector<UINT>());
+                group.recvProcs.push_back(vector<UINT>());
             }
         }
-    }
-
-    vector<UINT> stepSendProcs;
-    for (UINT proc : neighborProcs) {
-        UINT nSides = commSidesAngles[proc].size()/2;
-        Comm::sendUInt(nSides, proc);
-        if (nSides > 0) {
-            Comm::sendUIntVector(commSidesAngles[proc], proc);
-            stepSendProcs.push_back(proc);
+        
+        
+        // Take work and pack sides for each group
+        vector<vector<vector<UINT>>> groupSides(numGroups);
+        #pragma omp parallel for schedule(dynamic)
+        for (UINT g = 0; g < numGroups; g++) {
+            GroupBuild &group = groups[g];
+            group.workDone.clear();
+            partialTopoSort(group.availableWork, group.nNeeded, direction, 
+                            group.priorities, maxCellsPerStep, group.angles, 
+                            group.workDone);
+            group.numLeft -= group.workDone.size();
+            if (phase == BuildPhase_Levels)
+                updateLevels(group.workDone, group.localAngles, 
+                             group.cellLevels);
+            packSides(group, phase, procIndices, groupSides[g]);
         }
-    }
-    sendProcs.push_back(stepSendProcs);
-}
-
-
-/*
-    recvOrders
-*/
-static
-void recvOrders(priority_queue<PriorityWork> &availableWork,
-                const Mat2<UINT> &priorities,
-                Mat2<UINT> &nNeeded,
-                const set<UINT> &neighborProcs,
-                vector<vector<UINT> > &recvProcs)
-{
-    vector<UINT> stepRecvProcs;
-    
-    for (UINT proc : neighborProcs) {
-        UINT nSides;
-        Comm::recvUInt(nSides, proc);
-        if (nSides > 0) {
-            vector<UINT> commSidesAngles(2*nSides);
-            Comm::recvUIntVector(commSidesAngles, proc);
-            stepRecvProcs.push_back(proc);
+        
+        
+        // Done if all groups are
+        UINT numLeft = 0;
+        bool haveWork = false;
+        for (const GroupBuild &group : groups) {
+            numLeft += group.numLeft;
+            haveWork = haveWork || !group.availableWork.empty();
+        }
+        done = (numLeft == 0);
+        Insist(done || haveWork || numActive > 0, 
+               "Sweep schedule cannot finish (cyclic dependencies?).");
+        
+        
+        // Send one message to each active neighbor
+        vector<vector<UINT>> sendBuffers(procs.size());
+        vector<MPI_Request> requests;
+        for (UINT i = 0; i < procs.size(); i++) {
+            if (!active[i])
+                continue;
             
-            for (UINT parent = 0; parent < nSides; ++parent) {
-                const UINT globalSide = commSidesAngles[2 * parent];
-                const UINT localSide = g_tychoMesh->getGLSide(globalSide);
-                const UINT cell = g_tychoMesh->getSideCell(localSide);
-                const UINT angle = commSidesAngles[2 * parent + 1];
-                --nNeeded(angle, cell);  // dependencies must be in sync
-                if (nNeeded(angle, cell) == 0) {
-                    availableWork.push(PriorityWork(cell, 
-                            angle, priorities(angle, cell)));
+            vector<UINT> &buffer = sendBuffers[i];
+            buffer.push_back(done);
+            for (UINT g = 0; g < numGroups; g++) {
+                buffer.push_back(groupSides[g][i].size() / stride);
+                buffer.insert(buffer.end(), groupSides[g][i].begin(), 
+                              groupSides[g][i].end());
+                if (phase == BuildPhase_Ordering) {
+                    if (groupSides[g][i].size() > 0)
+                        groups[g].sendProcs.back().push_back(procs[i]);
                 }
             }
+            
+            MPI_Request request;
+            Comm::iSendUIntVector(buffer, procs[i], tag, request);
+            requests.push_back(request);
+        }
+        
+        
+        // Receive one message from each active neighbor
+        vector<vector<UINT>> recvBuffers(procs.size());
+        for (UINT i = 0; i < procs.size(); i++) {
+            if (active[i])
+                Comm::probeRecvUIntVector(recvBuffers[i], procs[i], tag);
+        }
+        
+        
+        // Unpack for each group
+        #pragma omp parallel for schedule(dynamic)
+        for (UINT g = 0; g < numGroups; g++) {
+            GroupBuild &group = groups[g];
+            for (UINT i = 0; i < procs.size(); i++) {
+                if (!active[i])
+                    continue;
+                
+                // Skip the done flag and earlier groups
+                const vector<UINT> &buffer = recvBuffers[i];
+                UINT index = 1;
+                for (UINT g1 = 0; g1 < g; g1++) {
+                    index += 1 + buffer[index] * stride;
+                }
+                
+                UINT nSides = buffer[index];
+                unpackSides(group, phase, buffer.data() + index + 1, nSides);
+                if (phase == BuildPhase_Ordering && nSides > 0)
+                    group.recvProcs.back().push_back(procs[i]);
+            }
+        }
+        
+        
+        // Record the step and drop neighbors that are done
+        for (UINT i = 0; i < procs.size(); i++) {
+            if (active[i] && recvBuffers[i][0]) {
+                active[i] = false;
+                numActive--;
+            }
+        }
+        
+        if (phase == BuildPhase_Ordering) {
+            for (GroupBuild &group : groups) {
+                group.workOrders.push_back(group.workDone);
+                group.stepSizes.push_back(group.workDone.size());
+            }
+        }
+        
+        if (requests.size() > 0) {
+            MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
         }
     }
-
-    recvProcs.push_back(stepRecvProcs);
-}
-
-
-/*
-    calcOrdering
-*/
-static
-void calcOrdering(const Mat3<bool> &hasChild,
-                  const Mat3<bool> &hasParent,
-                  const Mat2<UINT> &priorities,
-                  const set<UINT> &neighborProcs,
-                  const UINT numAngles,
-                  const UINT maxCellsPerStep, 
-                  const vector<UINT> &angles,
-                  vector<vector<SweepSchedule::Work> > &workOrders,
-                  vector<vector<UINT> > &sendProcs,
-                  vector<vector<UINT> > &recvProcs)
-{
-    Mat2<UINT> nParentsNeeded(numAngles, g_nCells);
-    calcNumDependents(numAngles, hasParent, nParentsNeeded);
-    priority_queue<PriorityWork> availableWork;
-    initializeWorkQ(numAngles, nParentsNeeded, priorities, availableWork);
-
-    UINT step = 0;
-    UINT elapsed = 0;
-    while (!allDone(availableWork)) {
-        ++step;
-        vector<SweepSchedule::Work> workDone;
-        partialTopoSort(availableWork, nParentsNeeded, hasChild, priorities, 
-                        maxCellsPerStep, angles, workDone);
-        workOrders.push_back(workDone);
-        sendOrders(workDone, angles, hasChild, neighborProcs, sendProcs);
-        recvOrders(availableWork, priorities, nParentsNeeded, neighborProcs, 
-                   recvProcs);
-
-        UINT stepSize = workDone.size();
-        Comm::gmax(stepSize);
-        elapsed += stepSize;
-    }
-    
-    UINT totalNCells = g_nCells;
-    Comm::gsum(totalNCells);
-    if (Comm::rank() == 0) {
-        printf("   Number of sweep steps: %" PRIu64 "\n", step);
-        double stepEff = static_cast<double>
-            (numAngles * totalNCells) / (Comm::numRanks() * elapsed);
-        printf("   Step efficiency: %f\n", stepEff);
-    }
-}
-
-
-/*
-    calcLevels
-*/
-static
-UINT calcLevels(Mat2<UINT> &cellLevels, 
-               Mat2<UINT> &sideLevels,
-               const Mat3<bool> &hasChild, 
-               const Mat3<bool> &hasParent,
-               const set<UINT> &neighborProcs, 
-               const vector<UINT> angles, 
-               const UINT numAngles, 
-               const UINT maxCellsPerStep)
-{
-    Mat2<UINT> nChildrenNeeded(numAngles, g_nCells);
-    calcNumDependents(numAngles, hasChild, nChildrenNeeded);
-    Mat2<UINT> priorities(numAngles, g_nCells);
-    priorities.setAll(0.0);
-    
-    priority_queue<PriorityWork> availableWork;
-    initializeWorkQ(numAngles, nChildrenNeeded, priorities, availableWork);
-
-    // This may fail if dependencies are not in sync between processors
-    while (!allDone(availableWork)) {
-        vector<SweepSchedule::Work> workDone;
-        partialTopoSort(availableWork, nChildrenNeeded, hasParent, priorities, 
-                        maxCellsPerStep, angles, workDone);
-        updateLevels(workDone, angles, cellLevels, hasParent);
-        sendLevels(workDone, angles, cellLevels, hasParent, neighborProcs);
-        recvLevels(cellLevels, sideLevels, availableWork, priorities,
-                   nChildrenNeeded, neighborProcs);
-    }
-    
-    UINT nlevels = cellLevels[0];
-    for(unsigned i = 1; i < cellLevels.size(); i++) {
-        nlevels = std::max(nlevels, cellLevels[i]);
-    }
-    Comm::gmax(nlevels);
-    
-    return nlevels;
 }
 
 
 /*
     randomPriorities
+    
+    randoms holds rand() values after srand(0), the same for every group.
 */
 static
-void randomPriorities(const UINT numAngles, Mat2<UINT> &priorities)
+void randomPriorities(const UINT numAngles, const vector<UINT> &randoms,
+                      Mat2<UINT> &priorities)
 {
-    srand(0);
+    UINT index = 0;
     for (UINT angle = 0; angle < numAngles; ++angle) {
     for (UINT cell = 0; cell < g_nCells; ++cell) {
-        priorities(angle, cell) = rand();
+        priorities(angle, cell) = randoms[index++];
     }}
 }
 
@@ -542,22 +511,23 @@ void levelPriorities(const Mat2<UINT> &cellLevels, const UINT numAngles,
 static
 void updatePriorities(Mat2<UINT> &priorities,
                       const vector<SweepSchedule::Work> &workDone,
-                      const vector<UINT> &angles, 
-                      const Mat3<bool> &hasParent,
+                      const vector<UINT> &localAngles, 
                       const UINT parentShift)
 {
     for (const SweepSchedule::Work &work : workDone) {
         UINT cell = work.getCell();
-        UINT angle = glAngle(angles, work.getAngle());
-        for (UINT face = 0; face < g_nFacePerCell; ++face) {
-            UINT adjCell = g_tychoMesh->getAdjCell(cell, face);
-            if (hasParent(angle, cell, face) &&
-                adjCell != TychoMesh::BOUNDARY_FACE) // on processor
-            {
-                priorities(angle, adjCell) =
-                    max(priorities(angle, adjCell),
-                        priorities(angle, cell) + parentShift);
-            }
+        UINT angle = localAngles[work.getAngle()];
+        
+        // Parents on processor
+        const UINT *parent = g_dependencyGraph->childrenBegin(
+            Direction_Backward, cell, work.getAngle());
+        const UINT *parentEnd = g_dependencyGraph->childrenEnd(
+            Direction_Backward, cell, work.getAngle());
+        for (; parent != parentEnd; ++parent) {
+            UINT adjCell = *parent;
+            priorities(angle, adjCell) =
+                max(priorities(angle, adjCell),
+                    priorities(angle, cell) + parentShift);
         }
     }
 }
@@ -568,37 +538,44 @@ void updatePriorities(Mat2<UINT> &priorities,
 */
 static
 void neighborPriorities(const Mat2<UINT> &sideLevels, 
-                        const Mat3<bool> &hasChild,
-                        const Mat3<bool> &hasParent, 
                         const vector<UINT> &angles, 
+                        const vector<UINT> &localAngles, 
                         const UINT boundScale, 
                         const UINT boundShift, 
                         const int parentShift,  // Can be -1 or 0
+                        const bool sumBoundary,
                         const UINT numAngles, 
                         const UINT maxCellsPerStep,
                         Mat2<UINT> &priorities)
 {
+    // Only children on processor are waited on
     Mat2<UINT> nChildrenNeeded(numAngles, g_nCells);
-    calcNumDependents(numAngles, hasChild, nChildrenNeeded);
+    calcNumDependents(angles, Direction_Backward, false, nChildrenNeeded);
 
+    // Internal boundary (see NeighborPriorityData for sumBoundary)
     for (UINT angle = 0; angle < numAngles; ++angle) {
     for (UINT cell = 0; cell < g_nCells; ++cell) {
-    for (UINT face = 0; face < g_nFacePerCell; ++face) {
-        if (hasChild(angle, cell, face) &&
-            g_tychoMesh->getAdjCell(cell, face) == TychoMesh::BOUNDARY_FACE)
-        {
-            UINT side = g_tychoMesh->getSide(cell, face);
-
-            // Internal boundary
-            if (g_tychoMesh->getAdjRank(cell, face) != TychoMesh::BAD_RANK)
+        UINT boundarySum = 0;
+        for (UINT face = 0; face < g_nFacePerCell; ++face) {
+            if (g_dependencyGraph->getBoundaryType(cell, angles[angle], 
+                    face) == BoundaryType_OutIntBdry)
             {
-                priorities(angle, cell) =
-                    max(priorities(angle, cell), 
-                    (sideLevels(angle, side)*boundScale + boundShift));
-                --nChildrenNeeded(angle, cell);
+                UINT side = g_tychoMesh->getSide(cell, face);
+                if (sumBoundary) {
+                    boundarySum += (sideLevels(angle, side) + 1) * boundScale;
+                }
+                else {
+                    priorities(angle, cell) =
+                        max(priorities(angle, cell), 
+                        (sideLevels(angle, side)*boundScale + boundShift));
+                }
             }
         }
-    }}}
+        if (boundarySum > 0) {
+            priorities(angle, cell) = 
+                max(priorities(angle, cell), boundarySum + boundShift);
+        }
+    }}
 
     Mat2<UINT> dummyPriorities(numAngles, g_nCells);
     dummyPriorities.setAll(0.0);
@@ -608,20 +585,24 @@ void neighborPriorities(const Mat2<UINT> &sideLevels,
     while (nSolved != numAngles * g_nCells)
     {
         vector<SweepSchedule::Work> workDone;
-        partialTopoSort(availableWork, nChildrenNeeded, hasParent, 
+        partialTopoSort(availableWork, nChildrenNeeded, Direction_Backward, 
                         dummyPriorities, maxCellsPerStep, angles, workDone);
         nSolved += workDone.size();
-        updatePriorities(priorities, workDone, angles, hasParent, parentShift);
+        updatePriorities(priorities, workDone, localAngles, parentShift);
     }
 }
 
 
 /*
     anglePriorities
+    
+    ncells is the number of cells on all ranks.
+    tiles is the tile of each cell for interAngleP 3.
 */
 static
 void anglePriorities(Mat2<UINT> &priorities, const UINT numAngles, 
-                     const UINT interAngleP, const UINT nlevels)
+                     const UINT interAngleP, const UINT nlevels, 
+                     const UINT ncells, const vector<UINT> &tiles)
 {
     vector<UINT> highPriorities(numAngles, 0);
     for (UINT angle = 0; angle < numAngles; ++angle) {
@@ -630,9 +611,6 @@ void anglePriorities(Mat2<UINT> &priorities, const UINT numAngles,
             max(highPriorities[angle], priorities(angle, cell));
     }}
 
-    UINT ncells = g_nCells;
-    Comm::gsum(ncells);
-
     switch (interAngleP)
     {
         case 0:  // interleaved
@@ -664,73 +642,322 @@ void anglePriorities(Mat2<UINT> &priorities, const UINT numAngles,
             }
             break;
         }
+        case 3:  // spatial tiles, angles interleaved within a tile
+        {
+            UINT numTiles = (g_nCells + g_cellsPerTile - 1) / g_cellsPerTile;
+            for (UINT angle = 0; angle < numAngles; ++angle) {
+            for (UINT cell = 0; cell < g_nCells; ++cell) {
+                priorities(angle, cell) += 
+                    (numTiles - 1 - tiles[cell]) * nlevels * ncells;
+            }}
+            break;
+        }
     }
 }
 
 
 /*
-    Constructor
+    printStepStats
+    
+    Steps taken by each group's sweep and its step efficiency.
+    A few reductions for all groups at the end instead of one per step.
+*/
+static
+void printStepStats(const vector<GroupBuild> &groups)
+{
+    const UINT numGroups = groups.size();
+    vector<UINT> steps(numGroups);
+    for (UINT g = 0; g < numGroups; g++) {
+        steps[g] = groups[g].workOrders.size();
+    }
+    Comm::gmax(steps);
+    
+    UINT maxSteps = 0;
+    for (UINT g = 0; g < numGroups; g++) {
+        maxSteps = max(maxSteps, steps[g]);
+    }
+    
+    vector<UINT> stepSizes(numGroups * maxSteps, 0);
+    for (UINT g = 0; g < numGroups; g++) {
+    for (UINT step = 0; step < groups[g].workOrders.size(); step++) {
+        stepSizes[g * maxSteps + step] = groups[g].stepSizes[step];
+    }}
+    Comm::gmax(stepSizes);
+    
+    UINT totalNCells = g_nCells;
+    Comm::gsum(totalNCells);
+    
+    for (UINT g = 0; g < numGroups; g++) {
+        UINT elapsed = 0;
+        for (UINT step = 0; step < maxSteps; step++) {
+            elapsed += stepSizes[g * maxSteps + step];
+        }
+        
+        if (Comm::rank() == 0) {
+            printf("   Number of sweep steps: %" PRIu64 "\n", steps[g]);
+            double stepEff = static_cast<double>
+                (groups[g].angles.size() * totalNCells) / 
+                (Comm::numRanks() * elapsed);
+            printf("   Step efficiency: %f\n", stepEff);
+        }
+    }
+}
+
+
+/*
+    create
+    
+    Creates the schedules of all angle groups.  groupAngles are the angles
+    of each group.  Schedules found in the ScheduleCache are read, and the 
+    rest are built together in lock step (see stepGroups).
     Note: function to break cyclic dependencies is not implemented
 */
-SweepSchedule::SweepSchedule(const std::vector<UINT> &angles,
-                             const UINT maxCellsPerStep,
-                             const UINT intraAngleP, 
-                             const UINT interAngleP)
+void SweepSchedule::create(const vector<vector<UINT>> &groupAngles,
+                           const UINT maxCellsPerStep,
+                           const UINT intraAngleP, 
+                           const UINT interAngleP,
+                           SweepSchedule **sweepSchedules)
 {
+    const UINT numAngleGroups = groupAngles.size();
+    vector<string> cacheNames(numAngleGroups);
+    vector<UINT> cacheKeys(numAngleGroups);
+    vector<UINT> buildGroups;
+    
+    
+    // Use the cached schedules for these parameters if there are any
+    // Angle groups are told apart by their first angle
+    for (UINT angleGroup = 0; angleGroup < numAngleGroups; angleGroup++) {
+        const vector<UINT> &angles = groupAngles[angleGroup];
+        vector<UINT> params = {g_snOrder, maxCellsPerStep, intraAngleP, 
+                               interAngleP, g_cellsPerTile};
+        params.insert(params.end(), angles.begin(), angles.end());
+        cacheNames[angleGroup] = "SweepSchedule" + to_string(angles[0]);
+        cacheKeys[angleGroup] = ScheduleCache::calcKey(params);
+        
+        vector<UINT> cacheData;
+        sweepSchedules[angleGroup] = new SweepSchedule();
+        if (ScheduleCache::read(cacheNames[angleGroup], 
+                                cacheKeys[angleGroup], cacheData)) 
+        {
+            sweepSchedules[angleGroup]->unpack(cacheData);
+            if (Comm::rank() == 0) {
+                printf("   Sweep schedule read from cache\n");
+            }
+        }
+        else {
+            buildGroups.push_back(angleGroup);
+        }
+    }
+    
+    if (buildGroups.size() == 0)
+        return;
+    
+    
+    // Setup groups to build
+    const UINT numGroups = buildGroups.size();
+    vector<GroupBuild> groups(numGroups);
+    for (UINT g = 0; g < numGroups; g++) {
+        GroupBuild &group = groups[g];
+        group.angles = groupAngles[buildGroups[g]];
+        const UINT numAngles = group.angles.size();
+        
+        group.localAngles.assign(g_nAngles, UINT64_MAX);
+        for (UINT angle = 0; angle < numAngles; angle++) {
+            group.localAngles[group.angles[angle]] = angle;
+        }
+        
+        group.cellLevels.resize(numAngles, g_nCells);
+        group.cellLevels.setAll(0);
+        group.sideLevels.resize(numAngles, g_tychoMesh->getNSides());
+        group.sideLevels.setAll(0);
+        group.priorities.resize(numAngles, g_nCells);
+        group.priorities.setAll(0);
+    }
+    
+    
     // Get processors neighboring this processor
     set<UINT> neighborProcs;
     calcNeighborProcs(neighborProcs);
     
     
-    // Get which faces are parents/children for specific angles
-    Mat3<bool> hasChild(angles.size(), g_nCells,
-                        g_nFacePerCell);
-    Mat3<bool> hasParent(angles.size(), g_nCells,
-                         g_nFacePerCell);
-    calcDependencies(angles, hasChild, hasParent);
+    // Calculate B-Levels
+    stepGroups(groups, BuildPhase_Levels, neighborProcs, maxCellsPerStep);
+    
+    vector<UINT> nlevels(numGroups, 0);
+    for (UINT g = 0; g < numGroups; g++) {
+        const Mat2<UINT> &cellLevels = groups[g].cellLevels;
+        for (UINT i = 0; i < cellLevels.size(); i++) {
+            nlevels[g] = max(nlevels[g], cellLevels[i]);
+        }
+    }
+    Comm::gmax(nlevels);
     
     
-    // Calculate B-Levels
-    Mat2<UINT> cellLevels(angles.size(), g_nCells);
-    Mat2<UINT> sideLevels(angles.size(), g_tychoMesh->getNSides());
-    UINT nlevels = calcLevels(cellLevels, sideLevels, hasChild, hasParent, 
-                             neighborProcs, angles, angles.size(), maxCellsPerStep);
+    // Data shared by the priorities of all groups
+    UINT ncells = g_nCells;
+    Comm::gsum(ncells);
     
+    vector<UINT> tiles;
+    if (interAngleP == 3)
+        CellOrdering::calcTiles(g_cellsPerTile, tiles);
     
-    // Calculate intra-angle priorities
-    Mat2<UINT> priorities(angles.size(), g_nCells);
-    switch (intraAngleP)
-    {
-      case 0:  // random
-        randomPriorities(angles.size(), priorities);
-        break;
-      case 1:  // directed graph levels
-        levelPriorities(cellLevels, angles.size(), priorities);
-        break;
-      case 2:  // breadth-first dependent seeking
-        neighborPriorities(sideLevels, hasChild, hasParent, angles, 
-                           1, 0, 0, 
-                           angles.size(), maxCellsPerStep, priorities);
-        break;
-      case 3:  // depth-first dependent seeking
-        neighborPriorities(sideLevels, hasChild, hasParent, angles, 
-                           1, nlevels, -1, 
-                           angles.size(), maxCellsPerStep, priorities);
-        break;
-      case 4:  // strict depth-first dependent seeking
-        neighborPriorities(sideLevels, hasChild, hasParent, angles, 
-                           nlevels, nlevels, -1, 
-                           angles.size(), maxCellsPerStep, priorities);
-        break;
+    vector<UINT> randoms;
+    if (intraAngleP == 0) {
+        UINT maxNumAngles = 0;
+        for (const GroupBuild &group : groups) {
+            maxNumAngles = max(maxNumAngles, (UINT)group.angles.size());
+        }
+        srand(0);
+        randoms.resize(maxNumAngles * g_nCells);
+        for (UINT &random : randoms) {
+            random = rand();
+        }
     }
     
     
-    // Calculate inter-angle priorities
-    anglePriorities(priorities, angles.size(), interAngleP, nlevels);
+    // Calculate priorities
+    #pragma omp parallel for schedule(dynamic)
+    for (UINT g = 0; g < numGroups; g++) {
+        GroupBuild &group = groups[g];
+        const UINT numAngles = group.angles.size();
+        
+        // Intra-angle priorities
+        switch (intraAngleP)
+        {
+          case 0:  // random
+            randomPriorities(numAngles, randoms, group.priorities);
+            break;
+          case 1:  // directed graph levels
+            levelPriorities(group.cellLevels, numAngles, group.priorities);
+            break;
+          case 2:  // breadth-first dependent seeking
+            neighborPriorities(group.sideLevels, group.angles, 
+                               group.localAngles, 
+                               1, 0, 0, false, 
+                               numAngles, maxCellsPerStep, group.priorities);
+            break;
+          case 3:  // depth-first dependent seeking
+            neighborPriorities(group.sideLevels, group.angles, 
+                               group.localAngles, 
+                               1, nlevels[g], -1, false, 
+                               numAngles, maxCellsPerStep, group.priorities);
+            break;
+          case 4:  // strict depth-first dependent seeking
+            neighborPriorities(group.sideLevels, group.angles, 
+                               group.localAngles, 
+                               nlevels[g], nlevels[g], -1, false, 
+                               numAngles, maxCellsPerStep, group.priorities);
+            break;
+          case 5:  // communication aware dependent seeking
+            neighborPriorities(group.sideLevels, group.angles, 
+                               group.localAngles, 
+                               1, nlevels[g], -1, true, 
+                               numAngles, maxCellsPerStep, group.priorities);
+            break;
+        }
+        
+        // Inter-angle priorities
+        anglePriorities(group.priorities, numAngles, interAngleP, 
+                        nlevels[g], ncells, tiles);
+    }
     
     
     // Calculate the Ordering
-    calcOrdering(hasChild, hasParent, priorities, neighborProcs, angles.size(), 
-                 maxCellsPerStep, angles, c_workOrders, c_sendProcs, c_recvProcs);
+    // Dependencies come from the shared g_dependencyGraph
+    stepGroups(groups, BuildPhase_Ordering, neighborProcs, maxCellsPerStep);
+    
+    
+    // Drop trailing steps with no work or communication
+    for (GroupBuild &group : groups) {
+        while (group.workOrders.size() > 0 && 
+               group.workOrders.back().size() == 0 && 
+               group.sendProcs.back().size() == 0 && 
+               group.recvProcs.back().size() == 0)
+        {
+            group.workOrders.pop_back();
+            group.sendProcs.pop_back();
+            group.recvProcs.pop_back();
+            group.stepSizes.pop_back();
+        }
+    }
+    printStepStats(groups);
+    
+    
+    // Move into the schedules and save for later runs
+    for (UINT g = 0; g < numGroups; g++) {
+        UINT angleGroup = buildGroups[g];
+        SweepSchedule *schedule = sweepSchedules[angleGroup];
+        schedule->c_workOrders.swap(groups[g].workOrders);
+        schedule->c_sendProcs.swap(groups[g].sendProcs);
+        schedule->c_recvProcs.swap(groups[g].recvProcs);
+        
+        vector<UINT> cacheData;
+        schedule->pack(cacheData);
+        ScheduleCache::write(cacheNames[angleGroup], cacheKeys[angleGroup], 
+                             cacheData);
+    }
+}
+
+
+/*
+    pack
+    
+    Flattens the schedule for ScheduleCache.  For each step: the number of 
+    work items, their (cell, angle) pairs, then the number of send procs and
+    the procs, then the same for recv procs.
+*/
+void SweepSchedule::pack(vector<UINT> &data) const
+{
+    data.clear();
+    data.push_back(c_workOrders.size());
+    for (UINT step = 0; step < c_workOrders.size(); step++) {
+        data.push_back(c_workOrders[step].size());
+        for (const Work &work : c_workOrders[step]) {
+            data.push_back(work.getCell());
+            data.push_back(work.getAngle());
+        }
+        
+        data.push_back(c_sendProcs[step].size());
+        data.insert(data.end(), c_sendProcs[step].begin(), 
+                    c_sendProcs[step].end());
+        
+        data.push_back(c_recvProcs[step].size());
+        data.insert(data.end(), c_recvProcs[step].begin(), 
+                    c_recvProcs[step].end());
+    }
+}
+
+
+/*
+    unpack
+    
+    Inverse of pack.
+*/
+void SweepSchedule::unpack(const vector<UINT> &data)
+{
+    UINT index = 0;
+    UINT numSteps = data[index++];
+    c_workOrders.resize(numSteps);
+    c_sendProcs.resize(numSteps);
+    c_recvProcs.resize(numSteps);
+    
+    for (UINT step = 0; step < numSteps; step++) {
+        UINT numWork = data[index++];
+        for (UINT i = 0; i < numWork; i++) {
+            c_workOrders[step].push_back(Work(data[index], data[index + 1]));
+            index += 2;
+        }
+        
+        UINT numSendProcs = data[index++];
+        c_sendProcs[step].assign(data.begin() + index, 
+                                 data.begin() + index + numSendProcs);
+        index += numSendProcs;
+        
+        UINT numRecvProcs = data[index++];
+        c_recvProcs[step].assign(data.begin() + index, 
+                                 data.begin() + index + numRecvProcs);
+        index += numRecvProcs;
+    }
+    Insist(index == data.size(), "Corrupt sweep schedule in cache.");
 }
 
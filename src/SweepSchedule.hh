@@ -63,10 +63,12 @@ class SweepSchedule
     
     
     // SweepSchedule implementation
-    SweepSchedule(const std::vector<UINT> &angles,
-                  const UINT maxCellsPerStep,
-                  const UINT intraAngleP,
-                  const UINT interAngleP);
+    // Schedules for all angle groups are created together
+    static void create(const std::vector<std::vector<UINT>> &groupAngles,
+                       const UINT maxCellsPerStep,
+                       const UINT intraAngleP,
+                       const UINT interAngleP,
+                       SweepSchedule **sweepSchedules);
 
     UINT nSteps() const 
         { return c_workOrders.size(); }
@@ -79,6 +81,10 @@ class SweepSchedule
     
     
   private:
+    SweepSchedule() {}
+    void pack(std::vector<UINT> &data) const;
+    void unpack(const std::vector<UINT> &data);
+    
     // work to be performed in each step
     std::vector<std::vector<Work> > c_workOrders;
     // processors to send data to after each step
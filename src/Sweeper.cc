@@ -289,11 +289,11 @@ void doComputation(const UINT step,
             }}
             
             // Populate localPsiBound
-            Transport::populateLocalPsiBound(angle, cell, psi, psiBound, 
-                                             localPsiBound);
+            Transport::populateLocalPsiBound(angle, cell, 0, g_nGroups, 
+                                             psi, psiBound, localPsiBound);
             
             // Transport solve
-            Transport::solve(cell, angle, g_sigmaT[cell], 
+            Transport::solve(cell, angle, 0, g_nGroups, g_sigmaT[cell], 
                              localPsiBound, localSource, localPsi);
             
             // localPsi -> psi
@@ -336,17 +336,16 @@ Sweeper::Sweeper()
     
 
     // Create a SweepSchedule for each angle group
+    vector<vector<UINT>> groupAngles(g_nAngleGroups);
     for (UINT angleGroup = 0; angleGroup < g_nAngleGroups; angleGroup++) {
-        UINT numAngles = angleBdryIndices[angleGroup+1] - 
-                            angleBdryIndices[angleGroup];
-        vector<UINT> angles(numAngles);
-        for (UINT angle = 0; angle < numAngles; angle++) {
-            angles[angle] = angle + angleBdryIndices[angleGroup];
+        for (UINT angle = angleBdryIndices[angleGroup]; 
+             angle < angleBdryIndices[angleGroup+1]; angle++) 
+        {
+            groupAngles[angleGroup].push_back(angle);
         }
-        g_sweepSchedule[angleGroup] = 
-            new SweepSchedule(angles, g_maxCellsPerStep, g_intraAngleP, 
-                              g_interAngleP);
     }
+    SweepSchedule::create(groupAngles, g_maxCellsPerStep, g_intraAngleP, 
+                          g_interAngleP, g_sweepSchedule);
 }
 
 
@@ -380,11 +379,14 @@ void Sweeper::sweep(PsiData &psi, const PsiData &source, bool zeroPsiBound)
     totalTimer.start();
     
     
-    // Get max steps for all OpenMP threads
+    // Get max steps for all OpenMP threads and ranks
+    // Ranks finish building their schedules at different steps, but 
+    // OriginalTycho2 needs every rank to take the same number of steps.
     UINT maxNSteps = g_sweepSchedule[0]->nSteps();
     for(UINT angleGroup = 1; angleGroup < g_nAngleGroups; angleGroup++) {
         maxNSteps = max(maxNSteps, g_sweepSchedule[angleGroup]->nSteps());
     }
+    Comm::gmax(maxNSteps);
     
     
     // Communication variables
@@ -43,11 +43,141 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Comm.hh"
 #include "CommSides.hh"
 #include "SourceIteration.hh"
+#include "Anderson.hh"
+#include "CoarseCorrection.hh"
+#include <algorithm>
 #include <math.h>
 
 using namespace std;
 
 
+namespace
+{
+
+/*
+    accelerate
+    
+    Applies the coarse correction and Anderson mixing to the boundary data 
+    psiBound made from psiBound0 by an iteration.  Either may be NULL.
+*/
+void accelerate(const PsiBoundData &psiBound0, PsiBoundData &psiBound,
+                CoarseCorrection *coarseCorrection, Anderson *anderson)
+{
+    if (coarseCorrection != NULL) {
+        PsiBoundData change;
+        for (UINT i = 0; i < psiBound.size(); i++) {
+            change[i] = psiBound[i] - psiBound0[i];
+        }
+        coarseCorrection->addCorrection(change, psiBound);
+    }
+    
+    if (anderson != NULL)
+        anderson->update(&psiBound0[0], &psiBound[0]);
+}
+
+
+/*
+    copyPsiBound
+*/
+void copyPsiBound(const PsiBoundData &from, PsiBoundData &to)
+{
+    for (UINT i = 0; i < from.size(); i++) {
+        to[i] = from[i];
+    }
+}
+
+
+
+/*
+    findChangedSides
+    
+    Marks the incoming boundary data that changed by more than 
+    g_ddIncrementalTol times the largest value since it was last swept, 
+    and copies the changed data to psiBoundSwept.  Small changes are 
+    compared again in later iterations, so they can't add up unseen.
+*/
+void findChangedSides(const PsiBoundData &psiBound, 
+                      PsiBoundData &psiBoundSwept, Mat2<bool> &changedSides)
+{
+    const UINT numValues = g_nGroups * g_nVrtxPerFace;
+    double maxValue = 0.0;
+    for (UINT i = 0; i < psiBound.size(); i++) {
+        maxValue = max(maxValue, fabs(psiBound[i]));
+    }
+    const double tolerance = g_ddIncrementalTol * maxValue;
+    
+    for (UINT side = 0; side < g_tychoMesh->getNSides(); side++) {
+    for (UINT angle = 0; angle < g_nAngles; angle++) {
+        const double *value = &psiBound(0, 0, angle, side);
+        double *sweptValue = &psiBoundSwept(0, 0, angle, side);
+        
+        bool changed = false;
+        for (UINT i = 0; i < numValues; i++) {
+            if (fabs(value[i] - sweptValue[i]) > tolerance)
+                changed = true;
+        }
+        
+        changedSides(side, angle) = changed;
+        if (changed) {
+            for (UINT i = 0; i < numValues; i++) {
+                sweptValue[i] = value[i];
+            }
+        }
+    }}
+}
+
+
+
+/*
+    sweepBoundary
+    
+    Sweeps from the boundary data psiBound.  If psiBoundSwept isn't NULL, 
+    sweeps after the first are incremental (see findChangedSides), with
+    updated as work space (see Util::sweepLocalIncremental).
+    Returns the number of (cell, angle, group block) updates done.
+*/
+UINT sweepBoundary(PsiData &psi, const PsiData &source, 
+                   PsiBoundData &psiBound, PsiBoundData *psiBoundSwept, 
+                   Mat2<bool> &changedSides, Mat2<bool> &updated, 
+                   bool firstSweep)
+{
+    if (psiBoundSwept != NULL && !firstSweep) {
+        findChangedSides(psiBound, *psiBoundSwept, changedSides);
+        return Util::sweepLocalIncremental(psi, source, psiBound, 
+                                           changedSides, updated);
+    }
+    
+    Util::sweepLocal(psi, source, psiBound);
+    if (psiBoundSwept != NULL)
+        copyPsiBound(psiBound, *psiBoundSwept);
+    return g_nCells * g_nAngles * g_nGroupBlocks;
+}
+
+
+/*
+    printSweepWork
+    
+    Prints the number of full sweeps the updates of all ranks add up to
+    and the work per iteration as a fraction of a full sweep.
+    numSweeps is the number of sweeps done by this rank.
+*/
+void printSweepWork(UINT numUpdates, UINT numSweeps)
+{
+    double work = numUpdates;
+    double fullWork = g_nCells * g_nAngles * g_nGroupBlocks;
+    double fullWorkIters = fullWork * numSweeps;
+    Comm::gsum(work);
+    Comm::gsum(fullWork);
+    Comm::gsum(fullWorkIters);
+    if (Comm::rank() == 0) {
+        printf("      PBJ Sweep work: %f full sweeps, %f per iteration\n", 
+               work / fullWork, work / fullWorkIters);
+    }
+}
+
+} // End anonymous namespace
+
+
 ////////////////////////////////////////////////////////////////////////////////
 //            SweeperPBJOuter functions
 ////////////////////////////////////////////////////////////////////////////////
@@ -56,11 +186,23 @@ using namespace std;
     solve
 
     (L_I - MSD) Psi^{n+1} = L_B Psi_B^n + Q
+    With DD_CoarseCorrection, Psi_B^{n+1} gets a coarse correction.
+    With DD_AndersonDepth > 0, Psi_B^{n+1} is mixed with the previous 
+    iterates by Anderson acceleration.
 */
 void SweeperPBJOuter::solve()
 {
     PsiData psi0;
     vector<UINT> sourceIts;
+    PsiBoundData psiBound0;
+    Anderson *anderson = NULL;
+    CoarseCorrection *coarseCorrection = NULL;
+    if (g_ddAndersonDepth > 0)
+        anderson = new Anderson(c_psiBound.size(), g_ddAndersonDepth);
+    if (g_ddCoarseCorrection) {
+        const bool scattering = true;
+        coarseCorrection = new CoarseCorrection(c_commSides, scattering);
+    }
     
     
     // Initialize source and psi
@@ -103,13 +245,17 @@ void SweeperPBJOuter::solve()
             break;
         
         
-        // Communicate
+        // Communicate and accelerate
+        if (anderson != NULL || coarseCorrection != NULL)
+            copyPsiBound(c_psiBound, psiBound0);
         c_commSides.commSides(c_psi, c_psiBound);
+        accelerate(psiBound0, c_psiBound, coarseCorrection, anderson);
         
         
         // Increment iter
         iter++;
     }
+    delete anderson;
     
     
     // Print statistics
@@ -120,6 +266,13 @@ void SweeperPBJOuter::solve()
             printf(" %" PRIu64, sourceIts[i]);
         printf("\n");
     }
+    if (coarseCorrection != NULL) {
+        if (Comm::rank() == 0) {
+            printf("Coarse correction iterations: %" PRIu64 "\n", 
+                   coarseCorrection->getNumIterations());
+        }
+        delete coarseCorrection;
+    }
 }
 
 
@@ -150,6 +303,9 @@ void SweeperPBJ::solve()
     c_iters = 0;
     Problem::getSource(c_source);
     c_psi.setToValue(0.0);
+    c_coarseCorrection = NULL;
+    if (g_ddCoarseCorrection)
+        c_coarseCorrection = new CoarseCorrection(c_commSides);
 
     if (g_useSourceIteration)
         SourceIteration::fixedPoint(*this, c_psi, c_source);
@@ -159,15 +315,51 @@ void SweeperPBJ::solve()
     if (Comm::rank() == 0) {
         printf("Num source iters: %" PRIu64 "\n", c_iters);
     }
+    if (c_coarseCorrection != NULL) {
+        if (Comm::rank() == 0) {
+            printf("Coarse correction iterations: %" PRIu64 "\n", 
+                   c_coarseCorrection->getNumIterations());
+        }
+        delete c_coarseCorrection;
+        c_coarseCorrection = NULL;
+    }
 }
 
 
 /*
     sweep
+    
+    Iterates on the boundary data until psi converges.
+    With DD_CoarseCorrection, the boundary data gets a coarse correction.
+    With DD_AndersonDepth > 0, the boundary data is mixed with the previous 
+    iterates by Anderson acceleration.
+    With DD_IncrementalTol > 0, iterations after the first only sweep the 
+    cells downstream of boundary data that changed (see findChangedSides).
+    With DD_Async, the iterations are asynchronous (see sweepAsync).
 */
 void SweeperPBJ::sweep(PsiData &psi, const PsiData &source, bool zeroPsiBound)
 {
     UNUSED_VARIABLE(zeroPsiBound);
+    if (g_ddAsync) {
+        sweepAsync(psi, source);
+        return;
+    }
+    
+    PsiBoundData psiBound0;
+    Anderson *anderson = NULL;
+    if (g_ddAndersonDepth > 0)
+        anderson = new Anderson(c_psiBoundPrev.size(), g_ddAndersonDepth);
+    
+    PsiBoundData *psiBoundSwept = NULL;
+    Mat2<bool> changedSides;
+    Mat2<bool> updated;
+    UINT numUpdates = 0;
+    if (g_ddIncrementalTol > 0.0) {
+        psiBoundSwept = new PsiBoundData();
+        changedSides.resize(g_tychoMesh->getNSides(), g_nAngles);
+        updated.resize(g_nCells, g_nAngles * g_nGroupBlocks);
+        updated.setAll(false);
+    }
 
 
     // Set psi0
@@ -182,7 +374,9 @@ void SweeperPBJ::sweep(PsiData &psi, const PsiData &source, bool zeroPsiBound)
     while (iter < g_ddIterMax) {
         
         // Sweep
-        Util::sweepLocal(psi, source, c_psiBoundPrev);
+        numUpdates += sweepBoundary(psi, source, c_psiBoundPrev, 
+                                    psiBoundSwept, changedSides, updated, 
+                                    iter == 1);
         c_iters++;
         
 
@@ -203,19 +397,158 @@ void SweeperPBJ::sweep(PsiData &psi, const PsiData &source, bool zeroPsiBound)
             break;
         
         
-        // Communicate
+        // Communicate and accelerate
+        if (anderson != NULL || c_coarseCorrection != NULL)
+            copyPsiBound(c_psiBoundPrev, psiBound0);
         c_commSides.commSides(psi, c_psiBoundPrev);
+        accelerate(psiBound0, c_psiBoundPrev, c_coarseCorrection, anderson);
         
         
         // Increment iter
         iter++;
     }
+    delete anderson;
+    delete psiBoundSwept;
 
 
     // Print statistics
     if (Comm::rank() == 0) {
         printf("      PBJ Iters: %" PRIu64 "\n", iter);
     }
+    if (g_ddIncrementalTol > 0.0)
+        printSweepWork(numUpdates, iter);
+}
+
+
+/*
+    sweepAsync
+    
+    Asynchronous PBJ.  Each rank sweeps whenever new boundary data arrived 
+    and doesn't wait for the other ranks.  Outgoing data is sent when psi 
+    changed by more than g_ddErrMax relative to the psi last sent, so 
+    ranks go quiet as they converge.
+    
+    Termination is detected by rounds of nonblocking reductions of the 
+    number of messages sent and received by all ranks (the four counter 
+    method).  Each rank posts a round only after the last one completed 
+    and only right after sweeping the data it received.  If the messages 
+    received in one round equal the messages sent in the next, no rank 
+    was active in between and no message is on its way, so all ranks 
+    stop at the same round.  The iterations also stop once any rank did 
+    g_ddIterMax sweeps.  Messages still on their way are then received by 
+    CommSides::finishAsync.
+*/
+void SweeperPBJ::sweepAsync(PsiData &psi, const PsiData &source)
+{
+    int mpiError;
+    PsiBoundData *psiBoundSwept = NULL;
+    Mat2<bool> changedSides;
+    Mat2<bool> updated;
+    UINT numUpdates = 0;
+    if (g_ddIncrementalTol > 0.0) {
+        psiBoundSwept = new PsiBoundData();
+        changedSides.resize(g_tychoMesh->getNSides(), g_nAngles);
+        updated.resize(g_nCells, g_nAngles * g_nGroupBlocks);
+        updated.setAll(false);
+    }
+    
+    
+    // Set psiSent
+    PsiData psiSent;
+    for (UINT i = 0; i < psi.size(); i++) {
+        psiSent[i] = psi[i];
+    }
+    
+    
+    // Counts for the reductions are (sent, received, ranks at the maximum 
+    // sweeps)
+    const int numCounts = 3;
+    double counts[numCounts];
+    double allCounts[numCounts];
+    double prevNumRecv = -1.0;
+    MPI_Request request = MPI_REQUEST_NULL;
+    UINT numRounds = 0;
+    
+    
+    // Sweep till converged
+    UINT iter = 0;
+    bool newData = true;
+    c_commSides.startAsync();
+    while (true) {
+        
+        // Sweep if new data arrived
+        if (newData && iter < g_ddIterMax) {
+            numUpdates += sweepBoundary(psi, source, c_psiBoundPrev, 
+                                        psiBoundSwept, changedSides, updated,
+                                        iter == 0);
+            iter++;
+            c_iters++;
+            
+            double errL1 = 0.0;
+            double normL1 = 0.0;
+            for (UINT i = 0; i < psi.size(); i++) {
+                errL1  += fabs(psiSent[i] - psi[i]);
+                normL1 += fabs(psi[i]);
+            }
+            
+            if (errL1 > g_ddErrMax * normL1) {
+                c_commSides.sendAsync(psi);
+                for (UINT i = 0; i < psi.size(); i++) {
+                    psiSent[i] = psi[i];
+                }
+            }
+        }
+        
+        
+        // Check the last round and start the next
+        int done = 1;
+        if (request != MPI_REQUEST_NULL) {
+            mpiError = MPI_Test(&request, &done, MPI_STATUS_IGNORE);
+            Insist(mpiError == MPI_SUCCESS, "");
+        }
+        
+        if (done) {
+            if (numRounds > 0) {
+                if (allCounts[2] > 0.0 || allCounts[0] == prevNumRecv)
+                    break;
+                prevNumRecv = allCounts[1];
+            }
+            
+            counts[0] = c_commSides.getNumAsyncSent();
+            counts[1] = c_commSides.getNumAsyncRecv();
+            counts[2] = (iter >= g_ddIterMax) ? 1.0 : 0.0;
+            mpiError = MPI_Iallreduce(counts, allCounts, numCounts, 
+                                      MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD, 
+                                      &request);
+            Insist(mpiError == MPI_SUCCESS, "");
+            numRounds++;
+        }
+        
+        
+        // Get new data
+        // If there is none, wait for it or for the round to complete
+        newData = c_commSides.recvAsync(c_psiBoundPrev);
+        if (!newData && request != MPI_REQUEST_NULL)
+            newData = c_commSides.waitAsync(c_psiBoundPrev, request);
+    }
+    c_commSides.finishAsync(c_psiBoundPrev);
+    delete psiBoundSwept;
+
+
+    // Print statistics
+    // PBJ Iters is the most sweeps done by a rank
+    double maxIter = iter;
+    double sumIter = iter;
+    Comm::gmax(maxIter);
+    Comm::gsum(sumIter);
+    if (Comm::rank() == 0) {
+        printf("      PBJ Iters: %" PRIu64 "\n", (UINT)maxIter);
+        printf("      PBJ Async average sweeps: %f\n", 
+               sumIter / Comm::numRanks());
+        printf("      PBJ Async reduction rounds: %" PRIu64 "\n", numRounds);
+    }
+    if (g_ddIncrementalTol > 0.0)
+        printSweepWork(numUpdates, iter);
 }
 
 
@@ -225,14 +558,25 @@ void SweeperPBJ::sweep(PsiData &psi, const PsiData &source, bool zeroPsiBound)
 
 /*
     solve
+    
+    With DD_AndersonDepth > 0, phi and the boundary data are mixed together 
+    with the previous iterates by Anderson acceleration.
 */
 void SweeperPBJSI::solve()
 {
     PhiData phi0;
     PhiData phi1;
     PsiData totalSource;
-    PsiBoundData psiBound0;
     vector<UINT> sourceIts;
+    UINT phiSize = phi0.size();
+    vector<double> x0;
+    vector<double> x1;
+    Anderson *anderson = NULL;
+    if (g_ddAndersonDepth > 0) {
+        x0.resize(phiSize + c_psiBound.size());
+        x1.resize(phiSize + c_psiBound.size());
+        anderson = new Anderson(x0.size(), g_ddAndersonDepth);
+    }
     
     
     // Initialize source and psi
@@ -246,6 +590,12 @@ void SweeperPBJSI::solve()
     UINT iter = 1;
     while (iter < g_ddIterMax) {
         
+        if (anderson != NULL) {
+            copy(&phi0[0], &phi0[0] + phiSize, x0.begin());
+            copy(&c_psiBound[0], &c_psiBound[0] + c_psiBound.size(), 
+                 x0.begin() + phiSize);
+        }
+        
         Util::calcTotalSource(c_source, phi0, totalSource);
         sweep(c_psi, totalSource, false);
         Util::psiToPhi(phi1, c_psi);
@@ -272,9 +622,21 @@ void SweeperPBJSI::solve()
             break;
         
         
+        // Mix phi and psiBound
+        if (anderson != NULL) {
+            copy(&phi0[0], &phi0[0] + phiSize, x1.begin());
+            copy(&c_psiBound[0], &c_psiBound[0] + c_psiBound.size(), 
+                 x1.begin() + phiSize);
+            anderson->update(x0.data(), x1.data());
+            copy(x1.begin(), x1.begin() + phiSize, &phi0[0]);
+            copy(x1.begin() + phiSize, x1.end(), &c_psiBound[0]);
+        }
+        
+        
         // Increment iter
         iter++;
     }
+    delete anderson;
     
     
     // Print statistics
@@ -41,6 +41,7 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "PsiData.hh"
 #include "SweeperAbstract.hh"
 #include "CommSides.hh"
+#include "CoarseCorrection.hh"
 
 
 /*
@@ -55,8 +56,11 @@ public:
     void solve();
     
 private:
+    void sweepAsync(PsiData &psi, const PsiData &source);
+    
     CommSides c_commSides;
     PsiBoundData c_psiBoundPrev;
+    CoarseCorrection *c_coarseCorrection;
     UINT c_iters;
 };
 
@@ -45,6 +45,9 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "GraphTraverser.hh"
 #include "Priorities.hh"
 #include "PsiData.hh"
+#include "TychoMesh.hh"
+#include <algorithm>
+#include <math.h>
 
 using namespace std;
 
@@ -56,6 +59,18 @@ SweeperTraverse::SweeperTraverse()
 {
     c_priorities.resize(g_nCells, g_nAngles);
     Priorities::calcPriorities(c_priorities);
+    
+    
+    // Send data on the critical path right away
+    if (g_eagerFlush) {
+        Mat2<UINT> sideBLevels(g_tychoMesh->getNSides(), g_nAngles);
+        UINT maxBLevel = Priorities::calcGlobalSideBLevels(sideBLevels);
+        UINT bLevelThreshold = 
+            (UINT)ceil(g_eagerFlushBLevelFraction * maxBLevel);
+        g_graphTraverserForward->setEagerFlush(sideBLevels, 
+                                               max(bLevelThreshold, (UINT)1),
+                                               g_eagerFlushPackets);
+    }
 }
 
 
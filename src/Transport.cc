@@ -172,7 +172,7 @@ void calcOutgoingFlux(const double area[g_nFacePerCell],
     calcIncomingFlux
 */
 static
-void calcIncomingFlux(const UINT cell, 
+void calcIncomingFlux(const UINT cellToFaceVrtx[][g_nVrtxPerCell], 
                       const double area[g_nFacePerCell],
                       const Mat3<double> &localPsiBound,
                       double cellSource[g_nVrtxPerCell],
@@ -182,9 +182,9 @@ void calcIncomingFlux(const UINT cell,
     double psiNeighbor0, psiNeighbor1, psiNeighbor2, psiNeighbor3;
 
     if (area[0] < 0) {
-        faceVertex1 = g_tychoMesh->getCellToFaceVrtx(cell, 0, 1);
-        faceVertex2 = g_tychoMesh->getCellToFaceVrtx(cell, 0, 2);
-        faceVertex3 = g_tychoMesh->getCellToFaceVrtx(cell, 0, 3);
+        faceVertex1 = cellToFaceVrtx[0][1];
+        faceVertex2 = cellToFaceVrtx[0][2];
+        faceVertex3 = cellToFaceVrtx[0][3];
         
         psiNeighbor1 = localPsiBound(faceVertex1, 0, group);
         psiNeighbor2 = localPsiBound(faceVertex2, 0, group);
@@ -204,9 +204,9 @@ void calcIncomingFlux(const UINT cell,
     }
 
     if (area[1] < 0) {
-        faceVertex0 = g_tychoMesh->getCellToFaceVrtx(cell, 1, 0);
-        faceVertex2 = g_tychoMesh->getCellToFaceVrtx(cell, 1, 2);
-        faceVertex3 = g_tychoMesh->getCellToFaceVrtx(cell, 1, 3);
+        faceVertex0 = cellToFaceVrtx[1][0];
+        faceVertex2 = cellToFaceVrtx[1][2];
+        faceVertex3 = cellToFaceVrtx[1][3];
         
         psiNeighbor0 = localPsiBound(faceVertex0, 1, group);
         psiNeighbor2 = localPsiBound(faceVertex2, 1, group);
@@ -226,9 +226,9 @@ void calcIncomingFlux(const UINT cell,
     }
 
     if (area[2] < 0) {
-        faceVertex0 = g_tychoMesh->getCellToFaceVrtx(cell, 2, 0);
-        faceVertex1 = g_tychoMesh->getCellToFaceVrtx(cell, 2, 1);
-        faceVertex3 = g_tychoMesh->getCellToFaceVrtx(cell, 2, 3);
+        faceVertex0 = cellToFaceVrtx[2][0];
+        faceVertex1 = cellToFaceVrtx[2][1];
+        faceVertex3 = cellToFaceVrtx[2][3];
         
         psiNeighbor0 = localPsiBound(faceVertex0, 2, group);
         psiNeighbor1 = localPsiBound(faceVertex1, 2, group);
@@ -248,9 +248,9 @@ void calcIncomingFlux(const UINT cell,
     }
 
     if (area[3] < 0) {
-        faceVertex0 = g_tychoMesh->getCellToFaceVrtx(cell, 3, 0);
-        faceVertex1 = g_tychoMesh->getCellToFaceVrtx(cell, 3, 1);
-        faceVertex2 = g_tychoMesh->getCellToFaceVrtx(cell, 3, 2);
+        faceVertex0 = cellToFaceVrtx[3][0];
+        faceVertex1 = cellToFaceVrtx[3][1];
+        faceVertex2 = cellToFaceVrtx[3][2];
         
         psiNeighbor0 = localPsiBound(faceVertex0, 3, group);
         psiNeighbor1 = localPsiBound(faceVertex1, 3, group);
@@ -681,10 +681,51 @@ void gaussElim4(double A[4][4], double b[4])
 namespace Transport
 {
 
+/*
+    getCellGeometry
+    
+    Loads the volume, face areas and cell to face vertex map of a cell.
+*/
+void getCellGeometry(const UINT cell, CellGeometry &geometry)
+{
+    geometry.volume = g_tychoMesh->getCellVolume(cell);
+    
+    for (UINT face = 0; face < g_nFacePerCell; face++) {
+        geometry.faceArea[face] = g_tychoMesh->getFaceArea(cell, face);
+        
+        for (UINT cvrtx = 0; cvrtx < g_nVrtxPerCell; cvrtx++) {
+            geometry.cellToFaceVrtx[face][cvrtx] = (cvrtx == face) ? 0 :
+                g_tychoMesh->getCellToFaceVrtx(cell, face, cvrtx);
+        }
+    }
+}
+
+
 /*
     solve
+    
+    Solves for groups groupBegin...groupEnd-1.
+*/
+void solve(const UINT cell, const UINT angle, 
+           const UINT groupBegin, const UINT groupEnd, const double sigmaTotal,
+           const Mat3<double> &localPsiBound, const Mat2<double> &localSource,
+           Mat2<double> &localPsi)
+{
+    CellGeometry geometry;
+    getCellGeometry(cell, geometry);
+    solve(geometry, cell, angle, groupBegin, groupEnd, sigmaTotal, 
+          localPsiBound, localSource, localPsi);
+}
+
+
+/*
+    solve
+    
+    Solves for groups groupBegin...groupEnd-1 using the cell's geometry 
+    from getCellGeometry.
 */
-void solve(const UINT cell, const UINT angle, const double sigmaTotal,
+void solve(const CellGeometry &geometry, const UINT cell, const UINT angle, 
+           const UINT groupBegin, const UINT groupEnd, const double sigmaTotal,
            const Mat3<double> &localPsiBound, const Mat2<double> &localSource,
            Mat2<double> &localPsi)
 {
@@ -692,20 +733,16 @@ void solve(const UINT cell, const UINT angle, const double sigmaTotal,
 
     
     // Get cell volume and face areas
-    volume = g_tychoMesh->getCellVolume(cell);
+    volume = geometry.volume;
     
-    area[0] = g_tychoMesh->getFaceArea(cell, 0) * 
-              g_tychoMesh->getOmegaDotN(angle, cell, 0);
-    area[1] = g_tychoMesh->getFaceArea(cell, 1) * 
-              g_tychoMesh->getOmegaDotN(angle, cell, 1);
-    area[2] = g_tychoMesh->getFaceArea(cell, 2) * 
-              g_tychoMesh->getOmegaDotN(angle, cell, 2);
-    area[3] = g_tychoMesh->getFaceArea(cell, 3) * 
-              g_tychoMesh->getOmegaDotN(angle, cell, 3);
+    area[0] = geometry.faceArea[0] * g_tychoMesh->getOmegaDotN(angle, cell, 0);
+    area[1] = geometry.faceArea[1] * g_tychoMesh->getOmegaDotN(angle, cell, 1);
+    area[2] = geometry.faceArea[2] * g_tychoMesh->getOmegaDotN(angle, cell, 2);
+    area[3] = geometry.faceArea[3] * g_tychoMesh->getOmegaDotN(angle, cell, 3);
     
     
     // Solve local transport problem for each group
-    for (UINT group = 0; group < g_nGroups; group++) {
+    for (UINT group = groupBegin; group < groupEnd; group++) {
         
         double cellSource[g_nVrtxPerCell] = {0.0};
         double matrix[g_nVrtxPerCell][g_nVrtxPerCell] = {0.0};
@@ -719,7 +756,8 @@ void solve(const UINT cell, const UINT angle, const double sigmaTotal,
         
         // form dependencies on incoming (outgoing) faces
         calcOutgoingFlux(area, matrix);
-        calcIncomingFlux(cell, area, localPsiBound, cellSource, group);
+        calcIncomingFlux(geometry.cellToFaceVrtx, area, localPsiBound, 
+                         cellSource, group);
         
         // solve matrix
         for (UINT vertex = 0; vertex < g_nVrtxPerCell; ++vertex)
@@ -735,20 +773,24 @@ void solve(const UINT cell, const UINT angle, const double sigmaTotal,
 /*
     populateLocalPsiBound
     
-    Put data from neighboring cells into localPsiBound(fvrtx, face, group).
+    Put data from neighboring cells into localPsiBound(fvrtx, face, group)
+    for groups groupBegin...groupEnd-1.
 */
 void populateLocalPsiBound(const UINT angle, const UINT cell, 
+                           const UINT groupBegin, const UINT groupEnd,
                            const PsiData &__restrict psi, 
                            const PsiBoundData & __restrict psiBound,
                            Mat3<double> &__restrict localPsiBound)
 {
     // Default to 0.0
-    for (UINT i = 0; i < localPsiBound.size(); i++)
+    // Groups are the slowest index of localPsiBound
+    UINT groupSize = g_nVrtxPerFace * g_nFacePerCell;
+    for (UINT i = groupBegin * groupSize; i < groupEnd * groupSize; i++)
         localPsiBound[i] = 0.0;
     
     // Populate if incoming flux
     #pragma omp simd
-    for (UINT group = 0; group < g_nGroups; group++) {
+    for (UINT group = groupBegin; group < groupEnd; group++) {
     for (UINT face = 0; face < g_nFacePerCell; face++) {
         if (g_tychoMesh->isIncoming(angle, cell, face)) {
             UINT neighborCell = g_tychoMesh->getAdjCell(cell, face);
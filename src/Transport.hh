@@ -47,13 +47,38 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 
 namespace Transport 
 {
+    /*
+        CellGeometry
+        
+        Angle independent data for a cell.  Loaded once when solving 
+        several angles of the same cell back to back.
+    */
+    struct CellGeometry
+    {
+        double volume;
+        double faceArea[g_nFacePerCell];
+        UINT cellToFaceVrtx[g_nFacePerCell][g_nVrtxPerCell];
+    };
+    
+    void getCellGeometry(const UINT cell, CellGeometry &geometry);
+    
     void solve(const UINT cell, const UINT angle, 
+               const UINT groupBegin, const UINT groupEnd,
+               const double sigmaTotal,
+               const Mat3<double> &localPsiBound, 
+               const Mat2<double> &localSource,
+               Mat2<double> &localPsi);
+    
+    void solve(const CellGeometry &geometry, 
+               const UINT cell, const UINT angle, 
+               const UINT groupBegin, const UINT groupEnd,
                const double sigmaTotal,
                const Mat3<double> &localPsiBound, 
                const Mat2<double> &localSource,
                Mat2<double> &localPsi);
 
     void populateLocalPsiBound(const UINT angle, const UINT cell, 
+                               const UINT groupBegin, const UINT groupEnd,
                                const PsiData &psi, const PsiBoundData &psiBound,
                                Mat3<double> &localPsiBound);
 } // End namespace Transport
@@ -104,6 +104,30 @@ public:
         { return c_faceArea(cell, face); }
     UINT getNeighborVrtx(const UINT cell, const UINT face, const UINT fvrtx) const
         { return c_neighborVrtx(cell, face, fvrtx); }
+    
+    // Software prefetch of the cell data used by a transport update
+    void prefetchCell(const UINT cell, const UINT angle) const
+    {
+        PREFETCH(&c_cellVolume(cell));
+        for (UINT face = 0; face < g_nFacePerCell; face++) {
+            PREFETCH(&c_faceArea(cell, face));
+            PREFETCH(&c_adjCell(cell, face));
+            PREFETCH(&c_omegaDotN(angle, cell, face));
+        }
+    }
+    
+    // Software prefetch of the vertex maps used for an incoming face
+    void prefetchIncomingFace(const UINT cell, const UINT face) const
+    {
+        for (UINT fvrtx = 0; fvrtx < g_nVrtxPerFace; fvrtx++) {
+            PREFETCH(&c_neighborVrtx(cell, face, fvrtx));
+        }
+        for (UINT cvrtx = 0; cvrtx < g_nVrtxPerCell; cvrtx++) {
+            if (cvrtx != face)
+                PREFETCH(&c_cellToFaceVrtx(cell, face, cvrtx));
+        }
+    }
+    
     bool isOutgoing(const UINT angle, const UINT cell, const UINT face) const
         { return getOmegaDotN(angle, cell, face) > 0; }
     bool isIncoming(const UINT angle, const UINT cell, const UINT face) const
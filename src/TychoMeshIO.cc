@@ -43,9 +43,12 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Assert.hh"
 #include "Comm.hh"
 #include "ParallelMesh.hh"
+#include "CellOrdering.hh"
 #include <memory>
 #include <stddef.h>
 #include <utility>
+#include <vector>
+#include <map>
 
 using namespace std;
 
@@ -145,6 +148,109 @@ UINT getLFaceIndex(uint64_t cellBoundingNodes[4], uint64_t faceBoundingNodes[3])
 }
 
 
+/*
+    renumberCells
+    
+    Renumbers the cells of a partition by g_cellNumbering so cells close in
+    memory are close in the mesh.  Nodes are renumbered in the order the new 
+    cell order first touches them.  Cell and face data keep their global ids 
+    and vertex orders, so only local indices change.
+*/
+static
+void renumberCells(ParallelMesh::PartitionData &partData)
+{
+    const UINT numCells = partData.numCells;
+    const UINT numNodes = partData.numNodes;
+    vector<UINT> order;
+    
+    
+    // New to old cell order
+    if (g_cellNumbering == CellNumbering_Original) {
+        return;
+    }
+    else if (g_cellNumbering == CellNumbering_RCM) {
+        vector<UINT> adjCells(numCells * g_nFacePerCell);
+        for (UINT cell = 0; cell < numCells; cell++) {
+        for (UINT faceIndex = 0; faceIndex < g_nFacePerCell; faceIndex++) {
+            UINT face = partData.cellData[cell].boundingFaces[faceIndex];
+            const ParallelMesh::FaceData &faceData = partData.faceData[face];
+            UINT adjCell = (faceData.boundingCells[0] == cell) ? 
+                faceData.boundingCells[1] : faceData.boundingCells[0];
+            
+            if (faceData.boundaryType != ParallelMesh::NotBoundary)
+                adjCell = ParallelMesh::INVALID_INDEX;
+            adjCells[cell * g_nFacePerCell + faceIndex] = adjCell;
+        }}
+        CellOrdering::rcmOrder(adjCells, order);
+    }
+    else if (g_cellNumbering == CellNumbering_Morton) {
+        vector<double> centroids(numCells * g_ndim, 0.0);
+        for (UINT cell = 0; cell < numCells; cell++) {
+        for (UINT vrtx = 0; vrtx < g_nVrtxPerCell; vrtx++) {
+            UINT node = partData.cellData[cell].boundingNodes[vrtx];
+            for (UINT dim = 0; dim < g_ndim; dim++) {
+                centroids[cell * g_ndim + dim] += 
+                    partData.nodeData[node].coords[dim] / g_nVrtxPerCell;
+            }
+        }}
+        CellOrdering::mortonOrder(centroids, order);
+    }
+    Assert(order.size() == numCells);
+    
+    
+    // Permute cells
+    vector<UINT> newCell(numCells);
+    vector<ParallelMesh::CellData> cellData(numCells);
+    for (UINT cell = 0; cell < numCells; cell++) {
+        cellData[cell] = partData.cellData[order[cell]];
+        newCell[order[cell]] = cell;
+    }
+    partData.cellData.swap(cellData);
+    
+    // Cells in other partitions keep that partition's numbering
+    for (ParallelMesh::FaceData &faceData : partData.faceData) {
+    for (UINT i = 0; i < 2; i++) {
+        if (faceData.partition[i] == (UINT)Comm::rank()) {
+            Assert(faceData.boundingCells[i] < numCells);
+            faceData.boundingCells[i] = newCell[faceData.boundingCells[i]];
+        }
+    }}
+    
+    
+    // Permute nodes
+    // Nodes not in any cell go at the end
+    vector<UINT> newNode(numNodes, ParallelMesh::INVALID_INDEX);
+    vector<ParallelMesh::NodeData> nodeData;
+    nodeData.reserve(numNodes);
+    for (UINT cell = 0; cell < numCells; cell++) {
+    for (UINT vrtx = 0; vrtx < g_nVrtxPerCell; vrtx++) {
+        UINT node = partData.cellData[cell].boundingNodes[vrtx];
+        if (newNode[node] == ParallelMesh::INVALID_INDEX) {
+            newNode[node] = nodeData.size();
+            nodeData.push_back(partData.nodeData[node]);
+        }
+    }}
+    
+    for (UINT node = 0; node < numNodes; node++) {
+        if (newNode[node] == ParallelMesh::INVALID_INDEX) {
+            newNode[node] = nodeData.size();
+            nodeData.push_back(partData.nodeData[node]);
+        }
+    }
+    partData.nodeData.swap(nodeData);
+    
+    for (ParallelMesh::CellData &cell : partData.cellData) {
+    for (UINT vrtx = 0; vrtx < g_nVrtxPerCell; vrtx++) {
+        cell.boundingNodes[vrtx] = newNode[cell.boundingNodes[vrtx]];
+    }}
+    
+    for (ParallelMesh::FaceData &face : partData.faceData) {
+    for (UINT fvrtx = 0; fvrtx < g_nVrtxPerFace; fvrtx++) {
+        face.boundingNodes[fvrtx] = newNode[face.boundingNodes[fvrtx]];
+    }}
+}
+
+
 /*
     readTychoMesh
 
@@ -159,6 +265,7 @@ void TychoMesh::readTychoMesh(const std::string &filename)
     
     // Read mesh
     ParallelMesh::readInParallel(filename, partData);
+    renumberCells(partData);
     
     
     // g_nCells, c_nNodes
@@ -296,40 +403,45 @@ void TychoMesh::readTychoMesh(const std::string &filename)
     
     
     // c_adjCellFromSide, c_adjFaceFromSide
-    vector<MPI_Request> mpiRequests;
-    for(UINT  cell = 0; cell < g_nCells; cell++) {
+    // Each side is sent with its global id since the two ranks may number 
+    // the cells on their shared faces in different orders.
+    map<UINT, vector<UINT>> sendCellFaces;
+    for(UINT cell = 0; cell < g_nCells; cell++) {
     for(UINT face = 0; face < g_nFacePerCell; face++) {
         UINT adjProc = c_adjProc(cell, face);
         UINT adjCell = c_adjCell(cell, face);
         
         if(adjCell == BOUNDARY_FACE && adjProc != BAD_RANK) {
-            MPI_Request request;
-            UINT cellFace[2];
-            cellFace[0] = cell;
-            cellFace[1] = face;
-            MPI_Isend(cellFace, 2 * sizeof(UINT), MPI_CHAR, adjProc, 0, 
-                      MPI_COMM_WORLD, &request);
-            mpiRequests.push_back(request);
+            vector<UINT> &cellFaces = sendCellFaces[adjProc];
+            cellFaces.push_back(c_lGSides(c_side(cell, face)));
+            cellFaces.push_back(cell);
+            cellFaces.push_back(face);
         }
     }}
     
+    vector<MPI_Request> mpiRequests;
+    for(const pair<const UINT, vector<UINT>> &procCellFaces : sendCellFaces) {
+        MPI_Request request;
+        MPI_Isend(procCellFaces.second.data(), procCellFaces.second.size(), 
+                  MPI_UINT64_T, procCellFaces.first, 0, MPI_COMM_WORLD, 
+                  &request);
+        mpiRequests.push_back(request);
+    }
+    
     c_adjCellFromSide.resize(c_nSides);
     c_adjFaceFromSide.resize(c_nSides);
-    for(UINT cell = 0; cell < g_nCells; cell++) {
-    for(UINT face = 0; face < g_nFacePerCell; face++) {
-        UINT adjProc = c_adjProc(cell, face);
-        UINT adjCell = c_adjCell(cell, face);
-        
-        if(adjCell == BOUNDARY_FACE && adjProc != BAD_RANK) {
-            UINT cellFace[2];
-            MPI_Recv(cellFace, 2 * sizeof(UINT), MPI_CHAR, adjProc, 0, 
-                     MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            c_adjCellFromSide(c_side(cell, face)) = cellFace[0];
-            c_adjFaceFromSide(c_side(cell, face)) = cellFace[1];
+    for(const pair<const UINT, vector<UINT>> &procCellFaces : sendCellFaces) {
+        vector<UINT> cellFaces(procCellFaces.second.size());
+        MPI_Recv(cellFaces.data(), cellFaces.size(), MPI_UINT64_T, 
+                 procCellFaces.first, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        for(UINT i = 0; i < cellFaces.size(); i += 3) {
+            UINT side = getGLSide(cellFaces[i]);
+            c_adjCellFromSide(side) = cellFaces[i + 1];
+            c_adjFaceFromSide(side) = cellFaces[i + 2];
         }
-    }}
+    }
     
-    MPI_Waitall(mpiRequests.size(), &mpiRequests[0], MPI_STATUSES_IGNORE);
+    MPI_Waitall(mpiRequests.size(), mpiRequests.data(), MPI_STATUSES_IGNORE);
 }
 
 
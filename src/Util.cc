@@ -42,6 +42,7 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Comm.hh"
 #include "SweepData.hh"
 #include "CommSides.hh"
+#include "Priorities.hh"
 #include <math.h>
 #include <limits>
 
@@ -130,18 +131,67 @@ void calcTotalSource(const PsiData &source, const PhiData &phi,
 }
 
 
+/*
+    getLocalPriorities
+    
+    Priorities for the local sweeps.  Empty if g_localSweepFIFO is set.
+*/
+static
+const Mat2<UINT>& getLocalPriorities()
+{
+    static Mat2<UINT> localPriorities;
+    static Mat2<UINT> noPriorities;
+    
+    if (!g_localSweepFIFO && localPriorities.size() == 0) {
+        localPriorities.resize(g_nCells, g_nAngles);
+        Priorities::calcLocalPriorities(localPriorities);
+    }
+    
+    return g_localSweepFIFO ? noPriorities : localPriorities;
+}
+
+
 /*
     sweepLocal
 
     Solves L_I Psi = L_B Psi_B + Q
+    Cells are computed in the depth-first order of 
+    Priorities::calcLocalPriorities, computed on the first call, or in FIFO 
+    order if g_localSweepFIFO is set.
 */
 void sweepLocal(PsiData &psi, const PsiData &source, PsiBoundData &psiBound)
 {
-    Mat2<UINT> priorities(g_nCells, g_nAngles);
     const UINT maxComputePerStep = std::numeric_limits<uint64_t>::max();
-    SweepData sweepData(psi, source, psiBound, priorities);
+    SweepData sweepData(psi, source, psiBound, getLocalPriorities());
+    
+    g_graphTraverserForward->traverse(maxComputePerStep, sweepData);
+}
+
+
+/*
+    sweepLocalIncremental
+
+    Same as sweepLocal when psi holds the result of a sweep with the same 
+    source and only the incoming boundary data marked by 
+    changedSides(side, angle) changed since.  Only the cells downstream 
+    of the changed data are swept.  updated is 
+    g_nCells x (g_nAngles * g_nGroupBlocks) work space, all false before 
+    and after.  Returns the number of (cell, angle, group block) updates 
+    done.
+*/
+UINT sweepLocalIncremental(PsiData &psi, const PsiData &source, 
+                           PsiBoundData &psiBound, 
+                           const Mat2<bool> &changedSides, 
+                           Mat2<bool> &updated)
+{
+    const UINT maxComputePerStep = std::numeric_limits<uint64_t>::max();
+    SweepData sweepData(psi, source, psiBound, getLocalPriorities());
+    sweepData.setIncremental(changedSides, updated);
     
     g_graphTraverserForward->traverse(maxComputePerStep, sweepData);
+    UINT numUpdated = sweepData.getNumUpdated();
+    sweepData.clearUpdated();
+    return numUpdated;
 }
 
 
@@ -42,6 +42,7 @@ OF THE POSSIBILITY OF SUCH DAMAGE.
 
 
 #include "PsiData.hh"
+#include "Mat.hh"
 
 namespace Util
 {
@@ -52,6 +53,10 @@ void phiToPsi(const PhiData &phi, PsiData &psi);
 void calcTotalSource(const PsiData &source, const PhiData &phi, 
                      PsiData &totalSource);
 void sweepLocal(PsiData &psi, const PsiData &source, PsiBoundData &psiBound);
+UINT sweepLocalIncremental(PsiData &psi, const PsiData &source, 
+                           PsiBoundData &psiBound, 
+                           const Mat2<bool> &changedSides, 
+                           Mat2<bool> &updated);
 void operatorS(const PhiData &phi1, PhiData &phi2);
 
 } // End namespace
@@ -0,0 +1,91 @@
+import subprocess
+import sys
+
+
+# Compares the intra-angle priority heuristics (intraAngleP)
+# Usage: python priorities.py [NX NY [mesh.smesh]]
+# Reports the step efficiency of the OriginalTycho1 schedule and the sweep
+# time of OriginalTycho1 and TraverseGraph for each heuristic.
+nx = "2"
+ny = "2"
+mesh = "cube-208.smesh"
+if len(sys.argv) > 2:
+    nx = sys.argv[1]
+    ny = sys.argv[2]
+if len(sys.argv) > 3:
+    mesh = sys.argv[3]
+
+numRanks = str(int(nx) * int(ny))
+baseDeck = "regression/input-intra3.deck"
+names = ["random", "b-level", "BFDS", "DFDS", "DFHDS", "CADS"]
+sweepTypes = ["OriginalTycho1", "TraverseGraph"]
+
+
+# Print what we're doing
+print(" ")
+print("--- Comparing Priorities on " + numRanks + " ranks ---")
+
+
+# Move necessary files to this folder and partition the mesh
+subprocess.call(["cp", "../sweep.x", "./"])
+subprocess.call(["cp", "../util/PartitionColumns.x", "./"])
+if mesh.find("/") < 0:
+    subprocess.call(["cp", "../util/" + mesh, "./"])
+subprocess.check_output(["./PartitionColumns.x", nx, ny, mesh,
+                         "priorities.pmesh"])
+
+
+# Writes the base deck with the given keys replaced
+def writeDeck(keys):
+    lines = []
+    for line in open(baseDeck):
+        words = line.split()
+        if len(words) > 0 and words[0] in keys:
+            continue
+        lines.append(line)
+    for key in keys:
+        lines.append(key + " " + keys[key] + "\n")
+    open("priorities.deck", "w").write("".join(lines))
+
+
+# Runs sweep.x and returns the average step efficiency and total time
+def run():
+    output = subprocess.check_output(["mpirun", "-n", numRanks, "./sweep.x",
+                                      "priorities.pmesh", "priorities.deck"])
+    output = output.decode()
+    efficiencies = []
+    time = 0.0
+    for line in output.splitlines():
+        words = line.split()
+        if line.find("Step efficiency:") >= 0:
+            efficiencies.append(float(words[-1]))
+        if line.find("Total time:") >= 0:
+            time = float(words[-1])
+    efficiency = 0.0
+    if len(efficiencies) > 0:
+        efficiency = sum(efficiencies) / len(efficiencies)
+    return efficiency, time
+
+
+# Run each heuristic
+print("%-8s %12s %12s %12s" %
+      ("", "step eff", "Orig1 time", "Graph time"))
+for intraAngleP in range(len(names)):
+    results = []
+    for sweepType in sweepTypes:
+        writeDeck({"intraAngleP": str(intraAngleP),
+                   "SweepType": sweepType,
+                   "OutputFile": "false"})
+        results.append(run())
+    print("%-8s %12.4f %12.2f %12.2f" %
+          (names[intraAngleP], results[0][0], results[0][1], results[1][1]))
+print(" ")
+
+
+# Remove un-necessary files
+subprocess.call(["rm", "sweep.x"])
+subprocess.call(["rm", "PartitionColumns.x"])
+subprocess.call(["rm", "priorities.pmesh"])
+subprocess.call(["rm", "priorities.deck"])
+if mesh.find("/") < 0:
+    subprocess.call(["rm", mesh])
@@ -0,0 +1,13 @@
+
+
+NX=2
+NY=2
+NUM_PARTS=$((NX*NY))
+IN_FILE="cube-208.smesh"
+OUT_FILE="temp.pmesh"
+INPUT_DECK="regression/input-cellNumbering.deck"
+export OMP_NUM_THREADS=3
+
+./PartitionColumns.x $NX $NY $IN_FILE $OUT_FILE
+mpirun -n $NUM_PARTS ./sweep.x $OUT_FILE $INPUT_DECK
+rm $OUT_FILE